@@ -0,0 +1,89 @@
+/**
+ * @file
+ *
+ * Measure the throughput of the request parser.
+ *
+ * A typical browser GET request is parsed repeatedly, one request per block,
+ * both with and without the single-pass fast path, with the fast path and
+ * lazily parsed list fields (none of which are accessed), and with all of
+ * those and messages reused from a MessagePool.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include "wave.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+static const string request{
+  "GET /wp-content/uploads/2010/03/hello-kitty-darth-vader-pink.jpg HTTP/1.1\r\n"
+  "Host: www.kittyhell.com\r\n"
+  "User-Agent: Mozilla/5.0 (Macintosh; U; Intel Mac OS X 10.6; ja-JP-mac; rv:1.9.2.3) Gecko/20100401 Firefox/3.6.3 Pathtraq/0.9\r\n"
+  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+  "Accept-Language: ja,en-us;q=0.7,en;q=0.3\r\n"
+  "Accept-Encoding: gzip,deflate\r\n"
+  "Accept-Charset: Shift_JIS,utf-8;q=0.7,*;q=0.7\r\n"
+  "Keep-Alive: 115\r\n"
+  "Connection: keep-alive\r\n"
+  "Cookie: wp_ozh_wsa_visits=2; wp_ozh_wsa_visit_lasttime=xxxxxxxxxx; __utma=xxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.x; __utmz=xxxxxxxxx.xxxxxxxxxx.x.x.utmccn=(referral)|utmcsr=reader.livedoor.com|utmcct=/reader/|utmcmd=referral\r\n"
+  "\r\n"};
+
+/**
+ * Parse the request repeatedly.
+ *
+ * @param fastPath Whether or not to use the fast path.
+ * @param lazyFields Whether or not to parse list fields lazily.
+ * @param pooled Whether or not to reuse messages from a MessagePool.
+ * @param iterations The number of requests to parse.
+ * @result The average time per request, in nanoseconds.
+ */
+static double run(bool fastPath, bool lazyFields, bool pooled, size_t iterations) {
+  RequestParser parser{};
+  parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+  parser.setFastPath(fastPath);
+  parser.setLazyFields(lazyFields);
+  if (pooled) {
+    parser.setMessagePool(make_shared<MessagePool>());
+  }
+  auto start = chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    parser.processBlock(request.data(), request.length());
+    if (parser.messages.size() != 1 || parser.messages.front()->hasError()) {
+      cerr << "Parse failed" << endl;
+      exit(1);
+    }
+    parser.messages.pop();
+  }
+  chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+  size_t iterations = argc > 1 ? stoul(argv[1]) : 100000;
+
+  // Alternate between the variants, keeping the best round of each, so that
+  // neither is penalized by noise from the rest of the machine.
+  double slow{numeric_limits<double>::max()};
+  double fast{numeric_limits<double>::max()};
+  double lazy{numeric_limits<double>::max()};
+  double pooled{numeric_limits<double>::max()};
+  for (size_t round = 0; round < 7; ++round) {
+    slow = min(slow, run(false, false, false, iterations));
+    fast = min(fast, run(true, false, false, iterations));
+    lazy = min(lazy, run(true, true, false, iterations));
+    pooled = min(pooled, run(true, true, true, iterations));
+  }
+  cout << fixed << setprecision(1);
+  cout << "State machine: " << slow << " ns/request, " << (request.length() * 1000 / slow) << " MB/s" << endl;
+  cout << "Fast path:     " << fast << " ns/request, " << (request.length() * 1000 / fast) << " MB/s" << endl;
+  cout << "Lazy fields:   " << lazy << " ns/request, " << (request.length() * 1000 / lazy) << " MB/s" << endl;
+  cout << "Pooled:        " << pooled << " ns/request, " << (request.length() * 1000 / pooled) << " MB/s" << endl;
+  cout << "Speedup:       " << (slow / fast) << "x (fast path), " << (slow / lazy) << "x (lazy fields), " << (slow / pooled) << "x (pooled)" << endl;
+  return 0;
+}
@@ -7,14 +7,20 @@
 #ifndef WAVE_HPP
 #define WAVE_HPP
 
+#include "wave/bodyStream.hpp"
 #include "wave/client.hpp"
 #include "wave/clientSession.hpp"
+#include "wave/fieldCollection.hpp"
+#include "wave/knownNames.hpp"
 #include "wave/macros.hpp"
 #include "wave/message.hpp"
+#include "wave/messagePool.hpp"
 #include "wave/parser.hpp"
 #include "wave/parsing.hpp"
+#include "wave/response.hpp"
 #include "wave/server.hpp"
 #include "wave/serverSession.hpp"
+#include "wave/target.hpp"
 
 namespace Ghoti::Wave {
 
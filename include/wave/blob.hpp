@@ -7,6 +7,10 @@
 #ifndef GHOTI_WAVE_BLOB_HPP
 #define GHOTI_WAVE_BLOB_HPP
 
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <vector>
 #include <ghoti.io/util/shared_string_view.hpp>
 #include <ghoti.io/util/errorOr.hpp>
 #include <ghoti.io/util/file.hpp>
@@ -36,12 +40,31 @@ namespace Ghoti::Wave {
  * Blobs are used for all message types, including chunked and multipart
  * messages (each chunk/part is its own Blob, and may be either in-memory or
  * on-disk).
+ *
+ * Text appended to an in-memory blob is not copied.  Instead, the blob keeps
+ * a list of the appended views (each of which shares its source), and only
+ * joins them when contiguous text is requested by getText() or getView().
+ * Joining modifies the blob, so those functions are not `const`.  The views
+ * can also be read without joining them, through getSegments() (e.g., to
+ * queue them for output) or getIovecs() (e.g., to pass them to `writev()`).
+ *
+ * When convertToFile() moves in-memory text to disk, the file is anonymous
+ * (created with `O_TMPFILE`, or `memfd_create()` if the file system does not
+ * support it), so that no directory entry is ever created or removed.  The
+ * Blob keeps the file open, and tracks its length itself, so that neither
+ * appending to it nor asking its size requires another system call to open
+ * or `stat()` it.
+ *
+ * A file blob may also be mapped into memory, so that its contents can be
+ * read through getView() at memory speed, without being copied into the heap.
+ * The mapping is grown (or shrunk) whenever the blob is modified.
  */
 class Blob {
   public:
   enum class Type {
-    TEXT,
-    FILE,
+    TEXT,   ///< The text is in memory.
+    FILE,   ///< The text is in a file.
+    MAPPED, ///< The text is in a file, which is mapped into memory.
   };
 
   /**
@@ -63,6 +86,26 @@ class Blob {
    */
   Blob(Ghoti::Util::File && file);
 
+  /**
+   * The move constructor.
+   *
+   * @param source The Blob to move from.  It is left empty.
+   */
+  Blob(Blob && source);
+
+  /**
+   * The move assignment operator.
+   *
+   * @param source The Blob to move from.  It is left empty.
+   * @return The Blob.
+   */
+  Blob & operator=(Blob && source);
+
+  /**
+   * The destructor, which unmaps any mapped file.
+   */
+  ~Blob();
+
   /**
    * Set the text contents of the Blob.
    *
@@ -104,23 +147,71 @@ class Blob {
   Ghoti::Util::ErrorOr<size_t> lengthOrError() const noexcept;
 
   /**
-   * Get the text in the blob.
+   * Get the text in the blob, joining any appended text first.
    *
    * If the Blob is a file blob, then the text will be empty.
    *
    * @return The text in the blob.
    */
-  const Ghoti::shared_string_view & getText() const;
+  const Ghoti::shared_string_view & getText();
+
+  /**
+   * Get a read-only view of the contents of a text or mapped blob, joining
+   * any appended text first.
+   *
+   * The view is only valid until the Blob is modified or destroyed.  If the
+   * Blob is a file blob which has not been mapped, then the view will be
+   * empty.
+   *
+   * @return The contents of the blob.
+   */
+  std::string_view getView();
+
+  /**
+   * Get the text of a text blob as the views from which it was appended, in
+   * order, without joining them.
+   *
+   * Each view shares its source, so the views remain valid after the Blob is
+   * modified or destroyed.  If the Blob is not a text blob, then there will
+   * be no views.
+   *
+   * @return The views.
+   */
+  std::vector<Ghoti::shared_string_view> getSegments() const;
+
+  /**
+   * Describe the contents of a text or mapped blob as a sequence of buffers,
+   * in order, without joining any appended text.
+   *
+   * The buffers are only valid until the Blob is modified or destroyed.  If
+   * the Blob is a file blob which has not been mapped, then there will be no
+   * buffers.
+   *
+   * @return The buffers, ready to be passed to `writev()`.
+   */
+  std::vector<iovec> getIovecs() const;
 
   /**
    * Get the file in the blob.
    *
-   * If the Blob is a text blob, then the file will be empty.
+   * If the Blob is a text blob, or its file was created by convertToFile()
+   * (and so has no name), then the file will be empty.
    *
    * @return The file in the blob.
    */
   const Ghoti::Util::File & getFile() const;
 
+  /**
+   * Get the descriptor of the file of a file or mapped blob, if the file was
+   * created by convertToFile().
+   *
+   * The descriptor remains owned by the Blob.  It must only be read with
+   * calls which take an explicit offset (e.g., `pread()` or `sendfile()`).
+   *
+   * @return The descriptor, or -1 if the Blob has no open file.
+   */
+  int getDescriptor() const;
+
   /**
    * Get the Ghoti::Wave::Blob::Type of data the blob contains.
    *
@@ -140,7 +231,7 @@ class Blob {
    * Append text to the current Blob object.
    *
    * The supplied text will be added to the end of any currently existing
-   * text.
+   * text.  Text appended to an in-memory blob is not copied.
    *
    * @param text The text to be appended.
    * @return The error code resulting from the operation (if any).
@@ -157,29 +248,103 @@ class Blob {
   std::error_code truncate(const Ghoti::shared_string_view & text);
 
   /**
-   * Convert the Blob object to be file-based.
+   * Convert the Blob object to be file-based, moving its text to a new
+   * anonymous file.
    *
    * If the Blob is already file-based, no error will be returned.
    *
+   * @param directory The directory (e.g., on a tmpfs or fast local disk) in
+   *   which to create the file.  If it is empty, then the OS temp directory
+   *   is used.
+   * @return The error code resulting from the operation (if any).
+   */
+  std::error_code convertToFile(const std::string & directory = {});
+
+  /**
+   * Map the file of a file-based Blob into memory, making it a mapped Blob.
+   *
+   * If the Blob is a text or mapped Blob, no error will be returned.
+   *
    * @return The error code resulting from the operation (if any).
    */
-  std::error_code convertToFile();
+  std::error_code map();
+
+  friend std::ostream & operator<<(std::ostream & out, const Blob & blob);
 
   private:
+  /**
+   * Join any appended views into `text`.
+   */
+  void join();
+
+  /**
+   * Read the whole file of a file or mapped blob.
+   *
+   * @return The contents of the file.
+   */
+  std::string readFile() const;
+
+  /**
+   * Resize the mapping to match the current length of the file.
+   *
+   * @return The error code resulting from the operation (if any).
+   */
+  std::error_code remap();
+
+  /**
+   * Remove the mapping, if there is one.
+   */
+  void unmap();
+
+  /**
+   * Close the file created by convertToFile(), if there is one.
+   */
+  void closeFile();
+
   /**
    * The type of data the blob contains.
    */
   Ghoti::Wave::Blob::Type type;
 
   /**
-   * The text data the blob contains.
+   * The text data the blob contains, not including `segments`.
    */
   Ghoti::shared_string_view text;
 
+  /**
+   * Views of text appended to `text` which have not yet been joined.
+   */
+  std::vector<Ghoti::shared_string_view> segments;
+
+  /**
+   * The total length of `segments`.
+   */
+  size_t segmentsLength;
+
   /**
    * The file data the blob contains.
    */
   Ghoti::Util::File file;
+
+  /**
+   * The descriptor of a file created by convertToFile(), or -1.
+   */
+  int hFile;
+
+  /**
+   * The length of the file, if `hFile` is open.
+   */
+  size_t fileLength;
+
+  /**
+   * The mapping of the file, or `nullptr` if it is not mapped (or is empty).
+   */
+  void * mapping;
+
+  /**
+   * The length of the mapping.
+   */
+  size_t mappingLength;
 };
 
 /**
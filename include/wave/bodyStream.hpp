@@ -0,0 +1,187 @@
+/**
+ * @file
+ *
+ * Header file for declaring the BodyStream class.
+ */
+
+#ifndef GHOTI_WAVE_BODYSTREAM_HPP
+#define GHOTI_WAVE_BODYSTREAM_HPP
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ghoti.io/util/shared_string_view.hpp>
+
+namespace Ghoti::Wave {
+
+/**
+ * Delivers the body of a Message incrementally, as it is received.
+ *
+ * When a Server streams request bodies (ServerParameter::STREAMBODIES), the
+ * request is passed to the handler as soon as its header has been parsed, and
+ * the body bytes follow through the BodyStream returned by
+ * Message.getBodyStream().  The bytes are views into the received input, so
+ * they are never accumulated or written to a temporary file.
+ *
+ * The consumer may pause the stream at any time, in which case the bytes
+ * already received are held, and no more are read from the connection until
+ * the stream is resumed.
+ */
+class BodyStream {
+  public:
+  /**
+   * The function called with each piece of the body.
+   *
+   * It is called once more with `finished` set when the body is complete (or
+   * has been aborted), possibly with an empty piece.  Calls are never
+   * concurrent, and are made either on the thread which reads the connection
+   * or on the thread which calls BodyStream.onData() or BodyStream.resume().
+   * The function should not block.
+   *
+   * @param data The next piece of the body.
+   * @param finished Whether or not this is the end of the body.
+   */
+  using DataHandler = std::function<void(const Ghoti::shared_string_view & data, bool finished)>;
+
+  /**
+   * The constructor.
+   */
+  BodyStream();
+
+  BodyStream(const BodyStream &) = delete;
+  BodyStream & operator=(const BodyStream &) = delete;
+
+  /**
+   * Set the function which receives the body.
+   *
+   * Any bytes which arrived before this call are delivered immediately, on
+   * the calling thread (unless the stream is paused).
+   *
+   * @param handler The function which receives the body.
+   */
+  void onData(DataHandler && handler);
+
+  /**
+   * Stop delivering the body, and stop reading from the connection.
+   */
+  void pause();
+
+  /**
+   * Resume delivering the body, and reading from the connection.
+   *
+   * Any bytes which arrived while the stream was paused are delivered
+   * immediately, on the calling thread.
+   */
+  void resume();
+
+  /**
+   * Whether or not the stream is paused.
+   *
+   * @return `true` if the stream is paused.
+   */
+  bool isPaused() const;
+
+  /**
+   * Whether or not the whole body has been received (or the stream has been
+   * aborted).  Some of it may not have been delivered yet.
+   *
+   * @return `true` if no more of the body will be received.
+   */
+  bool isEnded() const;
+
+  /**
+   * Whether or not the connection closed before the whole body was received.
+   *
+   * @return `true` if the body is incomplete.
+   */
+  bool isAborted() const;
+
+  /**
+   * Add a received piece of the body.
+   *
+   * This is called by the parser.
+   *
+   * @param data The piece of the body.
+   */
+  void push(const Ghoti::shared_string_view & data);
+
+  /**
+   * Indicate that the whole body has been received.
+   *
+   * This is called by the parser.
+   */
+  void finish();
+
+  /**
+   * Indicate that the body will never be completed.
+   *
+   * This is called by the session if the connection closes early.
+   */
+  void abort();
+
+  /**
+   * Set the function to call when a paused stream is resumed, so that the
+   * connection can be read again.
+   *
+   * This is called by the session.
+   *
+   * @param onResume The function to call.  It may be called from any thread.
+   */
+  void setResumeCallback(std::function<void()> && onResume);
+
+  private:
+  /**
+   * Pass the received pieces to the handler, in order, until there are no
+   * more, the stream is paused, or another thread is already doing so.
+   */
+  void deliver();
+
+  /**
+   * Used to synchronize access to the stream.
+   */
+  mutable std::mutex mutex;
+
+  /**
+   * Pieces which have been received but not yet delivered.
+   */
+  std::deque<Ghoti::shared_string_view> pending;
+
+  /**
+   * The function which receives the body.
+   */
+  DataHandler handler;
+
+  /**
+   * Called when a paused stream is resumed.
+   */
+  std::function<void()> onResume;
+
+  /**
+   * Whether or not the consumer has paused the stream.
+   */
+  bool paused;
+
+  /**
+   * Whether or not the whole body has been received (or aborted).
+   */
+  bool ended;
+
+  /**
+   * Whether or not the body was aborted.
+   */
+  bool aborted;
+
+  /**
+   * Whether or not a thread is currently calling the handler.
+   */
+  bool delivering;
+
+  /**
+   * Whether or not the handler has been told that the body is finished.
+   */
+  bool endDelivered;
+};
+
+}
+
+#endif // GHOTI_WAVE_BODYSTREAM_HPP
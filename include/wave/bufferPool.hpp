@@ -0,0 +1,135 @@
+/**
+ * @file
+ *
+ * Header file for declaring the BufferPool class.
+ */
+
+#ifndef GHOTI_WAVE_BUFFERPOOL_HPP
+#define GHOTI_WAVE_BUFFERPOOL_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Ghoti::Wave {
+
+/**
+ * A free list of fixed-size I/O buffers.
+ *
+ * Sessions borrow a buffer only for the duration of a read, so idle
+ * connections do not hold any buffer memory, and a buffer that has been
+ * returned is reused without being reallocated or zero-filled.
+ *
+ * Buffers may be borrowed and returned from any thread.
+ */
+class BufferPool {
+  public:
+  /**
+   * A buffer borrowed from a BufferPool.
+   *
+   * The buffer is returned to the pool when this object is destroyed.
+   */
+  class Buffer {
+    public:
+    /**
+     * The constructor.
+     *
+     * @param pool The pool to which the memory will be returned.
+     * @param memory The buffer memory.
+     */
+    Buffer(BufferPool * pool, std::unique_ptr<char[]> && memory);
+
+    /**
+     * The destructor.
+     *
+     * Returns the memory to the pool.
+     */
+    ~Buffer();
+
+    Buffer(const Buffer &) = delete;
+    Buffer & operator=(const Buffer &) = delete;
+
+    /**
+     * Get a pointer to the buffer memory.
+     *
+     * @return A pointer to the buffer memory.
+     */
+    char * data() const;
+
+    /**
+     * Get the size of the buffer in bytes.
+     *
+     * @return The size of the buffer in bytes.
+     */
+    size_t size() const;
+
+    private:
+    /**
+     * The pool to which the memory will be returned.
+     */
+    BufferPool * pool;
+
+    /**
+     * The buffer memory.
+     */
+    std::unique_ptr<char[]> memory;
+  };
+
+  /**
+   * The constructor.
+   *
+   * @param bufferSize The size in bytes of each buffer.
+   * @param maxFree The maximum number of returned buffers that will be kept
+   *   for reuse.  Any additional buffers are freed when they are returned.
+   */
+  BufferPool(size_t bufferSize, size_t maxFree = 256);
+
+  /**
+   * Borrow a buffer from the pool, allocating a new one if none are free.
+   *
+   * The contents of the buffer are unspecified.
+   *
+   * @return The borrowed buffer.
+   */
+  Buffer acquire();
+
+  /**
+   * Get the size in bytes of each buffer.
+   *
+   * @return The size in bytes of each buffer.
+   */
+  size_t getBufferSize() const;
+
+  private:
+  /**
+   * Return buffer memory to the free list.
+   *
+   * @param memory The buffer memory.
+   */
+  void release(std::unique_ptr<char[]> && memory);
+
+  /**
+   * The size in bytes of each buffer.
+   */
+  size_t bufferSize;
+
+  /**
+   * The maximum number of buffers kept in `freeBuffers`.
+   */
+  size_t maxFree;
+
+  /**
+   * Used to synchronize access to `freeBuffers`.
+   */
+  std::mutex controlMutex;
+
+  /**
+   * Buffers which are available to be borrowed.
+   */
+  std::vector<std::unique_ptr<char[]>> freeBuffers;
+};
+
+}
+
+#endif // GHOTI_WAVE_BUFFERPOOL_HPP
+
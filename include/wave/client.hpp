@@ -7,7 +7,6 @@
 #ifndef GHOTI_WAVE_CLIENT_HPP
 #define GHOTI_WAVE_CLIENT_HPP
 
-#include <ghoti.io/pool.hpp>
 #include <ghoti.io/util/shared_string_view.hpp>
 #include <map>
 #include <memory>
@@ -104,11 +103,6 @@ class Client : public HasClientParameters {
   virtual Ghoti::Util::ErrorOr<std::any> getParameterDefault(const Ghoti::Wave::ClientParameter & parameter) override;
 
   private:
-  /**
-   * The thread pool worker queue.
-   */
-  Ghoti::Pool::Pool workers;
-
   /**
    * Stores all connections and their request queues.
    *
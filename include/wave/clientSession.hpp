@@ -16,8 +16,10 @@
 #include <ostream>
 #include <map>
 #include <string>
+#include "wave/bufferPool.hpp"
 #include "wave/client.hpp"
 #include "wave/message.hpp"
+#include "wave/outputQueue.hpp"
 #include "wave/parser.hpp"
 
 namespace Ghoti::Wave {
@@ -46,8 +48,9 @@ class ClientSession : public HasClientParameters {
    * @param hServer The socket handle to the Server to which this session will
    *   communicate.
    * @param client A pointer to the parent Client object.
+   * @param bufferPool The pool from which read buffers are borrowed.
    */
-  ClientSession(int hServer, Client * client);
+  ClientSession(int hServer, Client * client, std::shared_ptr<BufferPool> bufferPool);
 
   /**
    * The destructor.
@@ -175,12 +178,23 @@ class ClientSession : public HasClientParameters {
    */
   Client * client;
 
+  /**
+   * The pool from which read buffers are borrowed.
+   */
+  std::shared_ptr<BufferPool> bufferPool;
+
   /**
    * Tracks message/response pairs.
    *
    * messages[request sequence #] = <request, response, send state>
    */
   std::map<uint64_t, std::tuple<std::shared_ptr<Message>, std::shared_ptr<Message>, std::any>> messages;
+
+  /**
+   * Serialized requests which have not yet been completely written by
+   * ClientSession.write().
+   */
+  OutputQueue output;
 };
 
 }
@@ -0,0 +1,371 @@
+/**
+ * @file
+ *
+ * Header file for declaring the FieldCollection class.
+ */
+
+#ifndef GHOTI_WAVE_FIELDCOLLECTION_HPP
+#define GHOTI_WAVE_FIELDCOLLECTION_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <ghoti.io/util/shared_string_view.hpp>
+#include "wave/knownNames.hpp"
+#include "wave/smallVector.hpp"
+
+namespace Ghoti::Wave {
+
+/**
+ * The header (or trailer) fields of a Message.
+ *
+ * Each field value is stored, in the order received, in a single contiguous
+ * array which holds a typical number of values without allocating.  Field
+ * names are compared without regard to case.
+ *
+ * Viewed as a whole, the collection behaves like a map from each distinct
+ * field name (in the order first seen) to its values.
+ *
+ * The value of a list field may be added unparsed, in which case it is only
+ * split into its elements (and any quoted elements unescaped) when the field
+ * is first accessed.  Because of this, even reading the collection modifies
+ * it, so it must not be accessed by more than one thread at a time.
+ */
+class FieldCollection {
+  public:
+  /**
+   * The number of field values that are stored without allocating.
+   */
+  static constexpr size_t INLINE_FIELDS{16};
+
+  /**
+   * A single field value.
+   */
+  struct Field {
+    FieldName id;                   ///< The FieldName, if it is well-known.
+    bool unparsed;                  ///< Whether `value` is an unsplit list.
+    uint32_t next;                  ///< The index of the next value of the
+                                    ///<   same field, or 0 if there is none.
+    Ghoti::shared_string_view name; ///< The field name, as provided.
+    Ghoti::shared_string_view value; ///< The field value.
+  };
+
+  /**
+   * A view of all of the values of one field name, in order.
+   *
+   * The view is only valid until the collection is modified (other than by
+   * the parsing of an unparsed value).
+   */
+  class Values {
+    public:
+    /**
+     * Iterates over the values.
+     */
+    class iterator {
+      public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Ghoti::shared_string_view;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const Ghoti::shared_string_view *;
+      using reference = const Ghoti::shared_string_view &;
+
+      iterator() : collection{nullptr}, index{0} {}
+      iterator(const FieldCollection * collection, size_t index) : collection{collection}, index{index} {}
+      reference operator*() const;
+      pointer operator->() const;
+      iterator & operator++();
+      iterator operator++(int);
+      bool operator==(const iterator & rhs) const = default;
+
+      private:
+      const FieldCollection * collection;
+      size_t index;
+    };
+
+    /**
+     * Get the number of values.
+     *
+     * @return The number of values.
+     */
+    size_t size() const;
+
+    /**
+     * Whether or not there are no values.
+     *
+     * @return `true` if the field is not present.
+     */
+    bool empty() const;
+
+    /**
+     * Get a value.
+     *
+     * @param index The index of the value.
+     * @return The value.
+     */
+    const Ghoti::shared_string_view & operator[](size_t index) const;
+
+    /**
+     * Get a value, with bounds checking.
+     *
+     * @param index The index of the value.
+     * @return The value.
+     * @throws std::out_of_range if there is no such value.
+     */
+    const Ghoti::shared_string_view & at(size_t index) const;
+
+    iterator begin() const;
+    iterator end() const;
+
+    private:
+    friend class FieldCollection;
+
+    /**
+     * The constructor.
+     *
+     * @param collection The collection.
+     * @param first The index of the first value, or the size of the
+     *   collection if there are no values.
+     */
+    Values(const FieldCollection * collection, size_t first);
+
+    /**
+     * The collection.
+     */
+    const FieldCollection * collection;
+
+    /**
+     * The index of the first value.
+     */
+    size_t first;
+  };
+
+  /**
+   * A field name together with its values.
+   */
+  struct NamedValues {
+    const Ghoti::shared_string_view & first; ///< The field name.
+    Values second;                           ///< The field values.
+  };
+
+  /**
+   * Iterates over the distinct field names, in the order that they were first
+   * added.
+   */
+  class iterator {
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = NamedValues;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const NamedValues *;
+    using reference = const NamedValues &;
+
+    iterator(const FieldCollection * collection, size_t index);
+    reference operator*() const;
+    pointer operator->() const;
+    iterator & operator++();
+    bool operator==(const iterator & rhs) const;
+
+    private:
+    /**
+     * Refresh `current` from `index`.
+     */
+    void update();
+
+    const FieldCollection * collection;
+    size_t index;
+    std::optional<NamedValues> current;
+  };
+
+  /**
+   * The constructor.
+   */
+  FieldCollection();
+
+  FieldCollection(const FieldCollection &) = default;
+  FieldCollection & operator=(const FieldCollection &) = default;
+
+  /**
+   * The move constructor.
+   *
+   * @param source The collection to move from.  It is left empty.
+   */
+  FieldCollection(FieldCollection && source);
+
+  /**
+   * The move assignment operator.
+   *
+   * @param source The collection to move from.  It is left empty.
+   * @return The collection.
+   */
+  FieldCollection & operator=(FieldCollection && source);
+
+  /**
+   * Remove all fields.
+   */
+  void clear();
+
+  /**
+   * Add a field value.
+   *
+   * @param name The field name.
+   * @param value The field value.
+   */
+  void add(const Ghoti::shared_string_view & name, const Ghoti::shared_string_view & value);
+
+  /**
+   * Add a field value whose name has already been identified.
+   *
+   * @param id The FieldName of `name`.
+   * @param name The field name.
+   * @param value The field value.
+   */
+  void add(FieldName id, const Ghoti::shared_string_view & name, Ghoti::shared_string_view value);
+
+  /**
+   * Add the whole value of a list field, which is split into its elements
+   * when the field is first accessed.
+   *
+   * The value must already have been trimmed, and checked to contain only
+   * valid field content.  Empty elements are ignored, and anything following
+   * a quoted element (up to the next comma) is discarded.
+   *
+   * @param id The FieldName of `name`.
+   * @param name The field name.
+   * @param value The unparsed field value.
+   */
+  void addUnparsed(FieldName id, const Ghoti::shared_string_view & name, Ghoti::shared_string_view value);
+
+  /**
+   * Get the number of distinct field names.
+   *
+   * @return The number of distinct field names.
+   */
+  size_t size() const;
+
+  /**
+   * Whether or not there are no fields.
+   *
+   * @return `true` if there are no fields.
+   */
+  bool empty() const;
+
+  /**
+   * Get the values of a field, ignoring the case of its name.
+   *
+   * @param name The field name.
+   * @return The values, which is empty if the field is not present.
+   */
+  Values get(std::string_view name) const;
+
+  /**
+   * Get the values of a well-known field, without searching for it.
+   *
+   * @param name The field name.
+   * @return The values, which is empty if the field is not present.
+   */
+  Values get(FieldName name) const;
+
+  /**
+   * Get the values of a field, ignoring the case of its name.
+   *
+   * @param name The field name.
+   * @return The values.
+   * @throws std::out_of_range if the field is not present.
+   */
+  Values at(std::string_view name) const;
+
+  /**
+   * Whether or not a field is present, ignoring the case of its name.
+   *
+   * @param name The field name.
+   * @return `true` if the field is present.
+   */
+  bool contains(std::string_view name) const;
+
+  iterator begin() const;
+  iterator end() const;
+
+  private:
+  /**
+   * Find the first value of a field.
+   *
+   * @param id The FieldName of the field.
+   * @param name The field name, which is only used if `id` is
+   *   FieldName::UNKNOWN.
+   * @return The index of the first value, or the number of values if the
+   *   field is not present.
+   */
+  size_t findFirst(FieldName id, std::string_view name) const;
+
+  /**
+   * Find the next value of the same field.
+   *
+   * @param index The index of a value.
+   * @return The index of the next value with the same name, or the number of
+   *   values if there is none.
+   */
+  size_t findNext(size_t index) const;
+
+  /**
+   * Add a field value, linking it to the previous values of the same field.
+   *
+   * @param id The FieldName of `name`.
+   * @param name The field name.
+   * @param value The field value.
+   * @param unparsed Whether `value` is an unsplit list.
+   */
+  void append(FieldName id, const Ghoti::shared_string_view & name, Ghoti::shared_string_view value, bool unparsed);
+
+  /**
+   * Split any unparsed values of a field into their elements.
+   *
+   * @param id The FieldName of the field.
+   */
+  void parse(FieldName id) const;
+
+  /**
+   * Split every unparsed value into its elements.
+   */
+  void parseAll() const;
+
+  /**
+   * Split an unparsed value into its elements.
+   *
+   * The first element replaces the value, and the rest are added to the end
+   * of `fields`, linked in order, so that the indices of all other values
+   * are unchanged.
+   *
+   * @param index The index of the unparsed value.
+   */
+  void parseValue(size_t index) const;
+
+  /**
+   * All of the field values, in the order that they were added (except for
+   * the elements of values parsed after they were added).
+   */
+  mutable SmallVector<Field, INLINE_FIELDS> fields;
+
+  /**
+   * For each well-known FieldName, one more than the index of its first
+   * value, or 0 if it is not present.
+   */
+  std::array<uint32_t, FIELD_NAME_COUNT> firstKnown;
+
+  /**
+   * The number of distinct field names.
+   */
+  size_t distinctCount;
+
+  /**
+   * The number of values which have not yet been parsed.
+   */
+  mutable size_t unparsedCount;
+};
+
+}
+
+#endif // GHOTI_WAVE_FIELDCOLLECTION_HPP
+
@@ -20,6 +20,14 @@ enum class ClientParameter {
                  ///<   sockets.
   MEMCHUNKSIZELIMIT, ///< The maximum size in bytes allowed for a chunk before
                      ///<   converting the chunk to a file.
+  MINWORKERS, ///< The minimum number of worker threads kept by the client.
+  MAXWORKERS, ///< The maximum number of worker threads that the client may
+              ///<   grow to.  0 means one per hardware thread.
+  MAXLINELENGTH, ///< The maximum number of bytes of an unfinished line (of
+                 ///<   the header section, the trailer section, or a chunk
+                 ///<   size) that a parser will hold while waiting for the
+                 ///<   rest of the line.  A response with a longer line fails
+                 ///<   to parse.  0 means no limit.
 };
 
 /**
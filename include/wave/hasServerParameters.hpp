@@ -20,6 +20,55 @@ enum class ServerParameter {
                  ///<   sockets.
   MEMCHUNKSIZELIMIT, ///< The maximum size in bytes allowed for a chunk before
                      ///<   converting the chunk to a file.
+  IOBACKEND, ///< The ServerIOBackend used to read from and write to sockets.
+  REACTORCOUNT, ///< The number of reactors (each with its own listening
+                ///<   socket, dispatch thread, and sessions) that the server
+                ///<   runs.  0 means one per hardware thread.
+  MINWORKERS, ///< The minimum number of worker threads kept by each reactor.
+  MAXWORKERS, ///< The maximum number of worker threads that each reactor
+              ///<   may grow to.  0 means one per hardware thread.
+  MAXHANDLERS, ///< The maximum number of threads that each reactor may grow
+               ///<   to for running request handlers.  These are separate
+               ///<   from the worker threads, so that blocked handlers
+               ///<   never delay socket I/O.  Requests beyond the limit wait
+               ///<   for a handler thread to become free.  0 means eight
+               ///<   per hardware thread.
+  LISTENBACKLOG, ///< The length of the pending connection queue of each
+                 ///<   listening socket.  The kernel may cap this value
+                 ///<   (see `net.core.somaxconn`).
+  DEFERACCEPT, ///< The number of seconds for which the kernel may hold a new
+               ///<   connection until request data arrives, before
+               ///<   reporting it to the server (`TCP_DEFER_ACCEPT`).  0
+               ///<   disables the option.
+  STREAMBODIES, ///< Whether or not request bodies are streamed.  If `true`,
+                ///<   a request with a body is passed to the handler as soon
+                ///<   as its header has been parsed, and the body is
+                ///<   delivered through Message.getBodyStream().
+  LAZYFIELDS, ///< Whether or not list field values are only split into
+              ///<   their elements when the handler accesses them.  See
+              ///<   Parser.setLazyFields().
+  PRESERVECHUNKS, ///< Whether or not each chunk of a chunked request body is
+                  ///<   kept separately (Message.getChunks()), rather than
+                  ///<   being coalesced into the message body.
+  SPILLDIRECTORY, ///< The directory (a `std::string`) in which a request
+                  ///<   body larger than MEMCHUNKSIZELIMIT is stored, in an
+                  ///<   anonymous file.  Empty means the OS temp directory.
+  MAXLINELENGTH, ///< The maximum number of bytes of an unfinished line (of
+                 ///<   the header section, the trailer section, or a chunk
+                 ///<   size) that a parser will hold while waiting for the
+                 ///<   rest of the line.  A request with a longer line fails
+                 ///<   to parse.  0 means no limit.
+};
+
+/**
+ * The mechanisms that a Server may use to perform socket I/O.
+ */
+enum class ServerIOBackend {
+  EPOLL,    ///< Readiness notification with epoll, followed by recv()/write()
+            ///<   calls from the worker threads.
+  IO_URING, ///< Completion-based I/O with io_uring, using multishot receives
+            ///<   into a provided buffer ring and linked sends.  Falls back to
+            ///<   EPOLL if io_uring is unavailable.
 };
 
 /**
@@ -0,0 +1,283 @@
+/**
+ * @file
+ *
+ * Header file for declaring the IoUring class.
+ */
+
+#ifndef GHOTI_WAVE_IOURING_HPP
+#define GHOTI_WAVE_IOURING_HPP
+
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <memory>
+#include <system_error>
+
+namespace Ghoti::Wave {
+
+/**
+ * A minimal wrapper around a Linux io_uring instance.
+ *
+ * The wrapper talks to the kernel directly (no liburing dependency) and only
+ * exposes the operations needed by the Server: multishot accept, multishot
+ * receive using a provided buffer ring, multishot poll, and (linked) sends.
+ *
+ * An IoUring object is not thread safe.  It is intended to be owned and
+ * driven by a single dispatch thread.
+ */
+class IoUring {
+  public:
+  /**
+   * The constructor.
+   *
+   * The constructor does not create the ring.  IoUring.init() must be called
+   * before the object can be used.
+   */
+  IoUring();
+
+  /**
+   * The destructor.
+   *
+   * Unmaps the rings and closes the io_uring handle.
+   */
+  ~IoUring();
+
+  IoUring(const IoUring &) = delete;
+  IoUring & operator=(const IoUring &) = delete;
+
+  /**
+   * Verify that the kernel supports the operations used by the Server.
+   *
+   * Multishot accept and multishot receive are newer than io_uring itself,
+   * and an older kernel only rejects them when they are first used.  The
+   * probe runs both on a temporary ring, over a loopback connection.
+   *
+   * @return The error code resulting from the probe (if any).
+   */
+  static std::error_code probe();
+
+  /**
+   * Create the io_uring instance and map its submission and completion
+   * queues.
+   *
+   * @param entries The requested number of submission queue entries.
+   * @return The error code resulting from the operation (if any).
+   */
+  std::error_code init(uint32_t entries);
+
+  /**
+   * Create and register a ring of provided buffers which the kernel will
+   * select from when completing a multishot receive.
+   *
+   * @param groupId The buffer group id.
+   * @param count The number of buffers.  Must be a power of 2.
+   * @param size The size of each buffer in bytes.
+   * @return The error code resulting from the operation (if any).
+   */
+  std::error_code registerBufferRing(uint16_t groupId, uint16_t count, uint32_t size);
+
+  /**
+   * Get a pointer to the memory of a provided buffer.
+   *
+   * @param bufferId The id of the buffer, as reported in the completion.
+   * @return A pointer to the beginning of the buffer.
+   */
+  char * getBuffer(uint16_t bufferId) const;
+
+  /**
+   * Return a provided buffer to the kernel so that it can be reused.
+   *
+   * @param bufferId The id of the buffer, as reported in the completion.
+   */
+  void recycleBuffer(uint16_t bufferId);
+
+  /**
+   * Queue a multishot accept on a listening socket.
+   *
+   * Accepted sockets are created as non-blocking.
+   *
+   * @param fd The listening socket.
+   * @param userData The value reported in each completion.
+   * @return `true` on success, `false` if the submission queue is full.
+   */
+  bool prepareAcceptMultishot(int fd, uint64_t userData);
+
+  /**
+   * Queue a multishot receive which selects its buffers from the registered
+   * buffer ring.
+   *
+   * @param fd The socket to receive from.
+   * @param userData The value reported in each completion.
+   * @return `true` on success, `false` if the submission queue is full.
+   */
+  bool prepareReceiveMultishot(int fd, uint64_t userData);
+
+  /**
+   * Queue a multishot poll for readability.
+   *
+   * @param fd The file handle to monitor.
+   * @param userData The value reported in each completion.
+   * @return `true` on success, `false` if the submission queue is full.
+   */
+  bool preparePollMultishot(int fd, uint64_t userData);
+
+  /**
+   * Queue a single poll for writability.
+   *
+   * @param fd The file handle to monitor.
+   * @param userData The value reported in the completion.
+   * @return `true` on success, `false` if the submission queue is full.
+   */
+  bool preparePollWritable(int fd, uint64_t userData);
+
+  /**
+   * Queue a send.
+   *
+   * @param fd The socket to send to.
+   * @param buffer The data to send, which must remain valid until the
+   *   completion is reported.
+   * @param length The number of bytes to send.
+   * @param userData The value reported in the completion.
+   * @param link Whether or not the next queued operation should only start
+   *   after this one has completed successfully.
+   * @return `true` on success, `false` if the submission queue is full.
+   */
+  bool prepareSend(int fd, const void * buffer, uint32_t length, uint64_t userData, bool link);
+
+  /**
+   * Submit all queued operations and optionally wait for completions.
+   *
+   * The kernel is asked again until it has consumed every queued operation,
+   * so that a short submission does not leave operations waiting in the
+   * ring while this call waits for their completions.
+   *
+   * @param waitFor The minimum number of completions to wait for.
+   * @return The error code resulting from the operation (if any).
+   */
+  std::error_code submit(uint32_t waitFor);
+
+  /**
+   * Get the oldest unprocessed completion, if any.
+   *
+   * @return The completion, or `nullptr` if there are no completions.
+   */
+  io_uring_cqe * peekCompletion();
+
+  /**
+   * Mark the completion returned by IoUring.peekCompletion() as processed.
+   */
+  void advanceCompletion();
+
+  /**
+   * Get the number of submission queue entries that are currently free.
+   *
+   * @return The number of free submission queue entries.
+   */
+  uint32_t getFreeSubmissionCount() const;
+
+  private:
+  /**
+   * Get a zeroed submission queue entry.
+   *
+   * @return The entry, or `nullptr` if the submission queue is full.
+   */
+  io_uring_sqe * getSubmission();
+
+  /**
+   * The io_uring handle.
+   */
+  int hRing;
+
+  /**
+   * The mapped submission queue ring.
+   */
+  void * sqRing;
+
+  /**
+   * The size of the mapped submission queue ring.
+   */
+  size_t sqRingSize;
+
+  /**
+   * The mapped completion queue ring.
+   *
+   * This may be the same mapping as `sqRing`.
+   */
+  void * cqRing;
+
+  /**
+   * The size of the mapped completion queue ring.
+   */
+  size_t cqRingSize;
+
+  /**
+   * The mapped array of submission queue entries.
+   */
+  io_uring_sqe * sqes;
+
+  /**
+   * The number of submission queue entries.
+   */
+  uint32_t sqEntries;
+
+  /**
+   * Pointers into the shared submission queue ring.
+   */
+  uint32_t * sqHead;
+  uint32_t * sqTail;
+  uint32_t * sqMask;
+  uint32_t * sqArray;
+
+  /**
+   * Pointers into the shared completion queue ring.
+   */
+  uint32_t * cqHead;
+  uint32_t * cqTail;
+  uint32_t * cqMask;
+  io_uring_cqe * cqes;
+
+  /**
+   * The number of entries handed out by getSubmission() but not yet
+   * submitted.
+   */
+  uint32_t sqPending;
+
+  /**
+   * The local copy of the submission queue tail.
+   */
+  uint32_t sqLocalTail;
+
+  /**
+   * The provided buffer ring shared with the kernel.
+   */
+  io_uring_buf_ring * bufferRing;
+
+  /**
+   * The number of buffers in the provided buffer ring.
+   */
+  uint16_t bufferCount;
+
+  /**
+   * The size in bytes of each provided buffer.
+   */
+  uint32_t bufferSize;
+
+  /**
+   * The buffer group id of the provided buffer ring.
+   */
+  uint16_t bufferGroup;
+
+  /**
+   * The local copy of the provided buffer ring tail.
+   */
+  uint16_t bufferTail;
+
+  /**
+   * The memory backing the provided buffers.
+   */
+  std::unique_ptr<char[]> buffers;
+};
+
+}
+
+#endif // GHOTI_WAVE_IOURING_HPP
+
@@ -0,0 +1,466 @@
+/**
+ * @file
+ *
+ * Header file for declaring the well-known field names, methods, and status
+ * codes.
+ */
+
+#ifndef GHOTI_WAVE_KNOWNNAMES_HPP
+#define GHOTI_WAVE_KNOWNNAMES_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <ghoti.io/util/shared_string_view.hpp>
+
+namespace Ghoti::Wave {
+
+/**
+ * Well-known HTTP field names.
+ *
+ * Field names are case-insensitive, so each ID stands for every spelling of
+ * its name.
+ */
+enum class FieldName : uint8_t {
+  UNKNOWN, ///< The field name is not one of the well-known names.
+  ACCEPT,
+  ACCEPT_CHARSET,
+  ACCEPT_ENCODING,
+  ACCEPT_LANGUAGE,
+  ACCEPT_RANGES,
+  AGE,
+  ALLOW,
+  AUTHENTICATION_INFO,
+  AUTHORIZATION,
+  CACHE_CONTROL,
+  CONNECTION,
+  CONTENT_ENCODING,
+  CONTENT_LANGUAGE,
+  CONTENT_LENGTH,
+  CONTENT_LOCATION,
+  CONTENT_RANGE,
+  CONTENT_TYPE,
+  COOKIE,
+  DATE,
+  ETAG,
+  EXPECT,
+  EXPIRES,
+  FROM,
+  HOST,
+  IF_MATCH,
+  IF_MODIFIED_SINCE,
+  IF_NONE_MATCH,
+  IF_RANGE,
+  IF_UNMODIFIED_SINCE,
+  KEEP_ALIVE,
+  LAST_MODIFIED,
+  LOCATION,
+  MAX_FORWARDS,
+  ORIGIN,
+  PRAGMA,
+  PROXY_AUTHENTICATE,
+  PROXY_AUTHENTICATION_INFO,
+  PROXY_AUTHORIZATION,
+  RANGE,
+  REFERER,
+  RETRY_AFTER,
+  SERVER,
+  SET_COOKIE,
+  TE,
+  TRAILER,
+  TRANSFER_ENCODING,
+  UPGRADE,
+  USER_AGENT,
+  VARY,
+  VIA,
+  WWW_AUTHENTICATE,
+};
+
+/**
+ * The number of FieldName values, including FieldName::UNKNOWN.
+ */
+constexpr size_t FIELD_NAME_COUNT{static_cast<size_t>(FieldName::WWW_AUTHENTICATE) + 1};
+
+/**
+ * Well-known HTTP request methods.
+ *
+ * https://www.rfc-editor.org/rfc/rfc9110#name-overview
+ * PATCH - https://www.rfc-editor.org/rfc/rfc5789
+ */
+enum class Method : uint8_t {
+  UNKNOWN, ///< The method is not one of the well-known methods.
+  GET,
+  HEAD,
+  POST,
+  PUT,
+  DELETE,
+  CONNECT,
+  OPTIONS,
+  TRACE,
+  PATCH,
+};
+
+/**
+ * The number of Method values, including Method::UNKNOWN.
+ */
+constexpr size_t METHOD_COUNT{static_cast<size_t>(Method::PATCH) + 1};
+
+/**
+ * The uppercase text of each FieldName, indexed by its value.
+ */
+inline constexpr std::array<std::string_view, FIELD_NAME_COUNT> fieldNameTexts{
+  "",
+  "ACCEPT",
+  "ACCEPT-CHARSET",
+  "ACCEPT-ENCODING",
+  "ACCEPT-LANGUAGE",
+  "ACCEPT-RANGES",
+  "AGE",
+  "ALLOW",
+  "AUTHENTICATION-INFO",
+  "AUTHORIZATION",
+  "CACHE-CONTROL",
+  "CONNECTION",
+  "CONTENT-ENCODING",
+  "CONTENT-LANGUAGE",
+  "CONTENT-LENGTH",
+  "CONTENT-LOCATION",
+  "CONTENT-RANGE",
+  "CONTENT-TYPE",
+  "COOKIE",
+  "DATE",
+  "ETAG",
+  "EXPECT",
+  "EXPIRES",
+  "FROM",
+  "HOST",
+  "IF-MATCH",
+  "IF-MODIFIED-SINCE",
+  "IF-NONE-MATCH",
+  "IF-RANGE",
+  "IF-UNMODIFIED-SINCE",
+  "KEEP-ALIVE",
+  "LAST-MODIFIED",
+  "LOCATION",
+  "MAX-FORWARDS",
+  "ORIGIN",
+  "PRAGMA",
+  "PROXY-AUTHENTICATE",
+  "PROXY-AUTHENTICATION-INFO",
+  "PROXY-AUTHORIZATION",
+  "RANGE",
+  "REFERER",
+  "RETRY-AFTER",
+  "SERVER",
+  "SET-COOKIE",
+  "TE",
+  "TRAILER",
+  "TRANSFER-ENCODING",
+  "UPGRADE",
+  "USER-AGENT",
+  "VARY",
+  "VIA",
+  "WWW-AUTHENTICATE",
+};
+
+/**
+ * The text of each Method, indexed by its value.
+ */
+inline constexpr std::array<std::string_view, METHOD_COUNT> methodTexts{
+  "",
+  "GET",
+  "HEAD",
+  "POST",
+  "PUT",
+  "DELETE",
+  "CONNECT",
+  "OPTIONS",
+  "TRACE",
+  "PATCH",
+};
+
+/**
+ * A standard HTTP status code and its reason phrase.
+ */
+struct StatusReason {
+  uint16_t code;          ///< The status code.
+  std::string_view text;  ///< The reason phrase.
+};
+
+/**
+ * The standard HTTP status codes.
+ *
+ * https://www.rfc-editor.org/rfc/rfc9110#name-status-codes
+ * 428, 429, 431, 511 - https://www.rfc-editor.org/rfc/rfc6585
+ */
+inline constexpr auto statusReasons{std::to_array<StatusReason>({
+  {100, "Continue"},
+  {101, "Switching Protocols"},
+  {200, "OK"},
+  {201, "Created"},
+  {202, "Accepted"},
+  {203, "Non-Authoritative Information"},
+  {204, "No Content"},
+  {205, "Reset Content"},
+  {206, "Partial Content"},
+  {300, "Multiple Choices"},
+  {301, "Moved Permanently"},
+  {302, "Found"},
+  {303, "See Other"},
+  {304, "Not Modified"},
+  {305, "Use Proxy"},
+  {307, "Temporary Redirect"},
+  {308, "Permanent Redirect"},
+  {400, "Bad Request"},
+  {401, "Unauthorized"},
+  {402, "Payment Required"},
+  {403, "Forbidden"},
+  {404, "Not Found"},
+  {405, "Method Not Allowed"},
+  {406, "Not Acceptable"},
+  {407, "Proxy Authentication Required"},
+  {408, "Request Timeout"},
+  {409, "Conflict"},
+  {410, "Gone"},
+  {411, "Length Required"},
+  {412, "Precondition Failed"},
+  {413, "Content Too Large"},
+  {414, "URI Too Long"},
+  {415, "Unsupported Media Type"},
+  {416, "Range Not Satisfiable"},
+  {417, "Expectation Failed"},
+  {421, "Misdirected Request"},
+  {422, "Unprocessable Content"},
+  {426, "Upgrade Required"},
+  {428, "Precondition Required"},
+  {429, "Too Many Requests"},
+  {431, "Request Header Fields Too Large"},
+  {500, "Internal Server Error"},
+  {501, "Not Implemented"},
+  {502, "Bad Gateway"},
+  {503, "Service Unavailable"},
+  {504, "Gateway Timeout"},
+  {505, "HTTP Version Not Supported"},
+  {511, "Network Authentication Required"},
+})};
+
+namespace KnownNames {
+
+/**
+ * Convert an ASCII letter to uppercase.
+ *
+ * Unlike `toupper()`, this does not depend on the locale.
+ *
+ * @param c The character.
+ * @result The uppercase character.
+ */
+constexpr uint8_t toUpper(char c) {
+  return ((c >= 'a') && (c <= 'z')) ? c - ('a' - 'A') : c;
+}
+
+/**
+ * Hash a name, ignoring case (FNV-1a).
+ *
+ * @param text The name.
+ * @param seed The starting value of the hash.
+ * @result The hash value.
+ */
+constexpr uint32_t hash(std::string_view text, uint32_t seed) {
+  for (char c : text) {
+    seed = (seed ^ toUpper(c)) * 16777619u;
+  }
+  return seed ^ (seed >> 15);
+}
+
+/**
+ * A collision-free hash table of names.
+ *
+ * Each slot holds the index of the name which hashes to it, or 0 if no name
+ * does.
+ *
+ * @tparam SIZE The number of slots, which must be a power of two.
+ */
+template <size_t SIZE>
+struct PerfectHashTable {
+  static_assert((SIZE & (SIZE - 1)) == 0, "The table size must be a power of two.");
+
+  /**
+   * The hash seed for which the names do not collide.
+   */
+  uint32_t seed;
+
+  /**
+   * The name index for each hash slot.
+   */
+  std::array<uint8_t, SIZE> slots;
+
+  /**
+   * Find the slot for a name.
+   *
+   * @param text The name.
+   * @result The index of the only name which could match `text`, or 0.
+   */
+  constexpr uint8_t find(std::string_view text) const {
+    return this->slots[hash(text, this->seed) & (SIZE - 1)];
+  }
+};
+
+/**
+ * Search for a hash seed for which none of the names collide.
+ *
+ * This is only intended to be evaluated at compile time.  Entry 0 of `names`
+ * is the placeholder for an unknown name, and is not added to the table.
+ *
+ * @param names The names.
+ * @result The hash table.
+ */
+template <size_t SIZE, size_t COUNT>
+consteval PerfectHashTable<SIZE> makePerfectHashTable(const std::array<std::string_view, COUNT> & names) {
+  for (uint32_t seed = 2166136261u; ; ++seed) {
+    PerfectHashTable<SIZE> table{seed, {}};
+    bool collision{false};
+    for (size_t i = 1; !collision && (i < COUNT); ++i) {
+      auto & slot = table.slots[hash(names[i], seed) & (SIZE - 1)];
+      collision = slot;
+      slot = i;
+    }
+    if (!collision) {
+      return table;
+    }
+  }
+}
+
+/**
+ * Compare two names, ignoring case.
+ *
+ * @param a The first name.
+ * @param b The second name.
+ * @result Whether or not the names match.
+ */
+constexpr bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.length() != b.length()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.length(); ++i) {
+    if (toUpper(a[i]) != toUpper(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * The hash table of field names.
+ */
+inline constexpr auto fieldNameTable{makePerfectHashTable<512>(fieldNameTexts)};
+
+/**
+ * The hash table of methods.
+ */
+inline constexpr auto methodTable{makePerfectHashTable<32>(methodTexts)};
+
+}
+
+/**
+ * Identify a well-known field name, ignoring case.
+ *
+ * @param name The field name.
+ * @result The FieldName, or FieldName::UNKNOWN.
+ */
+constexpr FieldName lookupFieldName(std::string_view name) {
+  auto index = KnownNames::fieldNameTable.find(name);
+  return (index && KnownNames::equalsIgnoreCase(fieldNameTexts[index], name))
+    ? static_cast<FieldName>(index)
+    : FieldName::UNKNOWN;
+}
+
+/**
+ * Identify a well-known method.
+ *
+ * Methods are case-sensitive.
+ * https://www.rfc-editor.org/rfc/rfc9110#section-9.1-5
+ *
+ * @param method The method.
+ * @result The Method, or Method::UNKNOWN.
+ */
+constexpr Method lookupMethod(std::string_view method) {
+  auto index = KnownNames::methodTable.find(method);
+  return (index && (methodTexts[index] == method))
+    ? static_cast<Method>(index)
+    : Method::UNKNOWN;
+}
+
+/**
+ * Identify a field as accepting a list-based set of values.
+ * https://datatracker.ietf.org/doc/html/rfc9110
+ *
+ * @param name The field name.
+ * @result Whether or not the field is recognized as a list-based field.
+ */
+constexpr bool isListField(FieldName name) {
+  switch (name) {
+    case FieldName::ACCEPT:
+    case FieldName::ACCEPT_CHARSET:
+    case FieldName::ACCEPT_ENCODING:
+    case FieldName::ACCEPT_LANGUAGE:
+    case FieldName::ACCEPT_RANGES:
+    case FieldName::ALLOW:
+    case FieldName::AUTHENTICATION_INFO:
+    case FieldName::CONNECTION:
+    case FieldName::CONTENT_ENCODING:
+    case FieldName::CONTENT_LANGUAGE:
+    case FieldName::EXPECT:
+    case FieldName::IF_MATCH:
+    case FieldName::IF_NONE_MATCH:
+    case FieldName::PROXY_AUTHENTICATE:
+    case FieldName::PROXY_AUTHENTICATION_INFO:
+    case FieldName::TE:
+    case FieldName::TRAILER:
+    case FieldName::TRANSFER_ENCODING:
+    case FieldName::UPGRADE:
+    case FieldName::VARY:
+    case FieldName::VIA:
+    case FieldName::WWW_AUTHENTICATE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * Get the HTTP/1.1 status line of a standard status code, such as
+ * `"HTTP/1.1 404 Not Found\r\n"`.
+ *
+ * The status lines are rendered once, so using one does not allocate.
+ *
+ * @param statusCode The status code.
+ * @result The status line, or an empty view if the status code is not one of
+ *   the standard codes.
+ */
+std::string_view getStatusLine(size_t statusCode);
+
+/**
+ * Get the uppercase text of a well-known field name, as a shared string.
+ *
+ * The strings are shared, so using one does not allocate.
+ *
+ * @param name The field name.
+ * @result The uppercase field name.
+ */
+const Ghoti::shared_string_view & getFieldNameText(FieldName name);
+
+/**
+ * Get the text of a well-known method, as a shared string.
+ *
+ * The strings are shared, so using one does not allocate.
+ *
+ * @param method The method.
+ * @result The method.
+ */
+const Ghoti::shared_string_view & getMethodText(Method method);
+
+}
+
+#endif // GHOTI_WAVE_KNOWNNAMES_HPP
+
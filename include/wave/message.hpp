@@ -7,7 +7,7 @@
 #ifndef GHOTI_WAVE_MESSAGE_HPP
 #define GHOTI_WAVE_MESSAGE_HPP
 
-#include <map>
+#include <memory>
 #include <ostream>
 #include <semaphore>
 #include <string>
@@ -15,6 +15,10 @@
 #include <ghoti.io/util/hasParameters.hpp>
 #include <ghoti.io/util/shared_string_view.hpp>
 #include "wave/blob.hpp"
+#include "wave/bodyStream.hpp"
+#include "wave/fieldCollection.hpp"
+#include "wave/knownNames.hpp"
+#include "wave/target.hpp"
 
 namespace Ghoti::Wave {
 /**
@@ -105,6 +109,15 @@ class Message : public HasMessageParameters {
    */
   void adoptContents(Message & source);
 
+  /**
+   * Restore the message to the state of a newly constructed Message of the
+   * same Message::Type, so that it can be reused.
+   *
+   * The storage of the header and trailer fields (and of the chunk list) is
+   * kept, so that a reused message does not need to allocate it again.
+   */
+  void reset();
+
   /**
    * Get the HTTP/1.1 rendered header as a string.
    *
@@ -112,6 +125,17 @@ class Message : public HasMessageParameters {
    */
   const Ghoti::shared_string_view & getRenderedHeader1();
 
+  /**
+   * Get the HTTP/1.1 rendered header, followed by the Content-Length field
+   * and the empty line which ends the header.
+   *
+   * The whole block is rendered into a single buffer.
+   *
+   * @param contentLength The length of the message body.
+   * @return A string containing the complete HTTP/1.1 header.
+   */
+  Ghoti::shared_string_view getRenderedHeader1(size_t contentLength);
+
   /**
    * Indicates that the message has an error.
    *
@@ -174,9 +198,19 @@ class Message : public HasMessageParameters {
    */
   const Ghoti::shared_string_view & getMethod() const;
 
+  /**
+   * Get the HTTP method of the message as a Method ID.
+   *
+   * @return The Method, or Method::UNKNOWN if it is not a well-known method.
+   */
+  Method getMethodId() const;
+
   /**
    * Set the URL target of the message.
    *
+   * The target is split into its components (see getParsedTarget()) as it
+   * is set.
+   *
    * @param target The URL target.
    * @return The Message object.
    */
@@ -189,6 +223,14 @@ class Message : public HasMessageParameters {
    */
   const Ghoti::shared_string_view & getTarget() const;
 
+  /**
+   * Get the URL target of the message, split into its components (path,
+   * query parameters, etc.).
+   *
+   * @return The parsed URL target.
+   */
+  const Target & getParsedTarget() const;
+
   /**
    * Set the HTTP version of the message.
    *
@@ -213,6 +255,29 @@ class Message : public HasMessageParameters {
    */
   Message & addFieldValue(const Ghoti::shared_string_view & name, const Ghoti::shared_string_view & value);
 
+  /**
+   * Add a header key/value pair whose name has already been identified.
+   *
+   * @param id The FieldName of `name`.
+   * @param name The field name.
+   * @param value The field value.
+   * @return The Message object.
+   */
+  Message & addFieldValue(FieldName id, const Ghoti::shared_string_view & name, Ghoti::shared_string_view value);
+
+  /**
+   * Add the whole value of a header list field, to be split into its
+   * elements only if the field is accessed.
+   *
+   * See FieldCollection.addUnparsed().
+   *
+   * @param id The FieldName of `name`.
+   * @param name The field name.
+   * @param value The unparsed field value.
+   * @return The Message object.
+   */
+  Message & addUnparsedFieldValue(FieldName id, const Ghoti::shared_string_view & name, Ghoti::shared_string_view value);
+
   /**
    * Add a trailer key/value pair.
    *
@@ -223,18 +288,39 @@ class Message : public HasMessageParameters {
   Message & addTrailerFieldValue(const Ghoti::shared_string_view & name, const Ghoti::shared_string_view & value);
 
   /**
-   * Get the map of all header field key/value pairs.
+   * Add the whole value of a trailer list field, to be split into its
+   * elements only if the field is accessed.
+   *
+   * See FieldCollection.addUnparsed().
+   *
+   * @param id The FieldName of `name`.
+   * @param name The field name.
+   * @param value The unparsed field value.
+   * @return The Message object.
+   */
+  Message & addUnparsedTrailerFieldValue(FieldName id, const Ghoti::shared_string_view & name, Ghoti::shared_string_view value);
+
+  /**
+   * Get all header field key/value pairs.
    *
    * fields[field name] = [field value]
    */
-  const std::map<Ghoti::shared_string_view, std::vector<Ghoti::shared_string_view>> & getFields() const;
+  const FieldCollection & getFields() const;
 
   /**
-   * Get the map of all trailer field key/value pairs.
+   * Get the values of a well-known header field, without searching for it.
+   *
+   * @param name The field name.
+   * @return The field values, which is empty if the field is not present.
+   */
+  FieldCollection::Values getFieldValues(FieldName name) const;
+
+  /**
+   * Get all trailer field key/value pairs.
    *
    * fields[field name] = [field value]
    */
-  const std::map<Ghoti::shared_string_view, std::vector<Ghoti::shared_string_view>> & getTrailerFields() const;
+  const FieldCollection & getTrailerFields() const;
 
   /**
    * Set the content body of the message.
@@ -344,6 +430,24 @@ class Message : public HasMessageParameters {
    */
   const std::vector<Ghoti::Wave::Blob> & getChunks() const;
 
+  /**
+   * Attach the stream through which the body will be delivered.
+   *
+   * @param bodyStream The stream.
+   * @return The Message object.
+   */
+  Message & setBodyStream(std::shared_ptr<Ghoti::Wave::BodyStream> bodyStream);
+
+  /**
+   * Get the stream through which the body is delivered, if the message was
+   * passed on before its body was received.
+   *
+   * If there is no stream, then the body (if any) is already complete.
+   *
+   * @return The stream, or `nullptr`.
+   */
+  const std::shared_ptr<Ghoti::Wave::BodyStream> & getBodyStream() const;
+
   private:
   /**
    * Used to track whether or not the header has been rendered to a string.
@@ -422,6 +526,11 @@ class Message : public HasMessageParameters {
    */
   Ghoti::shared_string_view method;
 
+  /**
+   * The Method ID of the HTTP method.
+   */
+  Method methodId;
+
   /**
    * The domain target of the message.
    */
@@ -430,7 +539,7 @@ class Message : public HasMessageParameters {
   /**
    * The URL target of the message.
    */
-  Ghoti::shared_string_view target;
+  Target target;
 
   /**
    * The HTTP version of the message.
@@ -448,19 +557,24 @@ class Message : public HasMessageParameters {
    */
   std::vector<Ghoti::Wave::Blob> chunks;
 
+  /**
+   * The stream through which the body is delivered, if any.
+   */
+  std::shared_ptr<Ghoti::Wave::BodyStream> bodyStream;
+
   /**
    * A collection of headers and their associated values.
    *
    * `headers[field name] = [field value]`
    */
-  std::map<Ghoti::shared_string_view, std::vector<Ghoti::shared_string_view>> headers;
+  FieldCollection headers;
 
   /**
    * A collection of trailers and their associated values.
    *
    * `trailer[field name] = [field value]`
    */
-  std::map<Ghoti::shared_string_view, std::vector<Ghoti::shared_string_view>> trailers;
+  FieldCollection trailers;
 
   /**
    * The semaphore used for asynchronous notification of when the message
@@ -0,0 +1,95 @@
+/**
+ * @file
+ *
+ * Header file for declaring the MessagePool class.
+ */
+
+#ifndef GHOTI_WAVE_MESSAGEPOOL_HPP
+#define GHOTI_WAVE_MESSAGEPOOL_HPP
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "wave/message.hpp"
+
+namespace Ghoti::Wave {
+
+/**
+ * A free list of Message objects.
+ *
+ * A Message acquired from the pool is returned to it, reset, as soon as the
+ * last reference to it is released (e.g., once its response has been
+ * written).  A reused Message keeps the storage of its header fields, so that
+ * a busy connection does not construct, allocate, and destroy a Message for
+ * every request and response.
+ *
+ * Messages may be acquired and released from any thread, and may outlive the
+ * pool.
+ */
+class MessagePool : public std::enable_shared_from_this<MessagePool> {
+  public:
+  /**
+   * The constructor.
+   *
+   * @param maxFree The maximum number of released messages of each
+   *   Message::Type that will be kept for reuse.  Any additional messages are
+   *   destroyed when they are released.
+   */
+  MessagePool(size_t maxFree = 256);
+
+  /**
+   * Get a message from the pool, constructing a new one if none are free.
+   *
+   * The pool must be owned by a `std::shared_ptr`.
+   *
+   * @param type The Message::Type of the message.
+   * @return A message, in the state of a newly constructed Message.
+   */
+  std::shared_ptr<Message> acquire(Message::Type type);
+
+  private:
+  /**
+   * Returns a message to its pool when the last reference to it is released.
+   */
+  struct Releaser {
+    /**
+     * The pool from which the message was acquired.
+     */
+    std::weak_ptr<MessagePool> pool;
+
+    /**
+     * Return the message to the pool, or destroy it if the pool no longer
+     * exists.
+     *
+     * @param message The message.
+     */
+    void operator()(Message * message) const;
+  };
+
+  /**
+   * Reset a message and add it to the free list.
+   *
+   * @param message The message.
+   */
+  void release(std::unique_ptr<Message> && message);
+
+  /**
+   * The maximum number of messages kept in each list of `freeMessages`.
+   */
+  size_t maxFree;
+
+  /**
+   * Used to synchronize access to `freeMessages`.
+   */
+  std::mutex controlMutex;
+
+  /**
+   * The messages which are available to be reused, by Message::Type.
+   */
+  std::array<std::vector<std::unique_ptr<Message>>, 3> freeMessages;
+};
+
+}
+
+#endif // GHOTI_WAVE_MESSAGEPOOL_HPP
@@ -0,0 +1,84 @@
+/**
+ * @file
+ *
+ * Header file for declaring the OutputQueue class.
+ */
+
+#ifndef GHOTI_WAVE_OUTPUTQUEUE_HPP
+#define GHOTI_WAVE_OUTPUTQUEUE_HPP
+
+#include <deque>
+#include <system_error>
+#include "wave/outputSegment.hpp"
+
+namespace Ghoti::Wave {
+
+/**
+ * The serialized output of a session which has not yet been written to its
+ * socket.
+ *
+ * Messages are serialized into the queue once, and the queue is then drained
+ * across as many write attempts as the socket requires, so a slow reader
+ * never causes a message to be serialized again.
+ *
+ * It is up to the caller to synchronize access to the queue.
+ */
+class OutputQueue {
+  public:
+  /**
+   * The constructor.
+   */
+  OutputQueue();
+
+  /**
+   * Append a segment to the end of the queue.
+   *
+   * @param segment The segment to append.
+   */
+  void push(OutputSegment && segment);
+
+  /**
+   * Append the contents of a Blob to the end of the queue.
+   *
+   * See OutputSegment::fromBlob().
+   *
+   * @param blob The Blob to append.
+   */
+  void push(const Blob & blob);
+
+  /**
+   * Whether or not all queued output has been written.
+   *
+   * @return `true` if there is nothing left to write.
+   */
+  bool empty() const;
+
+  /**
+   * Write as much of the queued output as the socket will accept.
+   *
+   * In-memory segments are gathered into a single `sendmsg()` call, and
+   * file segments are sent with `sendfile()`.  The function returns when the
+   * queue is empty or the socket would block.
+   *
+   * @param hSocket The (non-blocking) socket handle.
+   * @return An error code if the socket could not be written to.
+   */
+  std::error_code sendTo(int hSocket);
+
+  private:
+  /**
+   * The segments which have not been completely written.
+   */
+  std::deque<OutputSegment> segments;
+
+  /**
+   * The number of bytes of the first segment which have already been
+   * written.
+   */
+  size_t offset;
+};
+
+}
+
+#endif // GHOTI_WAVE_OUTPUTQUEUE_HPP
+
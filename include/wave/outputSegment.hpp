@@ -0,0 +1,138 @@
+/**
+ * @file
+ *
+ * Header file for declaring the OutputSegment class.
+ */
+
+#ifndef GHOTI_WAVE_OUTPUTSEGMENT_HPP
+#define GHOTI_WAVE_OUTPUTSEGMENT_HPP
+
+#include <ghoti.io/util/shared_string_view.hpp>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+#include "wave/blob.hpp"
+
+namespace Ghoti::Wave {
+
+/**
+ * A contiguous piece of serialized output waiting to be written to a socket.
+ *
+ * A segment either references text in memory, or the contents of a file.  A
+ * file segment holds its own open handle to the file, so the contents remain
+ * available even if the Blob which produced it is destroyed (and the file is
+ * removed), and they are sent with `sendfile()` rather than being read into
+ * memory first.
+ */
+class OutputSegment {
+  public:
+  /**
+   * Construct a segment which references text in memory.
+   *
+   * @param text The text to send.
+   */
+  OutputSegment(const Ghoti::shared_string_view & text);
+
+  /**
+   * Construct the segments which send the contents of a Blob.
+   *
+   * A text Blob produces one segment for each view from which its text was
+   * appended, so that the views are gathered by OutputQueue.sendTo() rather
+   * than being joined first.  A file-backed Blob produces a single segment.
+   * Its file is opened immediately, and if it cannot be opened, then
+   * OutputSegment.sendTo() will report the error.
+   *
+   * @param blob The Blob to send.
+   * @return The segments.
+   */
+  static std::vector<OutputSegment> fromBlob(const Blob & blob);
+
+  /**
+   * The move constructor.
+   *
+   * @param source The segment to move from.
+   */
+  OutputSegment(OutputSegment && source);
+
+  /**
+   * The move assignment operator.
+   *
+   * @param source The segment to move from.
+   * @return The segment.
+   */
+  OutputSegment & operator=(OutputSegment && source);
+
+  /**
+   * The destructor.
+   *
+   * Closes the file handle, if any.
+   */
+  ~OutputSegment();
+
+  OutputSegment(const OutputSegment &) = delete;
+  OutputSegment & operator=(const OutputSegment &) = delete;
+
+  /**
+   * Get the total length of the segment in bytes.
+   *
+   * @return The length of the segment.
+   */
+  size_t length() const;
+
+  /**
+   * Whether or not the segment is sent from a file.
+   *
+   * @return `true` if the segment is file-backed.
+   */
+  bool isFile() const;
+
+  /**
+   * Get the text of a segment which is not file-backed.
+   *
+   * @return The text of the segment.
+   */
+  std::string_view getText() const;
+
+  /**
+   * Write as much of the segment as the socket will accept in a single call,
+   * starting at `offset`.
+   *
+   * @param hSocket The socket handle.
+   * @param offset The number of bytes of the segment already written.
+   * @return The number of bytes written, or -1 (with `errno` set) on error.
+   */
+  ssize_t sendTo(int hSocket, size_t offset) const;
+
+  private:
+  /**
+   * Construct a segment which sends the file of a file-backed Blob.
+   *
+   * @param blob The Blob to send.
+   */
+  OutputSegment(const Blob & blob);
+
+  /**
+   * The text of the segment, if it is not file-backed.
+   */
+  Ghoti::shared_string_view text;
+
+  /**
+   * The file handle of a file-backed segment, or -1.
+   */
+  int hFile;
+
+  /**
+   * The `errno` value from opening the file, or 0.
+   */
+  int fileError;
+
+  /**
+   * The length of the file contents which will be sent.
+   */
+  size_t fileLength;
+};
+
+}
+
+#endif // GHOTI_WAVE_OUTPUTSEGMENT_HPP
+
@@ -1,23 +1,32 @@
 /**
  * @file
  *
- * Header file for declaring the Session class.
+ * Header file for declaring the Parser classes.
  */
 
 #ifndef GHOTI_WAVE_PARSER_HPP
 #define GHOTI_WAVE_PARSER_HPP
 
 #include <queue>
+#include <string>
+#include <system_error>
+#include <vector>
 #include <ghoti.io/util/shared_string_view.hpp>
 #include "wave/blob.hpp"
 #include "wave/hasClientParameters.hpp"
 #include "wave/hasServerParameters.hpp"
+#include "wave/knownNames.hpp"
 #include "wave/message.hpp"
+#include "wave/messagePool.hpp"
 
 namespace Ghoti::Wave {
 
 /**
- * Parses a HTTP/1.1 data stream into discrete messages.
+ * The state shared by every HTTP/1.1 parser, regardless of the type of
+ * message stream.
+ *
+ * The state machine itself is implemented by BasicParser, which is specialized
+ * for each type of stream.
  */
 class Parser {
   public:
@@ -29,27 +38,80 @@ class Parser {
     RESPONSE, ///< This is a Response stream.
   };
 
+  Parser(const Parser &) = delete;
+  Parser & operator=(const Parser &) = delete;
+
   /**
-   * The constructor.
+   * The destructor.
+   */
+  virtual ~Parser();
+
+  /**
+   * Enable or disable the single-pass fast path.
    *
-   * HTTP/1.1 streams do not have an interchangeable syntax, so the stream type
-   * must be declared.
+   * When enabled (the default), a header block which has been received in its
+   * entirety is parsed in one pass, and the resumable state machine is only
+   * used for partial or unusual input.  Both produce the same messages, so
+   * this is only useful for testing and benchmarking.
    *
-   * The stream will accept an array of bytes, and it will remember its
-   * previous parsing position.
+   * @param enabled Whether or not to use the fast path.
+   */
+  void setFastPath(bool enabled);
+
+  /**
+   * Enable or disable streaming of message bodies.
    *
-   * @param type The Parser::Type of the message stream.
+   * When enabled, a message with a body is added to `messages` as soon as its
+   * header has been parsed, and the body is passed through the message's
+   * BodyStream as it is received rather than being collected.
+   *
+   * @param enabled Whether or not to stream message bodies.
    */
-  Parser(Type type);
+  void setStreaming(bool enabled);
 
   /**
-   * Process a block of data.
+   * Enable or disable lazy parsing of list field values.
    *
-   * @param buffer The buffer to be processed.
-   * @param len The length of the buffer in bytes.
+   * When enabled, the value of a list field (e.g., `Accept`) is only checked
+   * for valid characters, and is stored whole.  It is split into its elements
+   * (and any quoted elements unescaped) only if the field is accessed.  Some
+   * malformed lists are then no longer reported as errors.
+   *
+   * @param enabled Whether or not to parse list field values lazily.
    */
-  void processBlock(const char * buffer, size_t len);
-  void parseMessageTarget(const Ghoti::shared_string_view & target);
+  void setLazyFields(bool enabled);
+
+  /**
+   * Enable or disable the preservation of chunk boundaries.
+   *
+   * When disabled (the default), the chunks of a chunked body are coalesced
+   * into the message body, just as if it had been received with a fixed
+   * length.  When enabled, each chunk is stored separately, in
+   * Message.getChunks().
+   *
+   * @param enabled Whether or not to keep each chunk separately.
+   */
+  void setPreserveChunks(bool enabled);
+
+  /**
+   * Set the directory in which a message body (or chunk) is stored once it
+   * grows beyond MEMCHUNKSIZELIMIT.
+   *
+   * The file is anonymous, so nothing is ever visible in the directory.
+   * Putting it on a tmpfs or a fast local disk may speed up large uploads.
+   *
+   * @param directory The directory, or empty (the default) for the OS temp
+   *   directory.
+   */
+  void setSpillDirectory(const std::string & directory);
+
+  /**
+   * Set the pool from which new messages are taken.
+   *
+   * @param messagePool The pool, or `nullptr` (the default) to construct
+   *   every message.
+   */
+  void setMessagePool(std::shared_ptr<MessagePool> messagePool);
 
   /**
    * Use the provided Message as the recipient of parsing for the Message's id.
@@ -68,14 +130,19 @@ class Parser {
    */
   std::queue<std::shared_ptr<Message>> messages;
 
-  private:
-
+  protected:
   /**
-   * Return the parameter value for MEMCHUNKSIZELIMIT.
+   * The constructor.
    *
-   * @return The parameter value.
+   * HTTP/1.1 streams do not have an interchangeable syntax, so the stream type
+   * must be declared.
+   *
+   * The stream will accept an array of bytes, and it will remember its
+   * previous parsing position.
+   *
+   * @param type The Parser::Type of the message stream.
    */
-  virtual uint32_t getMEMCHUNKSIZELIMIT() = 0;
+  Parser(Type type);
 
   /**
    * Primary state tracking values.
@@ -137,23 +204,14 @@ class Parser {
     MESSAGE_START,             ///< Message started.
     MESSAGE_READ,              ///< Message being read.
     CHUNK_START,               ///< The beginning of a new chunk.
-    CHUNK_SIZE,                ///< Chunk header being read.
-    AFTER_CHUNK_SIZE,          ///< Chunk size is read, extensions may follow.
-    CHUNK_EXTENSIONS_IDENTIFIER, ///< Identifies that a chunk extension will
-                                 ///<   follow.
-    CHUNK_EXTENSIONS,          ///< Chunk Extensions being read.
-    AFTER_CHUNK_EXTENSIONS,    ///< Newline after chunk extensions.
+    CHUNK_SIZE,                ///< Chunk size line (with any extensions)
+                               ///<   being read.
     CHUNK_BODY,                ///< Chunk body being read.
     AFTER_CHUNK_BODY,          ///< Chunk body is complete.
     TRAILER_FINISHED,          ///< The trailer section is finished.
     MESSAGE_FINISHED,          ///< The message is finished.
   };
 
-  /**
-   * The Parser::Type of HTTP/1.1 stream that will be processed.
-   */
-  Type type;
-
   /**
    * An internal counter that indicates the character currently being
    * processed.
@@ -181,11 +239,30 @@ class Parser {
   size_t minorStart;
 
   /**
-   * The input string, stored internally so that the stream will be processed
-   * correctly, even if it is split across multiple buffered reads.
+   * The input which has not yet been consumed, stored internally so that the
+   * stream will be processed correctly, even if it is split across multiple
+   * buffered reads.
+   *
+   * The cursor positions are relative to the start of this view.
    */
   Ghoti::shared_string_view input;
 
+  /**
+   * Blocks received after `input` while a line is unfinished, which have not
+   * yet been joined to it.
+   *
+   * A line cannot be finished until a line feed arrives, so the blocks are
+   * only collected until then, and are joined to `input` all at once.  Each
+   * byte of a long line is therefore copied once, rather than once for every
+   * block which extends it.
+   */
+  std::vector<Ghoti::shared_string_view> pendingBlocks;
+
+  /**
+   * The total length of `pendingBlocks`.
+   */
+  size_t pendingLength;
+
   /**
    * An error message to communicate a parsing issue.
    */
@@ -196,6 +273,11 @@ class Parser {
    */
   Ghoti::shared_string_view tempFieldName;
 
+  /**
+   * The FieldName of the field currently being processed.
+   */
+  FieldName tempFieldId;
+
   /**
    * The field value currently being processed.
    */
@@ -226,72 +308,259 @@ class Parser {
   std::shared_ptr<Message> currentMessage;
 
   /**
-   * Create a new message whose Message::Type matches the Parser::Type of this
-   * parser.
-   *
-   * This function should really only be used by Parser::Type::Request parsing,
-   * since all Parser::Type::Response streams should have already registered a
-   * Message object to receive the parsed message.
-   *
-   * @return A properly typed message.
+   * The content length that was encountered when parsing the header.
    */
-  std::shared_ptr<Message> createNewMessage() const;
+  size_t contentLength;
 
   /**
-   * The content length that was encountered when parsing the header.
+   * Whether a Content-Length field has been encountered in the current
+   * header.
    */
-  size_t contentLength;
+  bool hasContentLength;
 
   /**
    * The size of the chunk currently being read (in bytes).
    */
   size_t chunkSize;
 
+  /**
+   * The MEMCHUNKSIZELIMIT of the current message body, which is looked up
+   * once, when the body starts.
+   */
+  size_t chunkSizeLimit;
+
   /**
    * The current chunk being collected.
+   *
+   * Body bytes received across many blocks are appended as views, so that
+   * they are only joined (if at all) when the chunk is read.
    */
   Ghoti::Wave::Blob currentChunk;
+
+  /**
+   * The directory in which the anonymous files of large chunks are created,
+   * or empty for the OS temp directory.
+   */
+  std::string spillDirectory;
+
+  /**
+   * The pool from which new messages are taken, if any.
+   */
+  std::shared_ptr<MessagePool> messagePool;
+
+  /**
+   * Add body bytes to the current chunk.
+   *
+   * The chunk is moved to a file in `spillDirectory` if it grows beyond
+   * MEMCHUNKSIZELIMIT, after which the bytes are written directly to the
+   * file.
+   *
+   * @param text The body bytes.
+   * @return An error code if the bytes could not be stored.
+   */
+  std::error_code appendToChunk(const Ghoti::shared_string_view & text);
+
+  /**
+   * Whether or not to try the single-pass fast path for each new header.
+   */
+  bool fastPath;
+
+  /**
+   * Whether or not message bodies are streamed.
+   */
+  bool streaming;
+
+  /**
+   * Whether or not list field values are parsed lazily.
+   */
+  bool lazyFields;
+
+  /**
+   * Whether or not each chunk of a chunked body is kept separately.
+   */
+  bool preserveChunks;
+
+  /**
+   * The stream of the current message, if its body is being streamed.
+   */
+  std::shared_ptr<BodyStream> bodyStream;
+
+  /**
+   * Set the request target of the current message, and check that its form
+   * is allowed for the method of the message.
+   *
+   * @param target The request target.
+   * @return Whether or not the target is valid.
+   */
+  bool parseMessageTarget(const Ghoti::shared_string_view & target);
+
+  /**
+   * Discard the input that has already been consumed, rebasing the cursor
+   * positions onto the remaining input.
+   */
+  void releaseConsumedInput();
+
+  /**
+   * Whether or not the parser is within a line (of the header section, the
+   * trailer section, or a chunk size), which cannot be finished until a line
+   * feed arrives.
+   *
+   * @return `true` if the parser is within a line.
+   */
+  bool isReadingLine() const;
 };
 
 /**
- * Specialized class for handling the request parser, to make it easier to
- * pass in ServerParameters.
+ * The parameters policy of a parser for a Server, which is configured by
+ * ServerParameters.
  */
-class RequestParser : public Parser, public HasServerParameters {
-  public:
+struct ServerParserParameters {
   /**
-   * Default constructor.
+   * The class through which the parameters are set.
    */
-  RequestParser();
+  using Parameters = HasServerParameters;
 
-  private:
   /**
-   * Return the parameter value for MEMCHUNKSIZELIMIT.
-   *
-   * @return The parameter value.
+   * The parameter which limits the size of a chunk held in memory.
    */
-  virtual uint32_t getMEMCHUNKSIZELIMIT() override;
+  static constexpr ServerParameter MEMCHUNKSIZELIMIT{ServerParameter::MEMCHUNKSIZELIMIT};
+
+  /**
+   * The parameter which limits the length of an unfinished line.
+   */
+  static constexpr ServerParameter MAXLINELENGTH{ServerParameter::MAXLINELENGTH};
 };
 
 /**
- * Specialized class for handling the response parser, to make it easier to
- * pass in ClientParameters.
+ * The parameters policy of a parser for a Client, which is configured by
+ * ClientParameters.
  */
-class ResponseParser : public Parser, public HasClientParameters {
+struct ClientParserParameters {
+  /**
+   * The class through which the parameters are set.
+   */
+  using Parameters = HasClientParameters;
+
+  /**
+   * The parameter which limits the size of a chunk held in memory.
+   */
+  static constexpr ClientParameter MEMCHUNKSIZELIMIT{ClientParameter::MEMCHUNKSIZELIMIT};
+
+  /**
+   * The parameter which limits the length of an unfinished line.
+   */
+  static constexpr ClientParameter MAXLINELENGTH{ClientParameter::MAXLINELENGTH};
+};
+
+/**
+ * The HTTP/1.1 parsing state machine, specialized for one type of message
+ * stream and one parameters policy.
+ *
+ * Every decision which depends on the stream type is made at compile time,
+ * so that request and response parsing are separate state machines without
+ * any run-time branching between the two.
+ *
+ * The state machine is only instantiated for RequestParser and
+ * ResponseParser.
+ *
+ * @tparam TYPE The Parser::Type of the message stream.
+ * @tparam PARAMETERS The parameters policy (e.g., ServerParserParameters),
+ *   which provides the class through which the parser is configured.
+ */
+template <Parser::Type TYPE, class PARAMETERS>
+class BasicParser : public Parser, public PARAMETERS::Parameters {
   public:
   /**
    * Default constructor.
    */
-  ResponseParser();
+  BasicParser();
+
+  /**
+   * Process a block of data.
+   *
+   * The block is copied once into a new reference-counted input block.  Field
+   * values and message bodies are views into the input blocks, so a block is
+   * released once it has been consumed and no Message refers to it.  Only an
+   * element which is split across blocks is copied again, once its line has
+   * been received.
+   *
+   * @param buffer The buffer to be processed.
+   * @param len The length of the buffer in bytes.
+   */
+  void processBlock(const char * buffer, size_t len);
+
+  /**
+   * Process a block of data which is already held in a reference-counted
+   * input block.
+   *
+   * The block is adopted as the parser input without being copied, unless an
+   * element was split across the previous block and this one.  If the line
+   * holding that element is still unfinished, then the block is only
+   * collected, and it is joined to the element once the line is finished.
+   * If the unfinished line grows beyond MAXLINELENGTH, then the current
+   * message fails to parse.
+   *
+   * @param block The block to be processed.
+   */
+  void processBlock(const Ghoti::shared_string_view & block);
 
   private:
   /**
-   * Return the parameter value for MEMCHUNKSIZELIMIT.
+   * Parse the input from the cursor, until it is exhausted or the current
+   * message has an error.
+   */
+  void parseInput();
+
+  /**
+   * Report an error on the current message if the input held for an
+   * unfinished line is longer than MAXLINELENGTH, and discard the input.
+   *
+   * @param held The number of bytes held for the line.
+   * @return `true` if the line is within the limit.
+   */
+  bool checkLineLength(size_t held);
+
+  /**
+   * Create a new message whose Message::Type matches the Parser::Type of this
+   * parser.
+   *
+   * This function should really only be used by Parser::Type::Request parsing,
+   * since all Parser::Type::Response streams should have already registered a
+   * Message object to receive the parsed message.
+   *
+   * @return A properly typed message.
+   */
+  std::shared_ptr<Message> createNewMessage() const;
+
+  /**
+   * Parse a complete header block in a single, non-resumable pass.
+   *
+   * This is attempted at the start of each message.  It only succeeds if the
+   * input holds the whole header block (through the CRLFCRLF), every line
+   * ends with CRLF, and nothing requires the more general handling of the
+   * state machine (e.g., quoted field values or errors).  On success, the
+   * parser state is the same as if the state machine had parsed the header.
+   * On failure, nothing has been consumed and the message is left empty, so
+   * that the state machine can parse (or report an error on) the input.
    *
-   * @return The parameter value.
+   * @return Whether or not the header block was parsed.
    */
-  virtual uint32_t getMEMCHUNKSIZELIMIT() override;
+  bool parseHeaderBlock();
 };
+
+extern template class BasicParser<Parser::REQUEST, ServerParserParameters>;
+extern template class BasicParser<Parser::RESPONSE, ClientParserParameters>;
+
+/**
+ * The parser for the requests received by a Server.
+ */
+using RequestParser = BasicParser<Parser::REQUEST, ServerParserParameters>;
+
+/**
+ * The parser for the responses received by a Client.
+ */
+using ResponseParser = BasicParser<Parser::RESPONSE, ClientParserParameters>;
+
 }
 
 #endif // GHOTI_WAVE_PARSER_HPP
@@ -0,0 +1,1093 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::BasicParser state machine.
+ *
+ * This is only included by the translation units which instantiate a
+ * BasicParser, each of which instantiates only one, so that the compiler
+ * optimizes each state machine on its own.
+ */
+
+#ifndef GHOTI_WAVE_PARSERSTATEMACHINE_HPP
+#define GHOTI_WAVE_PARSERSTATEMACHINE_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include "wave/parser.hpp"
+#include "wave/parsing.hpp"
+
+#define SET_NEW_HEADER \
+  this->readStateMajor = NEW_HEADER; \
+  this->readStateMinor = TYPE == REQUEST \
+    ? BEGINNING_OF_REQUEST_LINE \
+    : BEGINNING_OF_STATUS_LINE; \
+  this->majorStart = this->cursor; \
+  this->minorStart = this->cursor; \
+  this->contentLength = 0; \
+  this->hasContentLength = false;
+
+#define SET_MINOR_STATE(nextState) \
+  this->readStateMinor = nextState; \
+  this->minorStart = this->cursor;
+
+#define SET_MAJOR_STATE(nextMajorState, nextMinorState) \
+  this->readStateMajor = nextMajorState; \
+  this->majorStart = this->cursor; \
+  SET_MINOR_STATE(nextMinorState);
+
+#define READ_WHITESPACE_OPTIONAL(nextState) \
+  while ((this->cursor < input_length) && ( \
+      isspace(this->input[this->cursor]) \
+      && (this->input[this->cursor] != '\n') \
+      && (this->input[this->cursor] != '\r'))) { \
+    ++this->cursor; \
+  } \
+  if ((this->cursor < input_length) && ( \
+      !isspace(this->input[this->cursor]) \
+      || (this->input[this->cursor] == '\n') \
+      || (this->input[this->cursor] == '\r'))) { \
+    SET_MINOR_STATE(nextState); \
+  }
+
+#define READ_WHITESPACE_REQUIRED(nextState, statusCode, errorMessage) \
+  while ((this->cursor < input_length) && ( \
+      isspace(this->input[this->cursor]) \
+      && (this->input[this->cursor] != '\n') \
+      && (this->input[this->cursor] != '\r'))) { \
+    ++this->cursor; \
+  } \
+  if (this->cursor < input_length) { \
+    if (this->cursor > this->minorStart) { \
+      SET_MINOR_STATE(nextState); \
+    } \
+    else { \
+      this->currentMessage->setStatusCode(statusCode).setErrorMessage(errorMessage); \
+    } \
+  }
+
+// CR `MAY` be ignored, so look for either CRLF or just LF.
+// https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-3
+#define READ_CRLF_OPTIONAL(nextState) \
+  while (this->cursor < input_length) { \
+    if ((this->input[this->cursor] != '\r') && (this->input[this->cursor] != '\n')) { \
+      SET_MINOR_STATE(nextState); \
+      break; \
+    } \
+    ++this->cursor; \
+  }
+
+// CR `MAY` be ignored, so look for either CRLF or just LF.
+// https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-3
+#define READ_CRLF_REQUIRED(nextState, statusCode, errorMessage) \
+  size_t len = this->cursor - this->minorStart; \
+  while ((this->cursor < input_length) && (len < 2)) { \
+    if (((len == 0) && !((this->input[this->cursor] == '\r') || (this->input[this->cursor] == '\n'))) \
+      || ((len == 1) && (this->input[this->cursor] != '\n'))) { \
+      this->currentMessage->setStatusCode(statusCode).setErrorMessage(errorMessage); \
+    } \
+    if (!this->currentMessage->hasError() && (this->input[this->cursor] == '\n')) { \
+      SET_MINOR_STATE(nextState); \
+      ++this->cursor; \
+      break; \
+    } \
+    ++this->cursor; \
+    ++len; \
+  }
+
+#define REQUEST_STATUS_ERROR (TYPE == REQUEST ? "Error reading request line." : "Error reading status line.")
+
+// The largest Content-Length that is accepted.  Checking each digit against
+// it also keeps the value from overflowing.
+#define MAX_CONTENT_LENGTH size_t{INT32_MAX}
+
+namespace Ghoti::Wave {
+
+template <Parser::Type TYPE, class PARAMETERS>
+BasicParser<TYPE, PARAMETERS>::BasicParser() : Parser(TYPE) {}
+
+template <Parser::Type TYPE, class PARAMETERS>
+void BasicParser<TYPE, PARAMETERS>::processBlock(const char * buffer, size_t len) {
+  //cout << "Processing (" << len << "): " << string(buffer, len) << endl;
+  this->processBlock(shared_string_view{std::string(buffer, len)});
+}
+
+template <Parser::Type TYPE, class PARAMETERS>
+void BasicParser<TYPE, PARAMETERS>::processBlock(const shared_string_view & block) {
+  if (this->input.empty()) {
+    this->input = block;
+  }
+  else {
+    // An element was split across the previous block and this one.  If its
+    // line is still unfinished, then the block is only collected, so that a
+    // line split across many blocks is not copied again for each of them.
+    this->pendingBlocks.push_back(block);
+    this->pendingLength += block.length();
+    std::string_view view{block};
+    if (this->isReadingLine()
+      && !std::memchr(view.data(), '\n', view.length())
+      && this->checkLineLength(this->input.length() + this->pendingLength)) {
+      return;
+    }
+
+    // The unconsumed part of the element must be joined with the new blocks.
+    if (this->pendingBlocks.size()) {
+      std::string joined{};
+      joined.reserve(this->input.length() + this->pendingLength);
+      joined.append(std::string_view{this->input});
+      for (auto & pending : this->pendingBlocks) {
+        joined.append(std::string_view{pending});
+      }
+      this->input = shared_string_view{std::move(joined)};
+      this->pendingBlocks.clear();
+      this->pendingLength = 0;
+    }
+  }
+  this->parseInput();
+}
+
+template <Parser::Type TYPE, class PARAMETERS>
+bool BasicParser<TYPE, PARAMETERS>::checkLineLength(size_t held) {
+  auto limit = this->template getParameter<uint32_t>(PARAMETERS::MAXLINELENGTH);
+  if (!limit || !*limit || (held <= *limit)) {
+    return true;
+  }
+  if (this->readStateMinor == REQUEST_TARGET) {
+    // https://www.rfc-editor.org/rfc/rfc9110#section-15.5.15
+    this->currentMessage->setStatusCode(414).setErrorMessage("Request target too long.");
+  }
+  else if (this->readStateMinor == CHUNK_SIZE) {
+    this->currentMessage->setStatusCode(400).setErrorMessage("Chunk size line too long.");
+  }
+  else {
+    // https://www.rfc-editor.org/rfc/rfc6585#section-5
+    this->currentMessage->setStatusCode(431).setErrorMessage("Header line too long.");
+  }
+
+  // The line will never be parsed, so none of it is kept.
+  this->input = {};
+  this->pendingBlocks.clear();
+  this->pendingLength = 0;
+  this->cursor = 0;
+  this->majorStart = 0;
+  this->minorStart = 0;
+  return false;
+}
+
+template <Parser::Type TYPE, class PARAMETERS>
+void BasicParser<TYPE, PARAMETERS>::parseInput() {
+  size_t input_length = this->input.length();
+  // A finished message is delivered even if it ends exactly at the end of the
+  // input.
+  while (!this->currentMessage->hasError() && ((this->cursor < input_length) || (this->readStateMajor == FINISHED))) {
+    switch (this->readStateMajor) {
+      case NEW_HEADER: {
+        // Most messages arrive whole, so try to parse the header in one pass
+        // before falling back to the state machine.
+        if (this->fastPath
+          && ((this->readStateMinor == BEGINNING_OF_REQUEST_LINE) || (this->readStateMinor == BEGINNING_OF_STATUS_LINE))
+          && this->parseHeaderBlock()) {
+          break;
+        }
+
+        // https://datatracker.ietf.org/doc/html/rfc9112#name-request-line
+        // request-line   = method SP request-target SP HTTP-version
+        switch (this->readStateMinor) {
+          case BEGINNING_OF_REQUEST_LINE: {
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-6
+            READ_CRLF_OPTIONAL(BEGINNING_OF_REQUEST);
+            break;
+          }
+          case BEGINNING_OF_REQUEST: {
+            READ_WHITESPACE_OPTIONAL(METHOD);
+            break;
+          }
+          case BEGINNING_OF_STATUS_LINE: {
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-4-1
+            READ_CRLF_OPTIONAL(BEGINNING_OF_STATUS);
+            break;
+          }
+          case BEGINNING_OF_STATUS: {
+            READ_WHITESPACE_OPTIONAL(HTTP_VERSION);
+            break;
+          }
+          case METHOD: {
+            while ((this->cursor < input_length) && isgraph(this->input[this->cursor])) {
+              ++this->cursor;
+            }
+            if (this->cursor < input_length) {
+              // Finished reading Method.
+              auto method = lookupMethod(this->input.substr(this->minorStart, this->cursor - this->minorStart));
+              if (method != Method::UNKNOWN) {
+                // Finished reading a valid method.
+                this->currentMessage->setMethod(getMethodText(method));
+                SET_MINOR_STATE(AFTER_METHOD);
+              }
+              else {
+                // https://www.rfc-editor.org/rfc/rfc9110#section-9.1-10
+                this->currentMessage->setStatusCode(501).setErrorMessage("Unrecognized method");
+              }
+            }
+            break;
+          }
+          case AFTER_METHOD: {
+            READ_WHITESPACE_REQUIRED(REQUEST_TARGET, 400, REQUEST_STATUS_ERROR);
+            break;
+          }
+          case REQUEST_TARGET: {
+            while ((this->cursor < input_length) && isgraph(this->input[this->cursor])) {
+              ++this->cursor;
+            }
+            if (this->cursor < input_length) {
+              // Finished reading request target.
+              shared_string_view target = this->input.substr(this->minorStart, this->cursor - this->minorStart);
+              if (!this->parseMessageTarget(target)) {
+                this->currentMessage->setStatusCode(400).setErrorMessage("Invalid request target");
+                break;
+              }
+              SET_MINOR_STATE(AFTER_REQUEST_TARGET);
+            }
+            break;
+          }
+          case AFTER_REQUEST_TARGET: {
+            READ_WHITESPACE_REQUIRED(HTTP_VERSION, 400, REQUEST_STATUS_ERROR);
+            break;
+          }
+          case HTTP_VERSION: {
+            while ((this->cursor < input_length) && isgraph(this->input[this->cursor])) {
+              ++this->cursor;
+            }
+            if (this->cursor < input_length) {
+              // Finished reading message target.
+              shared_string_view version = this->input.substr(this->minorStart, this->cursor - this->minorStart);
+              this->currentMessage->setVersion(version);
+              SET_MINOR_STATE(AFTER_HTTP_VERSION);
+            }
+            break;
+          }
+          case AFTER_HTTP_VERSION: {
+            if constexpr (TYPE == REQUEST) {
+              READ_WHITESPACE_OPTIONAL(CRLF);
+            }
+            else {
+              READ_WHITESPACE_REQUIRED(RESPONSE_CODE, 400, REQUEST_STATUS_ERROR);
+            }
+            break;
+          }
+          case RESPONSE_CODE: {
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-4-4
+            // Must be 3 digits.
+            while ((this->cursor < input_length) && isdigit(this->input[this->cursor]) && ((this->cursor - this->minorStart) < 3)) {
+              ++this->cursor;
+            }
+            if ((this->cursor - this->minorStart) == 3) {
+              this->currentMessage->setStatusCode(
+                ((this->input[this->minorStart] - '0') * 100)
+                + ((this->input[this->minorStart + 1] - '0') * 10)
+                + ((this->input[this->minorStart + 2] - '0')));
+              READ_WHITESPACE_REQUIRED(REASON_PHRASE, 400, REQUEST_STATUS_ERROR);
+            }
+            break;
+          }
+          case REASON_PHRASE: {
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-4-7
+            this->cursor += findCRLFChar(std::string_view{this->input}.data() + this->cursor, input_length - this->cursor);
+            if (this->cursor < input_length) {
+              SET_MINOR_STATE(CRLF);
+            }
+            break;
+          }
+          case CRLF: {
+            READ_CRLF_REQUIRED(AFTER_CRLF, 400, REQUEST_STATUS_ERROR);
+            break;
+          }
+          case AFTER_CRLF: {
+            SET_MAJOR_STATE(FIELD_LINE, BEGINNING_OF_FIELD_LINE);
+            this->tempFieldId = FieldName::UNKNOWN;
+            break;
+          }
+          default: {
+            this->currentMessage->setStatusCode(400).setErrorMessage(REQUEST_STATUS_ERROR);
+          }
+        }
+        break;
+      }
+      case FIELD_LINE:
+      case TRAILER: {
+        // https://datatracker.ietf.org/doc/html/rfc9110#section-5.2
+        // https://datatracker.ietf.org/doc/html/rfc9112#name-chunked-trailer-section
+        switch (this->readStateMinor) {
+          case BEGINNING_OF_FIELD_LINE: {
+            // Intentionally not advancing the cursor in this step.
+            if ((this->input[this->cursor] == '\r') || (this->input[this->cursor] == '\n')) {
+              SET_MINOR_STATE(this->readStateMajor == FIELD_LINE
+                ? AFTER_HEADER_FIELDS
+                : TRAILER_FINISHED);
+            }
+            else {
+              SET_MINOR_STATE(FIELD_NAME);
+            }
+            break;
+          }
+          case FIELD_NAME: {
+            // Field lines must not begin with whitespace, unless packaged
+            // within the "message/http" media type.
+            // https://datatracker.ietf.org/doc/html/rfc9112#name-obsolete-line-folding
+            //
+            // Identify the first character of a field name.
+            // https://datatracker.ietf.org/doc/html/rfc9110#section-16.3.1-6.2
+            // Note that the specification makes a "SHOULD" recommendation, but
+            // does not actually disallow the token characters.
+            this->cursor += findNonTokenChar(std::string_view{this->input}.data() + this->cursor, input_length - this->cursor);
+            if (this->cursor < input_length) {
+              // Finished reading request target.
+              // The name is kept as received.  Field names are compared
+              // without regard to case.
+              this->tempFieldName = this->input.substr(this->minorStart, this->cursor - this->minorStart);
+              this->tempFieldId = lookupFieldName(this->tempFieldName);
+              SET_MINOR_STATE(AFTER_FIELD_NAME);
+            }
+            break;
+          }
+          case AFTER_FIELD_NAME: {
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-5-1
+            if (this->input[this->cursor] == ':') {
+              SET_MINOR_STATE(BEFORE_FIELD_VALUE);
+              ++this->cursor;
+            }
+            else {
+              // https://datatracker.ietf.org/doc/html/rfc9112#section-5.1-2
+              this->currentMessage->setStatusCode(400).setErrorMessage("Illegal character between field name and colon");
+            }
+            break;
+          }
+          case BEFORE_FIELD_VALUE: {
+            // Remove leading whitespace.
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-5-1
+            // https://datatracker.ietf.org/doc/html/rfc9110#section-5.5-3
+            READ_WHITESPACE_OPTIONAL(FIELD_VALUE);
+            break;
+          }
+          case FIELD_VALUE: {
+            // A lazily parsed list is read whole, just like a singleton.
+            if (isListField(this->tempFieldId) && !this->lazyFields) {
+              SET_MINOR_STATE(LIST_FIELD_VALUE);
+            }
+            else {
+              SET_MINOR_STATE(SINGLETON_FIELD_VALUE);
+            }
+            break;
+          }
+          case SINGLETON_FIELD_VALUE: {
+            while((this->cursor < input_length) && (this->input[this->cursor] != '\n')) {
+              ++this->cursor;
+            }
+            if (this->cursor < input_length) {
+              // Back up valueEnd (one past the end of the value) to be before
+              // the CRLF.  CR is optional.  The value may begin at the start
+              // of the input, so valueEnd never goes below minorStart.
+              // https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-3
+              size_t valueEnd = this->cursor;
+              if ((valueEnd > this->minorStart) && (this->input[valueEnd - 1] == '\r')) {
+                --valueEnd;
+              }
+              // Eliminate trailing whitespace.
+              // https://datatracker.ietf.org/doc/html/rfc9110#section-5.5-3
+              while ((valueEnd > this->minorStart) && isWhitespaceChar(this->input[valueEnd - 1])) {
+                --valueEnd;
+              }
+              // Verify that there are no illegal characters.
+              size_t valueLength = valueEnd - this->minorStart;
+              if (findNonFieldContentChar(std::string_view{this->input}.data() + this->minorStart, valueLength) < valueLength) {
+                this->currentMessage->setStatusCode(400).setErrorMessage("Illegal character in singleton field value");
+              }
+              // If anything remains, then it is the field value.
+              if (valueLength) {
+                auto value = this->input.substr(this->minorStart, valueLength);
+                if (isListField(this->tempFieldId)) {
+                  // The list will be split if it is accessed, but it must at
+                  // least begin with an element.
+                  if ((value[0] != '"') && !isTokenChar(value[0])) {
+                    this->currentMessage->setStatusCode(400).setErrorMessage("Illegal character in field value");
+                  }
+                  else if (this->readStateMajor == FIELD_LINE) {
+                    this->currentMessage->addUnparsedFieldValue(this->tempFieldId, this->tempFieldName, value);
+                  }
+                  else {
+                    this->currentMessage->addUnparsedTrailerFieldValue(this->tempFieldId, this->tempFieldName, value);
+                  }
+                }
+                else if (this->readStateMajor == FIELD_LINE) {
+                  this->currentMessage->addFieldValue(this->tempFieldId, this->tempFieldName, value);
+                }
+                else {
+                  this->currentMessage->addTrailerFieldValue(this->tempFieldName, value);
+                }
+                if (this->tempFieldId == FieldName::CONTENT_LENGTH) {
+                  // https://datatracker.ietf.org/doc/html/rfc9112#name-content-length
+                  size_t contentLength{0};
+                  for (auto ch : value) {
+                    if (!isdigit(ch)) {
+                      this->currentMessage->setStatusCode(400).setErrorMessage("Invalid Content-Length");
+                      break;
+                    }
+                    // Converting ASCII numbers to an integer, one character
+                    // at a time.
+                    contentLength = (contentLength * 10) + (ch - '0');
+                    if (contentLength > MAX_CONTENT_LENGTH) {
+                      this->currentMessage->setStatusCode(413).setErrorMessage("Content-Length too large");
+                      break;
+                    }
+                  }
+                  if (this->currentMessage->hasError()) {
+                    break;
+                  }
+                  if (this->readStateMajor == FIELD_LINE) {
+                    // A repeated Content-Length with a different value makes
+                    // the message length ambiguous, so it is an error.
+                    // https://datatracker.ietf.org/doc/html/rfc9112#section-6.3
+                    if (this->hasContentLength && (this->contentLength != contentLength)) {
+                      this->currentMessage->setStatusCode(400).setErrorMessage("Conflicting Content-Length");
+                      break;
+                    }
+                    this->hasContentLength = true;
+                    this->currentMessage->setTransport(Message::Transport::FIXED);
+                  }
+                  this->contentLength = contentLength;
+                }
+                SET_MINOR_STATE(CRLF);
+              }
+              else {
+                this->currentMessage->setStatusCode(400).setErrorMessage("Singleton field value is blank/empty");
+              }
+            }
+            break;
+          }
+          case LIST_FIELD_VALUE: {
+            if (this->input[this->cursor] == '"') {
+              SET_MINOR_STATE(QUOTED_FIELD_VALUE_OPEN);
+              ++this->cursor;
+            }
+            else if (isTokenChar(this->input[this->cursor])) {
+              // Intentionally not advancing the this->cursor.
+              SET_MINOR_STATE(UNQUOTED_FIELD_VALUE);
+            }
+            else {
+              this->currentMessage->setStatusCode(400).setErrorMessage("Illegal character in field value");
+            }
+            break;
+          }
+          case UNQUOTED_FIELD_VALUE: {
+            while((this->cursor < input_length) && (this->input[this->cursor] != ',') && (this->input[this->cursor] != '\n')) {
+              ++this->cursor;
+            }
+            if (this->cursor < input_length) {
+              // We found either a comma or a \n.
+
+              // valueEnd is one past the end of the value, and never goes below
+              // minorStart, which may be the start of the input.
+              size_t valueEnd = this->cursor;
+              if (this->input[this->cursor] == '\n') {
+                // Back up valueEnd to be before the CRLF, if present.
+                // CR is optional.
+                // https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-3
+                if ((valueEnd > this->minorStart) && (this->input[valueEnd - 1] == '\r')) {
+                  --valueEnd;
+                }
+              }
+              // Eliminate trailing whitespace.
+              // https://datatracker.ietf.org/doc/html/rfc9110#section-5.5-3
+              while ((valueEnd > this->minorStart) && isWhitespaceChar(this->input[valueEnd - 1])) {
+                --valueEnd;
+              }
+              // Verify that there are no illegal characters.
+              size_t valueLength = valueEnd - this->minorStart;
+              if (findNonFieldContentChar(std::string_view{this->input}.data() + this->minorStart, valueLength) < valueLength) {
+                this->currentMessage->setStatusCode(400).setErrorMessage("Illegal character in singleton field value");
+              }
+              // If anything remains, then it is the field value.
+              if (valueLength) {
+                if (this->readStateMajor == FIELD_LINE) {
+                  this->currentMessage->addFieldValue(this->tempFieldId, this->tempFieldName, this->input.substr(this->minorStart, valueLength));
+                }
+                else {
+                  this->currentMessage->addTrailerFieldValue(this->tempFieldName, this->input.substr(this->minorStart, valueLength));
+                }
+                if (this->input[this->cursor] == ',') {
+                  SET_MINOR_STATE(FIELD_VALUE_COMMA);
+                }
+                else {
+                  SET_MINOR_STATE(CRLF);
+                }
+              }
+              else {
+                this->currentMessage->setStatusCode(400).setErrorMessage("Singleton field value is blank/empty");
+              }
+            }
+            break;
+          }
+          case QUOTED_FIELD_VALUE_OPEN: {
+            this->tempFieldValue = "";
+            SET_MINOR_STATE(QUOTED_FIELD_VALUE_PROCESS);
+            break;
+          }
+          case QUOTED_FIELD_VALUE_PROCESS: {
+            this->cursor += findNonQuotedChar(std::string_view{this->input}.data() + this->cursor, input_length - this->cursor);
+            if (this->cursor < input_length) {
+              // Input scanning hit either an escaped character, a double
+              // quote, or an illegal character.
+              if (this->input[this->cursor] == '\\') {
+                this->tempFieldValue += this->input.substr(this->minorStart, this->cursor - this->minorStart);
+                ++this->cursor;
+                SET_MINOR_STATE(QUOTED_FIELD_VALUE_ESCAPE);
+              }
+              else if (this->input[this->cursor] == '"') {
+                this->tempFieldValue += this->input.substr(this->minorStart, this->cursor - this->minorStart);
+                ++this->cursor;
+                SET_MINOR_STATE(QUOTED_FIELD_VALUE_CLOSE);
+              }
+              else {
+                this->currentMessage->setStatusCode(400).setErrorMessage("Quoted field value is malformed");
+              }
+            }
+            break;
+          }
+          case QUOTED_FIELD_VALUE_ESCAPE: {
+            this->tempFieldValue += this->input[this->cursor];
+            ++this->cursor;
+            SET_MINOR_STATE(QUOTED_FIELD_VALUE_PROCESS);
+            break;
+          }
+          case QUOTED_FIELD_VALUE_CLOSE: {
+            SET_MINOR_STATE(AFTER_FIELD_VALUE);
+            if (this->readStateMajor == FIELD_LINE) {
+              this->currentMessage->addFieldValue(this->tempFieldId, this->tempFieldName, this->tempFieldValue);
+            }
+            else {
+              this->currentMessage->addTrailerFieldValue(this->tempFieldName, this->tempFieldValue);
+            }
+            break;
+          }
+          case AFTER_FIELD_VALUE: {
+            READ_WHITESPACE_OPTIONAL(FIELD_VALUE_COMMA);
+            break;
+          }
+          case FIELD_VALUE_COMMA: {
+            if (this->input[this->cursor] == ',') {
+              ++this->cursor;
+              SET_MINOR_STATE(AFTER_FIELD_VALUE_COMMA);
+            }
+            else if (isCRLFChar(this->input[this->cursor])) {
+              SET_MINOR_STATE(CRLF);
+            }
+            else {
+              READ_CRLF_REQUIRED(AFTER_CRLF, 400, "Error reading field line.");
+            }
+
+            break;
+          }
+          case AFTER_FIELD_VALUE_COMMA: {
+            READ_WHITESPACE_OPTIONAL(LIST_FIELD_VALUE);
+            break;
+          }
+          case CRLF: {
+            READ_CRLF_REQUIRED(AFTER_CRLF, 400, "Error reading field line.");
+            break;
+          }
+          case AFTER_CRLF: {
+            // Stay in either the header or the Trailer section.
+            SET_MAJOR_STATE(this->readStateMajor, BEGINNING_OF_FIELD_LINE);
+            this->tempFieldId = FieldName::UNKNOWN;
+            break;
+          }
+          case AFTER_HEADER_FIELDS:
+          case TRAILER_FINISHED: {
+            // The section ends with an empty line.  The cursor began on its
+            // CR or LF.  CR `MAY` be ignored, so look for either CRLF or just
+            // LF.
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-3
+            while (this->cursor < input_length) {
+              if (this->input[this->cursor] == '\n') {
+                // Note: The cursor is intentionally left on the LF.  That way,
+                // in the event that the message ends at this point (e.g.,
+                // there is no message body), there is still input with which
+                // to move execution to the next phase.
+                if (this->readStateMajor == FIELD_LINE) {
+                  SET_MAJOR_STATE(MESSAGE_BODY, MESSAGE_START);
+                }
+                else {
+                  // Nothing follows the Trailer section, so the LF can be
+                  // consumed.
+                  ++this->cursor;
+                  SET_MAJOR_STATE(FINISHED, MESSAGE_FINISHED);
+                }
+                break;
+              }
+              if ((this->input[this->cursor] != '\r') || (this->cursor > this->minorStart)) {
+                this->currentMessage->setStatusCode(400).setErrorMessage("Error reading field line.");
+                break;
+              }
+              ++this->cursor;
+            }
+            break;
+          }
+          default: {
+            assert(false);
+            this->currentMessage->setErrorMessage("foo");
+          }
+        }
+        break;
+      }
+      case MESSAGE_BODY: {
+        switch (this->readStateMinor) {
+          case MESSAGE_START: {
+            // Increment the cursor, which was not done at the end of the
+            // previous step, AFTER_HEADER_FIELDS.
+            ++this->cursor;
+
+            // Determine whether or not there is a message body.  A
+            // Transfer-Encoding overrides any Content-Length.
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-6.3
+            bool chunked{false};
+            auto codings = this->currentMessage->getFieldValues(FieldName::TRANSFER_ENCODING);
+            if (!codings.empty()) {
+              if (!KnownNames::equalsIgnoreCase(codings[codings.size() - 1], "chunked")) {
+                // The length of the body cannot be determined.
+                // https://datatracker.ietf.org/doc/html/rfc9112#section-6.3-2.4.1
+                this->currentMessage->setStatusCode(400).setErrorMessage("Unsupported transfer coding");
+                break;
+              }
+              chunked = true;
+              this->currentMessage->setTransport(Message::Transport::CHUNKED);
+            }
+            if (chunked || (this->contentLength > 0)) {
+              auto limit = this->template getParameter<uint32_t>(PARAMETERS::MEMCHUNKSIZELIMIT);
+              this->chunkSizeLimit = limit ? *limit : 0;
+              if (this->streaming) {
+                // Deliver the message now, and its body as it arrives.
+                this->bodyStream = std::make_shared<BodyStream>();
+                this->currentMessage->setBodyStream(this->bodyStream);
+                this->messages.emplace(this->currentMessage);
+              }
+              if (chunked) {
+                SET_MAJOR_STATE(CHUNKED_BODY, CHUNK_START);
+              }
+              else {
+                SET_MINOR_STATE(MESSAGE_READ);
+              }
+            }
+            else {
+              // This is the end of the message.
+              this->currentMessage->setReady(true);
+              this->messages.emplace(std::move(this->currentMessage));
+              this->currentMessage = this->createNewMessage();
+              SET_NEW_HEADER;
+            }
+            break;
+          }
+          case MESSAGE_READ: {
+            // Take as much as possible, until the fixed contentLength is reached.
+            size_t length = std::min(input_length - this->cursor, this->contentLength - (this->cursor - this->minorStart));
+            if (this->bodyStream) {
+              this->bodyStream->push(this->input.substr(this->cursor, length));
+            }
+            else if (this->appendToChunk(this->input.substr(this->cursor, length))) {
+              // The append failed.  We can't do anything else.
+              // Insufficient Storage
+              // https://datatracker.ietf.org/doc/html/rfc4918#section-11.5
+              this->currentMessage->setStatusCode(507).setErrorMessage("Insufficient Storage");
+              break;
+            }
+            this->cursor += length;
+
+            // If there is no more to read, then finalize the message.
+            if ((this->cursor - this->minorStart) == this->contentLength) {
+              if (this->bodyStream) {
+                SET_MAJOR_STATE(FINISHED, MESSAGE_FINISHED);
+                break;
+              }
+              this->currentMessage->setMessageBody(std::move(this->currentChunk));
+              this->currentChunk = {};
+              SET_MAJOR_STATE(FINISHED, MESSAGE_FINISHED);
+            }
+            break;
+          }
+          default: {
+            assert(false);
+            this->currentMessage->setErrorMessage("foo");
+          }
+        }
+        break;
+      }
+      case CHUNKED_BODY: {
+        // https://datatracker.ietf.org/doc/html/rfc9112#name-chunked-transfer-coding
+        switch (this->readStateMinor) {
+          case CHUNK_START: {
+            this->chunkSize = 0;
+            this->extensions = {};
+            SET_MINOR_STATE(CHUNK_SIZE);
+            break;
+          }
+          case CHUNK_SIZE: {
+            // chunk-size [ chunk-ext ] CRLF
+            // Wait for the whole line, which is found with a single scan.
+            // The cursor marks how much of it has already been searched.
+            const char * data = std::string_view{this->input}.data();
+            auto lineFeed = static_cast<const char *>(std::memchr(data + this->cursor, '\n', input_length - this->cursor));
+            if (!lineFeed) {
+              this->cursor = input_length;
+              break;
+            }
+            size_t lineEnd = lineFeed - data;
+
+            // CR `MAY` be ignored.
+            // https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-3
+            size_t contentEnd = ((lineEnd > this->minorStart) && (data[lineEnd - 1] == '\r'))
+              ? lineEnd - 1
+              : lineEnd;
+            size_t pos = this->minorStart;
+            size_t chunkSize{0};
+            while ((pos < contentEnd) && isxdigit(data[pos])) {
+              if (chunkSize > (std::numeric_limits<size_t>::max() >> 4)) {
+                // This next digit would overflow.
+                this->currentMessage->setStatusCode(400).setErrorMessage("Chunk size too large.");
+                break;
+              }
+              char ch = data[pos];
+              chunkSize = (chunkSize << 4) + (isdigit(ch)
+                ? ch - '0'
+                : (ch | 0x20) - 'a' + 10);
+              ++pos;
+            }
+            if (this->currentMessage->hasError()) {
+              break;
+            }
+            size_t digitsEnd = pos;
+            while ((pos < contentEnd) && isWhitespaceChar(data[pos])) {
+              ++pos;
+            }
+            if ((digitsEnd == this->minorStart) || ((pos < contentEnd) && (data[pos] != ';'))) {
+              this->currentMessage->setStatusCode(400).setErrorMessage("Error reading chunk size/extensions.");
+              break;
+            }
+
+            // https://datatracker.ietf.org/doc/html/rfc9112#name-chunk-extensions
+            // TODO: parse these into a list of extension name/value pairs.
+            //   I'm not doing it at the moment because the use of these
+            //   extension values are implementation specific, and it's just a
+            //   lot of complexity for a feature that's not being used at the
+            //   moment.
+            if (pos < contentEnd) {
+              this->extensions = this->input.substr(pos + 1, contentEnd - pos - 1);
+            }
+            this->chunkSize = chunkSize;
+            this->cursor = lineEnd + 1;
+            if (chunkSize) {
+              SET_MINOR_STATE(CHUNK_BODY);
+              break;
+            }
+
+            // This was the last chunk, so the body is complete, and the
+            // Trailer section follows.
+            if (!this->bodyStream && !this->preserveChunks) {
+              this->currentMessage->setMessageBody(std::move(this->currentChunk));
+              this->currentChunk = {};
+            }
+            SET_MAJOR_STATE(TRAILER, BEGINNING_OF_FIELD_LINE);
+            break;
+          }
+          case CHUNK_BODY: {
+            // Take as much as possible, until the chunk size is reached.
+            size_t length = std::min(input_length - this->cursor, this->chunkSize - (this->cursor - this->minorStart));
+            if (this->bodyStream) {
+              this->bodyStream->push(this->input.substr(this->cursor, length));
+            }
+            else if (this->appendToChunk(this->input.substr(this->cursor, length))) {
+              // The append failed.  We can't do anything else.
+              // Insufficient Storage
+              // https://datatracker.ietf.org/doc/html/rfc4918#section-11.5
+              this->currentMessage->setStatusCode(507).setErrorMessage("Insufficient Storage");
+              break;
+            }
+            this->cursor += length;
+
+            // If there is no more to read, then finalize the chunk.  Unless
+            // the chunk boundaries are preserved, the chunks accumulate into
+            // a single body.
+            if ((this->cursor - this->minorStart) == this->chunkSize) {
+              if (this->preserveChunks && !this->bodyStream) {
+                this->currentMessage->addChunk(std::move(this->currentChunk));
+                this->currentChunk = {};
+              }
+              SET_MINOR_STATE(AFTER_CHUNK_BODY);
+            }
+            break;
+          }
+          case AFTER_CHUNK_BODY: {
+            READ_CRLF_REQUIRED(CHUNK_START, 400, "Error reading chunk data.");
+            break;
+          }
+          default: {
+            assert(false);
+          }
+        }
+        break;
+      }
+      case FINISHED: {
+        // This is the end of the message.  A streamed message has already
+        // been delivered, so only its stream needs to be ended.
+        this->currentMessage->setReady(true);
+        if (this->bodyStream) {
+          this->bodyStream->finish();
+          this->bodyStream.reset();
+        }
+        else {
+          this->messages.emplace(std::move(this->currentMessage));
+        }
+        this->currentMessage = this->createNewMessage();
+        SET_NEW_HEADER;
+        break;
+      }
+      default: {
+        assert(false);
+        this->currentMessage->setErrorMessage("foo");
+      }
+    }
+  }
+  if (!this->currentMessage->hasError() && this->isReadingLine()) {
+    this->checkLineLength(this->input.length() - std::min(this->minorStart, this->cursor));
+  }
+  if (this->currentMessage->hasError()) {
+    this->currentChunk = {};
+    if (this->bodyStream) {
+      // The message has already been delivered, so its body is abandoned.
+      this->bodyStream->abort();
+      this->bodyStream.reset();
+    }
+    else {
+      this->messages.emplace(std::move(this->currentMessage));
+    }
+    this->currentMessage = this->createNewMessage();
+  }
+  this->releaseConsumedInput();
+}
+
+template <Parser::Type TYPE, class PARAMETERS>
+std::shared_ptr<Message> BasicParser<TYPE, PARAMETERS>::createNewMessage() const {
+  constexpr auto type = TYPE == REQUEST ? Message::Type::REQUEST : Message::Type::RESPONSE;
+  return this->messagePool ? this->messagePool->acquire(type) : std::make_shared<Message>(type);
+}
+
+/**
+ * Skip a run of optional whitespace.
+ *
+ * @param data The input.
+ * @param pos The position at which to start.
+ * @param end The end of the line.
+ * @result The position of the first non-whitespace character.
+ */
+inline size_t skipWhitespace(const char * data, size_t pos, size_t end) {
+  while ((pos < end) && ((data[pos] == ' ') || (data[pos] == '\t'))) {
+    ++pos;
+  }
+  return pos;
+}
+
+/**
+ * Skip a run of visible characters.
+ *
+ * @param data The input.
+ * @param pos The position at which to start.
+ * @param end The end of the line.
+ * @result The position of the first non-visible character.
+ */
+inline size_t skipVisible(const char * data, size_t pos, size_t end) {
+  while ((pos < end) && (static_cast<uint8_t>(data[pos] - '!') <= ('~' - '!'))) {
+    ++pos;
+  }
+  return pos;
+}
+
+template <Parser::Type TYPE, class PARAMETERS>
+bool BasicParser<TYPE, PARAMETERS>::parseHeaderBlock() {
+  std::string_view text{this->input};
+  const char * data = text.data();
+
+  // Empty lines and whitespace may precede the start line.
+  // https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-6
+  size_t pos = this->cursor;
+  while ((pos < text.length()) && (isCRLFChar(data[pos]) || isWhitespaceChar(data[pos]))) {
+    ++pos;
+  }
+
+  // Every line must end with CRLF, so the first CRLFCRLF is the end of the
+  // header block.
+  size_t blockEnd = text.find("\r\n\r\n", pos);
+  if (blockEnd == std::string_view::npos) {
+    return false;
+  }
+  size_t lineEnd = text.find('\n', pos) - 1;
+  if (data[lineEnd] != '\r') {
+    return false;
+  }
+  auto & message = *this->currentMessage;
+  size_t contentLength{0};
+  bool seenContentLength{false};
+
+  // Abandon the attempt after the start line has been stored, discarding
+  // everything that was added to the message.
+  auto fallBack = [this]() {
+    this->currentMessage = this->createNewMessage();
+    return false;
+  };
+  if constexpr (TYPE == REQUEST) {
+    // https://datatracker.ietf.org/doc/html/rfc9112#name-request-line
+    size_t methodEnd = pos + findNonTokenChar(data + pos, lineEnd - pos);
+    auto method = lookupMethod(text.substr(pos, methodEnd - pos));
+    size_t targetStart = skipWhitespace(data, methodEnd, lineEnd);
+    // A target containing any other visible character is rejected by the
+    // slow path.
+    size_t targetEnd = targetStart + findNonTargetChar(data + targetStart, lineEnd - targetStart);
+    size_t versionStart = skipWhitespace(data, targetEnd, lineEnd);
+    size_t versionEnd = skipVisible(data, versionStart, lineEnd);
+    if ((method == Method::UNKNOWN)
+      || (targetStart == methodEnd)
+      || (targetEnd == targetStart)
+      || (versionStart == targetEnd)
+      || (versionEnd == versionStart)
+      || (skipWhitespace(data, versionEnd, lineEnd) != lineEnd)) {
+      return false;
+    }
+    shared_string_view target = this->input.substr(targetStart, targetEnd - targetStart);
+    message.setMethod(getMethodText(method));
+    if (!this->parseMessageTarget(target)) {
+      return fallBack();
+    }
+    message.setVersion(this->input.substr(versionStart, versionEnd - versionStart));
+  }
+  else {
+    // https://datatracker.ietf.org/doc/html/rfc9112#name-status-line
+    size_t versionEnd = skipVisible(data, pos, lineEnd);
+    size_t codeStart = skipWhitespace(data, versionEnd, lineEnd);
+    size_t codeEnd = codeStart + 3;
+    if ((versionEnd == pos)
+      || (codeStart == versionEnd)
+      || (codeEnd > lineEnd)
+      || !isdigit(data[codeStart])
+      || !isdigit(data[codeStart + 1])
+      || !isdigit(data[codeStart + 2])
+      || ((codeEnd < lineEnd) && !isWhitespaceChar(data[codeEnd]))
+      || ((codeEnd + findCRLFChar(data + codeEnd, lineEnd - codeEnd)) != lineEnd)) {
+      return false;
+    }
+    message.setVersion(this->input.substr(pos, versionEnd - pos));
+    message.setStatusCode(
+      ((data[codeStart] - '0') * 100)
+      + ((data[codeStart + 1] - '0') * 10)
+      + ((data[codeStart + 2] - '0')));
+  }
+
+  // The field lines.
+  // https://datatracker.ietf.org/doc/html/rfc9112#name-field-syntax
+  for (pos = lineEnd + 2; pos < blockEnd + 2; pos = lineEnd + 2) {
+    lineEnd = text.find('\n', pos);
+    if ((lineEnd == pos) || (data[--lineEnd] != '\r')) {
+      return fallBack();
+    }
+    size_t nameEnd = pos + findNonTokenChar(data + pos, lineEnd - pos);
+    if ((nameEnd == pos) || (data[nameEnd] != ':')) {
+      return fallBack();
+    }
+    auto name = this->input.substr(pos, nameEnd - pos);
+    auto id = lookupFieldName(name);
+
+    // Trim the whitespace surrounding the value.
+    // https://datatracker.ietf.org/doc/html/rfc9110#section-5.5-3
+    size_t valueStart = skipWhitespace(data, nameEnd + 1, lineEnd);
+    size_t valueEnd = lineEnd;
+    while ((valueEnd > valueStart) && isWhitespaceChar(data[valueEnd - 1])) {
+      --valueEnd;
+    }
+    if ((valueEnd == valueStart)
+      || (findNonFieldContentChar(data + valueStart, valueEnd - valueStart) != valueEnd - valueStart)) {
+      return fallBack();
+    }
+
+    if (isListField(id) && this->lazyFields) {
+      // The list will be split if it is accessed, but it must at least begin
+      // with an element.
+      if ((data[valueStart] != '"') && !isTokenChar(data[valueStart])) {
+        return fallBack();
+      }
+      message.addUnparsedFieldValue(id, name, this->input.substr(valueStart, valueEnd - valueStart));
+    }
+    else if (isListField(id)) {
+      // Quoted values are left to the state machine.
+      if (text.substr(valueStart, valueEnd - valueStart).find('"') != std::string_view::npos) {
+        return fallBack();
+      }
+      while (valueStart <= valueEnd) {
+        size_t elementStart = skipWhitespace(data, valueStart, valueEnd);
+        if ((elementStart == valueEnd) || !isTokenChar(data[elementStart])) {
+          return fallBack();
+        }
+        size_t elementEnd = std::min(text.substr(elementStart, valueEnd - elementStart).find(','), valueEnd - elementStart) + elementStart;
+        valueStart = elementEnd + 1;
+        while (isWhitespaceChar(data[elementEnd - 1])) {
+          --elementEnd;
+        }
+        message.addFieldValue(id, name, this->input.substr(elementStart, elementEnd - elementStart));
+      }
+    }
+    else {
+      auto value = this->input.substr(valueStart, valueEnd - valueStart);
+      if (id == FieldName::CONTENT_LENGTH) {
+        // https://datatracker.ietf.org/doc/html/rfc9112#name-content-length
+        size_t fieldLength{0};
+        for (auto ch : value) {
+          if (!isdigit(ch)) {
+            return fallBack();
+          }
+          fieldLength = (fieldLength * 10) + (ch - '0');
+          if (fieldLength > MAX_CONTENT_LENGTH) {
+            return fallBack();
+          }
+        }
+
+        // Conflicting duplicates are reported by the state machine.
+        if (seenContentLength && (fieldLength != contentLength)) {
+          return fallBack();
+        }
+        contentLength = fieldLength;
+        seenContentLength = true;
+        message.setTransport(Message::Transport::FIXED);
+      }
+      message.addFieldValue(id, name, std::move(value));
+    }
+  }
+
+  // Leave the cursor on the final LF, just as AFTER_HEADER_FIELDS does.
+  this->contentLength = contentLength;
+  this->hasContentLength = seenContentLength;
+  this->cursor = blockEnd + 3;
+  SET_MAJOR_STATE(MESSAGE_BODY, MESSAGE_START);
+  return true;
+}
+
+}
+
+#undef SET_NEW_HEADER
+#undef SET_MINOR_STATE
+#undef SET_MAJOR_STATE
+#undef READ_WHITESPACE_OPTIONAL
+#undef READ_WHITESPACE_REQUIRED
+#undef READ_CRLF_OPTIONAL
+#undef READ_CRLF_REQUIRED
+#undef REQUEST_STATUS_ERROR
+#undef MAX_CONTENT_LENGTH
+
+#endif // GHOTI_WAVE_PARSERSTATEMACHINE_HPP
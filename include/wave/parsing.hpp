@@ -6,15 +6,19 @@
 #ifndef CLIENT_HPP
 #define CLIENT_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <ghoti.io/util/shared_string_view.hpp>
+#include "wave/knownNames.hpp"
 
 namespace Ghoti::Wave {
 
 /**
  * Identify a field name as accepting a list-based set of values.
  *
- * @param name The field name.  The field name must be uppercase.
+ * @param name The field name.  The comparison ignores case.
  * @result Whether or not the field name is recognized as a list-based field.
  */
 bool isListField(const Ghoti::shared_string_view & name);
@@ -75,6 +79,15 @@ bool isQuotedChar(uint8_t c);
  */
 bool isFieldContentChar(uint8_t c);
 
+/**
+ * Identify the characters which may appear in a URI (or a request target),
+ * including the `#` which introduces a fragment.
+ *
+ * @param c The character to test.
+ * @result Whether or not the character may appear in a URI.
+ */
+bool isTargetChar(uint8_t c);
+
 /**
  * Identify CRLF characters.
  *
@@ -83,6 +96,97 @@ bool isFieldContentChar(uint8_t c);
  */
 bool isCRLFChar(uint8_t c);
 
+/**
+ * The implementations available for the character scanning functions.
+ */
+enum class ScanKernel {
+  SCALAR, ///< One byte at a time, using the character tables.
+  SSE4_2, ///< 16 bytes at a time.
+  AVX2,   ///< 32 bytes at a time.
+};
+
+/**
+ * Get the implementation currently used by the character scanning functions.
+ *
+ * The fastest implementation supported by the CPU is selected the first time
+ * that a scanning function is called.
+ *
+ * @result The implementation in use.
+ */
+ScanKernel getScanKernel();
+
+/**
+ * Choose the implementation used by the character scanning functions.
+ *
+ * This is intended for testing and benchmarking.
+ *
+ * @param kernel The implementation to use.
+ * @result Whether or not the implementation is supported by the CPU.  If not,
+ *   then the current implementation is left unchanged.
+ */
+bool setScanKernel(ScanKernel kernel);
+
+/**
+ * Find the first character which is not a valid token character.
+ *
+ * @param data The characters to scan.
+ * @param length The number of characters to scan.
+ * @result The offset of the first non-token character, or `length` if every
+ *   character is a token character.
+ */
+size_t findNonTokenChar(const char * data, size_t length);
+
+/**
+ * Find the first character which is not a valid field-content character.
+ *
+ * @param data The characters to scan.
+ * @param length The number of characters to scan.
+ * @result The offset of the first non-field-content character, or `length`
+ *   if every character is a field-content character.
+ */
+size_t findNonFieldContentChar(const char * data, size_t length);
+
+/**
+ * Find the first character which is not a valid quoted character.
+ *
+ * @param data The characters to scan.
+ * @param length The number of characters to scan.
+ * @result The offset of the first non-quoted character, or `length` if every
+ *   character is a quoted character.
+ */
+size_t findNonQuotedChar(const char * data, size_t length);
+
+/**
+ * Find the first CR or LF character.
+ *
+ * @param data The characters to scan.
+ * @param length The number of characters to scan.
+ * @result The offset of the first CRLF character, or `length` if there is
+ *   none.
+ */
+size_t findCRLFChar(const char * data, size_t length);
+
+/**
+ * Find the first character which is not a valid URI character.
+ *
+ * @param data The characters to scan.
+ * @param length The number of characters to scan.
+ * @result The offset of the first non-URI character, or `length` if every
+ *   character is a URI character.
+ */
+size_t findNonTargetChar(const char * data, size_t length);
+
+/**
+ * Find the first character which may need to be decoded: a `%`, or a `+`
+ * (which is a space in a query string).
+ *
+ * @param data The characters to scan.
+ * @param length The number of characters to scan.
+ * @result The offset of the first such character, or `length` if there is
+ *   none.
+ */
+size_t findEncodedChar(const char * data, size_t length);
+
 /**
  * Indicate whether or not the string contains a character which makes it
  * necessary to wrap the string in double quotes.
@@ -100,6 +204,25 @@ bool fieldValueQuotesNeeded(const Ghoti::shared_string_view & str);
  */
 std::string fieldValueEscape(const Ghoti::shared_string_view & str);
 
+/**
+ * Get the length of a field value once it has been escaped.
+ *
+ * @param str The field value to be escaped.
+ * @result The length of the escaped field value.
+ */
+size_t fieldValueEscapedLength(std::string_view str);
+
+/**
+ * Escape a field value into a buffer.
+ *
+ * The buffer must have room for `fieldValueEscapedLength(str)` characters.
+ *
+ * @param out The buffer.
+ * @param str The field value to be escaped.
+ * @result The end of the escaped field value in the buffer.
+ */
+char * fieldValueEscapeTo(char * out, std::string_view str);
+
 };
 
 #endif // CLIENT_HPP
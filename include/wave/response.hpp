@@ -6,8 +6,85 @@
 #ifndef RESPONSE_HPP
 #define RESPONSE_HPP
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "wave/message.hpp"
+
 namespace Ghoti::Wave {
 
+/**
+ * The response to a single request received by a Server.
+ *
+ * A Response is handed to the Server's request handler along with the
+ * request.  The handler fills in the response Message and then calls
+ * Response.complete(), either before it returns or later, from any thread.
+ * The response is not sent until it has been completed, and responses on a
+ * connection are always sent in the order that the requests were received.
+ */
+class Response {
+  public:
+  /**
+   * The constructor.
+   *
+   * @param onComplete Called (once) when Response.complete() is called.
+   */
+  Response(std::function<void()> && onComplete);
+
+  /**
+   * Construct a Response around an existing (e.g., pooled) Message.
+   *
+   * @param onComplete Called (once) when Response.complete() is called.
+   * @param message The response Message, which must be newly constructed
+   *   (or reset).
+   */
+  Response(std::function<void()> && onComplete, std::shared_ptr<Message> && message);
+
+  Response(const Response &) = delete;
+  Response & operator=(const Response &) = delete;
+
+  /**
+   * Get the response Message.
+   *
+   * The Message must not be modified after Response.complete() has been
+   * called.
+   *
+   * @return The response Message.
+   */
+  Message & getMessage();
+
+  /**
+   * Mark the response as ready to be sent.
+   *
+   * Only the first call has any effect.  This function may be called from any
+   * thread.
+   */
+  void complete();
+
+  /**
+   * Whether or not Response.complete() has been called.
+   *
+   * @return `true` if the response is ready to be sent.
+   */
+  bool isComplete() const;
+
+  private:
+  /**
+   * The response Message.
+   */
+  std::shared_ptr<Message> message;
+
+  /**
+   * Called when the response is completed.
+   */
+  std::function<void()> onComplete;
+
+  /**
+   * Whether or not the response has been completed.
+   */
+  std::atomic<bool> completed;
+};
+
 };
 
 #endif // RESPONSE_HPP
@@ -7,16 +7,19 @@
 #ifndef GHOTI_WAVE_SERVER_HPP
 #define GHOTI_WAVE_SERVER_HPP
 
-#include <ghoti.io/pool.hpp>
 #include <any>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 #include "wave/hasServerParameters.hpp"
+#include "wave/message.hpp"
+#include "wave/response.hpp"
 
 namespace Ghoti::Wave {
-class ServerSession;
+class ServerReactor;
 
 /**
  * The base Server class.
@@ -37,6 +40,19 @@ class Server : public Ghoti::Wave::HasServerParameters {
     START_FAILED,           ///< The server could not be started.
   };
 
+  /**
+   * The function called to answer each request.
+   *
+   * The handler is run on a handler thread, never while the connection's
+   * socket is being read or written.  The handler threads are separate from
+   * the threads which perform the socket I/O, so a handler may block.  It must fill in the response and call
+   * Response.complete(), which it may do after returning, from any thread.
+   *
+   * @param request The request Message.
+   * @param response The Response to complete.
+   */
+  using Handler = std::function<void(std::shared_ptr<Message> request, std::shared_ptr<Response> response)>;
+
   /**
    * The constructor.
    *
@@ -135,7 +151,28 @@ class Server : public Ghoti::Wave::HasServerParameters {
   const std::string & getAddress() const;
 
   /**
-   * Returns the socket handle of the server (if set).
+   * Set the function which answers requests.
+   *
+   * This setting cannot be changed if the server is running.  If the server is
+   * running, then an error will be set.
+   *
+   * By default, every request is answered with `200 "Hello World!"`.
+   *
+   * @param handler The request handler.
+   * @returns The server object.
+   */
+  Server & setHandler(Handler && handler);
+
+  /**
+   * Return the server's request handler.
+   *
+   * @returns The request handler.
+   */
+  const Handler & getHandler() const;
+
+  /**
+   * Returns the listening socket handle of the server's first reactor (if
+   * set).
    *
    * @returns The socket handle of the server.
    */
@@ -155,15 +192,6 @@ class Server : public Ghoti::Wave::HasServerParameters {
    */
   Server & stop();
 
-  /**
-   * The Dispatch loop used by the thread pool to handle asynchronous reading
-   * and writing of the server ports.
-   *
-   * @param stop_token The stop token provided by the jthread to indicate that
-   *   the thread should be safely shut down.
-   */
-  void dispatchLoop(std::stop_token stoken);
-
   /**
    * Provide a default value for the provided parameter key.
    *
@@ -178,23 +206,13 @@ class Server : public Ghoti::Wave::HasServerParameters {
 
   private:
   /**
-   * The thread pool worker queue.
-   */
-  Ghoti::Pool::Pool workers;
-
-  /**
-   * Stores active sessions.
+   * The reactors which service the server's connections.
    *
-   * The sessions are keyed by the socket handle to which the session is
-   * associated.
+   * Each reactor has its own listening socket, dispatch thread, worker and
+   * handler pools, and session table.  The number of reactors is controlled by
+   * ServerParameter::REACTORCOUNT.
    */
-  std::map<int, std::shared_ptr<Ghoti::Wave::ServerSession>> sessions;
-
-  /**
-   * The dispatch thread used to monitor for new connections and to dispatch
-   * read/write tasks as needed by the sessions.
-   */
-  std::jthread dispatchThread;
+  std::vector<std::unique_ptr<Ghoti::Wave::ServerReactor>> reactors;
 
   /**
    * The most recently generated error code.
@@ -211,11 +229,6 @@ class Server : public Ghoti::Wave::HasServerParameters {
    */
   bool running;
 
-  /**
-   * The socket handle to which the running server is attached.
-   */
-  int hSocket;
-
   /**
    * The ip address that the server is configured to use.
    */
@@ -225,6 +238,11 @@ class Server : public Ghoti::Wave::HasServerParameters {
    * The port that the server is configured to use.
    */
   uint16_t port;
+
+  /**
+   * The function which answers requests.
+   */
+  Handler handler;
 };
 
 }
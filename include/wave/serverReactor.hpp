@@ -0,0 +1,367 @@
+/**
+ * @file
+ *
+ * Header file for declaring the ServerReactor class.
+ */
+
+#ifndef GHOTI_WAVE_SERVERREACTOR_HPP
+#define GHOTI_WAVE_SERVERREACTOR_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wave/bufferPool.hpp"
+#include "wave/messagePool.hpp"
+#include "wave/workerPool.hpp"
+
+namespace Ghoti::Wave {
+class Server;
+class ServerSession;
+
+/**
+ * A single dispatch loop of a Server.
+ *
+ * Each reactor owns one listening socket, its own dispatch thread, its own
+ * worker pool (for socket I/O), its own handler pool (for request handlers),
+ * and its own session table.  A Server runs one or more reactors, each of
+ * which listens on the same address and port using `SO_REUSEPORT`, so that
+ * the kernel spreads incoming connections across them.
+ */
+class ServerReactor {
+  public:
+  /**
+   * The constructor.
+   *
+   * The constructor only creates the reactor object.  ServerReactor.start()
+   * must be called before it will service connections.
+   *
+   * @param server A pointer to the parent Server object, from which the
+   *   reactor and its sessions will get their parameters.
+   */
+  ServerReactor(Server * server);
+
+  /**
+   * The destructor.
+   *
+   * The destructor will call ServerReactor.stop().
+   */
+  ~ServerReactor();
+
+  /**
+   * Begin servicing connections from a listening socket.
+   *
+   * The reactor takes ownership of the socket, and will close it when the
+   * reactor is stopped (even if this function fails).
+   *
+   * @param hSocket The listening socket.
+   * @return `true` on success, `false` on failure, in which case
+   *   ServerReactor.getErrorMessage() will describe the problem.
+   */
+  bool start(int hSocket);
+
+  /**
+   * Stop the dispatch thread, close all sessions, and close the listening
+   * socket.
+   */
+  void stop();
+
+  /**
+   * Returns the listening socket handle of the reactor (if set).
+   *
+   * @returns The listening socket handle.
+   */
+  int getSocketHandle() const;
+
+  /**
+   * Returns an error message string generated by ServerReactor.start(), or by
+   * the dispatch thread if it stopped because of an error.
+   *
+   * An error from the dispatch thread may only be read once the reactor has
+   * been stopped.
+   *
+   * @returns The error message string.
+   */
+  const std::string & getErrorMessage() const;
+
+  private:
+  /**
+   * The Dispatch loop used by the thread pool to handle asynchronous reading
+   * and writing of the server ports.
+   *
+   * @param stop_token The stop token provided by the jthread to indicate that
+   *   the thread should be safely shut down.
+   */
+  void dispatchLoop(std::stop_token stoken);
+
+  /**
+   * Run the dispatch loop using epoll readiness notifications.
+   *
+   * @param stoken The stop token provided by the jthread.
+   * @param pool The worker pool.
+   * @param handlers The handler pool.
+   */
+  void dispatchEpoll(std::stop_token stoken, WorkerPool & pool, WorkerPool & handlers);
+
+  /**
+   * Run the dispatch loop using io_uring completions.
+   *
+   * @param stoken The stop token provided by the jthread.
+   * @param pool The worker pool.
+   * @param handlers The handler pool.
+   * @return `false` if io_uring could not be initialized, in which case the
+   *   caller should fall back to ServerReactor::dispatchEpoll().
+   */
+  bool dispatchIoUring(std::stop_token stoken, WorkerPool & pool, WorkerPool & handlers);
+
+  /**
+   * Queue a job on the handler pool to run the Server's request handler for
+   * each request that the session has parsed.
+   *
+   * @param handlers The handler pool.
+   * @param session The session.
+   */
+  void dispatchRequests(WorkerPool & handlers, ServerSession & session);
+
+  /**
+   * Create the callback used by a session to report that one of its
+   * responses has been completed.
+   *
+   * @param hClient The socket handle of the session.
+   * @return The callback.
+   */
+  std::function<void()> makeResponseReadyCallback(int hClient);
+
+  /**
+   * Inform the dispatch thread that a session has a completed response to
+   * write.
+   *
+   * This function may be called from any thread.
+   *
+   * @param hClient The socket handle of the session.
+   */
+  void responseReady(int hClient);
+
+  /**
+   * Take the socket handles of the sessions which have reported completed
+   * responses since the last call.
+   *
+   * @return The socket handles.
+   */
+  std::vector<int> takeReadySessions();
+
+  /**
+   * Create the callback used by a session to report that the handler has
+   * resumed a paused request body.
+   *
+   * @param hClient The socket handle of the session.
+   * @return The callback.
+   */
+  std::function<void()> makeInputResumedCallback(int hClient);
+
+  /**
+   * Inform the dispatch thread that a session's input should be read again.
+   *
+   * This function may be called from any thread.
+   *
+   * @param hClient The socket handle of the session.
+   */
+  void inputResumed(int hClient);
+
+  /**
+   * Take the socket handles of the sessions which have reported resumed input
+   * since the last call.
+   *
+   * @return The socket handles.
+   */
+  std::vector<int> takeResumedSessions();
+
+  /**
+   * The progress made by a worker in sending a file segment of a session's
+   * output.
+   */
+  struct FileProgress {
+    /**
+     * The socket handle of the session.
+     */
+    int hClient;
+
+    /**
+     * The number of bytes of the segment that were sent.
+     */
+    size_t bytesSent;
+
+    /**
+     * The `errno` value which stopped the send before the end of the segment,
+     * or 0.
+     */
+    int error;
+  };
+
+  /**
+   * Inform the dispatch thread that a worker has stopped sending a file
+   * segment.
+   *
+   * This function may be called from any thread.
+   *
+   * @param progress The progress of the send.
+   */
+  void fileSent(FileProgress progress);
+
+  /**
+   * Take the progress of the file segment sends which have stopped since the
+   * last call.
+   *
+   * @return The progress of each send.
+   */
+  std::vector<FileProgress> takeSentFiles();
+
+  /**
+   * Accept all pending connections on the listening socket.
+   *
+   * The listening socket is registered as edge-triggered, so this function
+   * must drain `accept4()` until it would block, otherwise connections will
+   * be left waiting until the next connection arrives.
+   */
+  void acceptConnections();
+
+  /**
+   * Inform the dispatch thread that a session has finished and may be
+   * removed from the session table.
+   *
+   * This function is intended to be called from the worker threads.
+   *
+   * @param hClient The socket handle of the finished session.
+   */
+  void retireSession(int hClient);
+
+  /**
+   * Remove all sessions that have been retired from the session table.
+   *
+   * This function must only be called from the dispatch thread.
+   */
+  void reapSessions();
+
+  /**
+   * Interrupt the dispatch thread if it is waiting on `epoll_wait()`.
+   */
+  void wake();
+
+  /**
+   * Forwards response completions to the reactor.
+   *
+   * A handler may complete a response after the reactor has been stopped, so
+   * the completion callbacks refer to this shared object rather than to the
+   * reactor itself, and ServerReactor.stop() detaches it.
+   */
+  struct CompletionSink {
+    /**
+     * Used to synchronize access to `reactor`.
+     */
+    std::mutex mutex;
+
+    /**
+     * The reactor, or `nullptr` once it has been stopped.
+     */
+    ServerReactor * reactor;
+  };
+
+  /**
+   * A pointer to the server object.
+   */
+  Server * server;
+
+  /**
+   * The target of the sessions' response completion callbacks.
+   */
+  std::shared_ptr<CompletionSink> completionSink;
+
+  /**
+   * The pool from which the sessions borrow read buffers.
+   */
+  std::shared_ptr<BufferPool> bufferPool;
+
+  /**
+   * The pool from which the sessions take requests and responses.
+   */
+  std::shared_ptr<MessagePool> messagePool;
+
+  /**
+   * Stores active sessions.
+   *
+   * The sessions are keyed by the socket handle to which the session is
+   * associated.
+   */
+  std::map<int, std::shared_ptr<Ghoti::Wave::ServerSession>> sessions;
+
+  /**
+   * The dispatch thread used to monitor for new connections and to dispatch
+   * read/write tasks as needed by the sessions.
+   */
+  std::jthread dispatchThread;
+
+  /**
+   * The listening socket handle.
+   */
+  int hSocket;
+
+  /**
+   * The epoll handle which monitors the listening socket and all session
+   * sockets for readiness.
+   */
+  int hEpoll;
+
+  /**
+   * An eventfd handle, registered with `hEpoll`, that is used to wake the
+   * dispatch thread from other threads.
+   */
+  int hWake;
+
+  /**
+   * Used to synchronize access to `retiredSessions`.
+   */
+  std::mutex retiredMutex;
+
+  /**
+   * The socket handles of sessions which have finished, but which have not
+   * yet been removed from the session table by the dispatch thread.
+   */
+  std::vector<int> retiredSessions;
+
+  /**
+   * Used to synchronize access to `readySessions`, `resumedSessions`, and
+   * `sentFiles`.
+   */
+  std::mutex readyMutex;
+
+  /**
+   * The socket handles of sessions which have completed responses that the
+   * dispatch thread has not yet scheduled to be written.
+   */
+  std::vector<int> readySessions;
+
+  /**
+   * The socket handles of sessions whose paused input has been resumed, which
+   * the dispatch thread has not yet scheduled to be read.
+   */
+  std::vector<int> resumedSessions;
+
+  /**
+   * The progress of the file segment sends which the dispatch thread has not
+   * yet continued.
+   */
+  std::vector<FileProgress> sentFiles;
+
+  /**
+   * The most recently generated error message.
+   */
+  std::string errorMessage;
+};
+
+}
+
+#endif // GHOTI_WAVE_SERVERREACTOR_HPP
+
@@ -8,15 +8,23 @@
 #define GHOTI_WAVE_SERVERSESSION_HPP
 
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <ghoti.io/pool.hpp>
 #include <ghoti.io/util/hasParameters.hpp>
+#include <ghoti.io/util/shared_string_view.hpp>
 #include <memory>
 #include <map>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <vector>
+#include "wave/bufferPool.hpp"
+#include "wave/messagePool.hpp"
 #include "wave/message.hpp"
+#include "wave/outputQueue.hpp"
 #include "wave/parser.hpp"
+#include "wave/response.hpp"
 #include "wave/server.hpp"
 
 namespace Ghoti::Wave {
@@ -31,8 +39,17 @@ class ServerSession : public HasServerParameters {
    *
    * @param hClient The socket handle to the client connection.
    * @param server A pointer to the parent Server object.
+   * @param bufferPool The pool from which read buffers are borrowed.
+   * @param messagePool The pool from which requests and responses are
+   *   taken.
+   * @param onResponseReady Called (from any thread) whenever one of the
+   *   session's responses is completed, so that the caller can schedule it to
+   *   be written.
+   * @param onInputResumed Called (from any thread) whenever the handler
+   *   resumes a paused request body, so that the caller can schedule the
+   *   input to be read again.
    */
-  ServerSession(int hClient, Server * server);
+  ServerSession(int hClient, Server * server, std::shared_ptr<BufferPool> bufferPool, std::shared_ptr<MessagePool> messagePool, std::function<void()> onResponseReady, std::function<void()> onInputResumed);
 
   /**
    * The destructor.
@@ -74,11 +91,25 @@ class ServerSession : public HasServerParameters {
   /**
    * Perform a read from the session.
    *
+   * Reading stops early when a request with a streamed body has been parsed,
+   * so that it can be passed to the handler (see
+   * ServerSession.hasDeferredInput()), or when the handler has paused the
+   * body.
+   *
    * This function is intended to be called by the server's thread pool worker
    * queue, probably in a lambda expression.
    */
   void read();
 
+  /**
+   * Whether or not the last ServerSession.read() stopped early so that a
+   * request with a streamed body could be passed to the handler, in which case
+   * the caller should dispatch the request and then read again.
+   *
+   * @return `true` if the caller should call ServerSession.read() again.
+   */
+  bool hasDeferredInput();
+
   /**
    * Used to synchronize access to the session to make it thread safe.
    */
@@ -92,6 +123,13 @@ class ServerSession : public HasServerParameters {
   /**
    * Perform a write to the session.
    *
+   * The ready responses are serialized once into `output`, which is then
+   * drained with scatter/gather `sendmsg()` (or `sendfile()` for file-backed
+   * bodies) directly from their existing storage.  Responses are written
+   * until either the pipeline is empty or the socket would block, in which
+   * case the Server will call this function again once the socket becomes
+   * writable.
+   *
    * This function is intended to be called by the server's thread pool worker
    * queue, probably in a lambda expression.
    */
@@ -105,7 +143,136 @@ class ServerSession : public HasServerParameters {
    */
   void removeCompletedMessage();
 
+  /**
+   * Queue a block of bytes which was received from the socket by the Server
+   * (rather than by ServerSession.read()).
+   *
+   * This is used by completion-based I/O backends, where the Server performs
+   * the receive itself.
+   *
+   * The block is handed to the parser as its input, without being copied
+   * again.
+   *
+   * @param block The received bytes.
+   * @return `true` if the caller must schedule ServerSession.processInput(),
+   *   `false` if processing is already scheduled.
+   */
+  bool pushInput(Ghoti::shared_string_view && block);
+
+  /**
+   * Indicate that the client has closed the connection (or that the receive
+   * failed), so no more input will be pushed.
+   *
+   * @return `true` if the caller must schedule ServerSession.processInput(),
+   *   `false` if processing is already scheduled.
+   */
+  bool closeInput();
+
+  /**
+   * Parse the input queued by ServerSession.pushInput().
+   *
+   * Parsing stops early, leaving the rest of the input queued, when a request
+   * with a streamed body has been parsed (so that it can be passed to the
+   * handler), or when the handler has paused the body.
+   */
+  void processInput();
+
+  /**
+   * Release the processing scheduled by ServerSession.pushInput(), unless
+   * more input arrived while it was running.
+   *
+   * Queued input is ignored while the handler has paused a request body.
+   *
+   * @return `true` if processing is no longer scheduled, `false` if the
+   *   caller must call ServerSession.processInput() again.
+   */
+  bool releaseInput();
+
+  /**
+   * Schedule the processing of the queued input after the handler has
+   * resumed a paused request body.
+   *
+   * @return `true` if the caller must schedule ServerSession.processInput(),
+   *   `false` if processing is already scheduled.
+   */
+  bool resumeInput();
+
+  /**
+   * Take the requests which have been parsed, but which have not yet been
+   * passed to the request handler.
+   *
+   * The caller is responsible for running the Server's handler for each of
+   * them, without holding any of the session's locks.
+   *
+   * @return The `<request, response>` pairs, in the order received.
+   */
+  std::vector<std::pair<std::shared_ptr<Message>, std::shared_ptr<Response>>> takeRequests();
+
+  /**
+   * Serialize the completed responses at the front of the pipeline, removing
+   * them from the pipeline.
+   *
+   * This is used by completion-based I/O backends, where the Server performs
+   * the send itself.  The returned segments must be sent in order.
+   *
+   * @return The serialized response segments.
+   */
+  std::vector<OutputSegment> collectOutput();
+
   private:
+  /**
+   * Parse a block of bytes and create a pending Response for each completed
+   * request.
+   *
+   * It is up to the caller to ensure that the control mutex is properly locked
+   * before calling this function.
+   *
+   * @param buffer The bytes to parse.
+   * @param len The number of bytes.
+   */
+  void receive(const char * buffer, size_t len);
+
+  /**
+   * Parse a block of bytes which is already held in a reference-counted
+   * input block, and create a pending Response for each completed request.
+   *
+   * It is up to the caller to ensure that the control mutex is properly locked
+   * before calling this function.
+   *
+   * @param block The bytes to parse.
+   */
+  void receive(const Ghoti::shared_string_view & block);
+
+  /**
+   * Create a pending Response for each request completed by the parser.
+   *
+   * It is up to the caller to ensure that the control mutex is properly locked
+   * before calling this function.
+   */
+  void queueParsedRequests();
+
+  /**
+   * Serialize the responses at the front of the pipeline which are ready to
+   * be sent, removing them from the pipeline.
+   *
+   * It is up to the caller to ensure that the control mutex is properly locked
+   * before calling this function.
+   *
+   * @return The serialized response segments.
+   */
+  std::vector<OutputSegment> takeOutput();
+
+  /**
+   * Whether or not the handler has paused the request body which is being
+   * received, so no more input should be parsed.
+   *
+   * It is up to the caller to ensure that the control mutex is properly locked
+   * before calling this function.
+   *
+   * @return `true` if the input is paused.
+   */
+  bool isInputPaused() const;
+
   /**
    * The socket handle to the client.
    */
@@ -116,12 +283,6 @@ class ServerSession : public HasServerParameters {
    */
   size_t requestSequence;
 
-  /**
-   * A byte offset used to track how many bytes of a message have been written,
-   * so that individual write attempts do not duplicate data.
-   */
-  size_t writeOffset;
-
   /**
    * A counter to track which chunk is being written.
    */
@@ -148,17 +309,86 @@ class ServerSession : public HasServerParameters {
    */
   Server * server;
 
+  /**
+   * The pool from which read buffers are borrowed.
+   */
+  std::shared_ptr<BufferPool> bufferPool;
+
+  /**
+   * The pool from which requests and responses are taken.
+   */
+  std::shared_ptr<MessagePool> messagePool;
+
+  /**
+   * Called whenever one of the session's responses is completed.
+   */
+  std::function<void()> onResponseReady;
+
+  /**
+   * Called whenever the handler resumes a paused request body.
+   */
+  std::function<void()> onInputResumed;
+
+  /**
+   * The stream of the request body which is being received, if it is
+   * streamed.
+   */
+  std::shared_ptr<BodyStream> bodyStream;
+
+  /**
+   * Whether or not reading stopped early so that a request with a streamed
+   * body could be passed to the handler.
+   */
+  bool inputDeferred;
+
   /**
    * Tracks request/response pairs.
    *
    * `messages[request sequence #] = <request, response>`
    */
-  std::map<uint64_t, std::pair<std::shared_ptr<Message>, std::shared_ptr<Message>>> messages;
+  std::map<uint64_t, std::pair<std::shared_ptr<Message>, std::shared_ptr<Response>>> messages;
+
+  /**
+   * Requests which have not yet been passed to the request handler.
+   */
+  std::vector<std::pair<std::shared_ptr<Message>, std::shared_ptr<Response>>> newRequests;
 
   /**
    * Simple queue to track which request sequence # should be parsed next.
    */
   std::queue<uint64_t> pipeline;
+
+  /**
+   * Used to synchronize access to the pushed input queue.
+   */
+  std::unique_ptr<std::mutex> inputMutex;
+
+  /**
+   * Input pushed by the Server which has not yet been parsed.
+   */
+  std::deque<Ghoti::shared_string_view> pendingInput;
+
+  /**
+   * Whether or not ServerSession.processInput() is scheduled.
+   */
+  bool inputScheduled;
+
+  /**
+   * Whether or not the Server has reported that the input is closed.
+   */
+  bool inputClosed;
+
+  /**
+   * Whether or not ServerSession.processInput() has observed that the input
+   * is closed.
+   */
+  bool inputClosedSeen;
+
+  /**
+   * Serialized responses which have not yet been completely written by
+   * ServerSession.write().
+   */
+  OutputQueue output;
 };
 
 }
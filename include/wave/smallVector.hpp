@@ -0,0 +1,272 @@
+/**
+ * @file
+ *
+ * Header file for declaring the SmallVector class.
+ */
+
+#ifndef GHOTI_WAVE_SMALLVECTOR_HPP
+#define GHOTI_WAVE_SMALLVECTOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace Ghoti::Wave {
+
+/**
+ * A contiguous vector which stores its first `N` elements inside the object
+ * itself, and only allocates once it grows beyond them.
+ *
+ * @tparam T The element type.
+ * @tparam N The number of elements stored inline.
+ */
+template <typename T, size_t N>
+class SmallVector {
+  public:
+  /**
+   * The constructor.
+   */
+  SmallVector() noexcept : elements{this->inlineElements()}, count{0}, capacity{N} {}
+
+  /**
+   * The copy constructor.
+   *
+   * @param source The vector to copy.
+   */
+  SmallVector(const SmallVector & source) : SmallVector() {
+    this->reserve(source.count);
+    for (auto & element : source) {
+      this->emplace_back(element);
+    }
+  }
+
+  /**
+   * The move constructor.
+   *
+   * @param source The vector to move from.  It is left empty.
+   */
+  SmallVector(SmallVector && source) : SmallVector() {
+    this->adopt(source);
+  }
+
+  /**
+   * The copy assignment operator.
+   *
+   * @param source The vector to copy.
+   * @return The vector.
+   */
+  SmallVector & operator=(const SmallVector & source) {
+    if (this != &source) {
+      this->clear();
+      this->reserve(source.count);
+      for (auto & element : source) {
+        this->emplace_back(element);
+      }
+    }
+    return *this;
+  }
+
+  /**
+   * The move assignment operator.
+   *
+   * @param source The vector to move from.  It is left empty.
+   * @return The vector.
+   */
+  SmallVector & operator=(SmallVector && source) {
+    if (this != &source) {
+      this->clear();
+      this->releaseHeap();
+      this->adopt(source);
+    }
+    return *this;
+  }
+
+  /**
+   * The destructor.
+   */
+  ~SmallVector() {
+    this->clear();
+    this->releaseHeap();
+  }
+
+  /**
+   * Construct a new element at the end of the vector.
+   *
+   * @param args The arguments for the element's constructor.
+   * @return The new element.
+   */
+  template <typename... Args>
+  T & emplace_back(Args &&... args) {
+    if (this->count == this->capacity) {
+      // The new element is constructed before the existing elements are
+      // moved, in case it is being copied from one of them.
+      size_t newCapacity = this->capacity * 2;
+      T * newElements = std::allocator<T>{}.allocate(newCapacity);
+      new (newElements + this->count) T(std::forward<Args>(args)...);
+      this->moveElements(newElements);
+      this->releaseHeap();
+      this->elements = newElements;
+      this->capacity = newCapacity;
+    }
+    else {
+      new (this->elements + this->count) T(std::forward<Args>(args)...);
+    }
+    return this->elements[this->count++];
+  }
+
+  /**
+   * Make room for at least `size` elements.
+   *
+   * @param size The number of elements.
+   */
+  void reserve(size_t size) {
+    if (size > this->capacity) {
+      T * newElements = std::allocator<T>{}.allocate(size);
+      this->moveElements(newElements);
+      this->releaseHeap();
+      this->elements = newElements;
+      this->capacity = size;
+    }
+  }
+
+  /**
+   * Remove all elements.  Any heap storage is kept for reuse.
+   */
+  void clear() {
+    std::destroy(this->elements, this->elements + this->count);
+    this->count = 0;
+  }
+
+  /**
+   * Get the number of elements.
+   *
+   * @return The number of elements.
+   */
+  size_t size() const {
+    return this->count;
+  }
+
+  /**
+   * Whether or not the vector has no elements.
+   *
+   * @return `true` if the vector is empty.
+   */
+  bool empty() const {
+    return !this->count;
+  }
+
+  /**
+   * Access an element.
+   *
+   * @param index The index of the element.
+   * @return The element.
+   */
+  T & operator[](size_t index) {
+    return this->elements[index];
+  }
+
+  /**
+   * Access an element.
+   *
+   * @param index The index of the element.
+   * @return The element.
+   */
+  const T & operator[](size_t index) const {
+    return this->elements[index];
+  }
+
+  T * begin() {
+    return this->elements;
+  }
+
+  T * end() {
+    return this->elements + this->count;
+  }
+
+  const T * begin() const {
+    return this->elements;
+  }
+
+  const T * end() const {
+    return this->elements + this->count;
+  }
+
+  private:
+  /**
+   * Get the inline storage.
+   *
+   * @return The inline storage.
+   */
+  T * inlineElements() {
+    return reinterpret_cast<T *>(this->storage);
+  }
+
+  /**
+   * Move the elements to new storage, and destroy the originals.
+   *
+   * @param destination The new storage.
+   */
+  void moveElements(T * destination) {
+    std::uninitialized_move(this->elements, this->elements + this->count, destination);
+    std::destroy(this->elements, this->elements + this->count);
+  }
+
+  /**
+   * Free the heap storage, if any, and return to the inline storage.
+   *
+   * There must not be any elements.
+   */
+  void releaseHeap() {
+    if (this->elements != this->inlineElements()) {
+      std::allocator<T>{}.deallocate(this->elements, this->capacity);
+      this->elements = this->inlineElements();
+      this->capacity = N;
+    }
+  }
+
+  /**
+   * Take the elements of another (empty) vector.
+   *
+   * Heap storage is taken over directly, but inline elements must be moved.
+   *
+   * @param source The vector to move from.  It is left empty.
+   */
+  void adopt(SmallVector & source) {
+    if (source.elements != source.inlineElements()) {
+      this->elements = std::exchange(source.elements, source.inlineElements());
+      this->capacity = std::exchange(source.capacity, N);
+      this->count = std::exchange(source.count, 0);
+    }
+    else {
+      std::uninitialized_move(source.elements, source.elements + source.count, this->elements);
+      this->count = source.count;
+      source.clear();
+    }
+  }
+
+  /**
+   * The inline storage.
+   */
+  alignas(T) std::byte storage[N * sizeof(T)];
+
+  /**
+   * The storage in use, either inline or on the heap.
+   */
+  T * elements;
+
+  /**
+   * The number of elements.
+   */
+  size_t count;
+
+  /**
+   * The number of elements that the storage can hold.
+   */
+  size_t capacity;
+};
+
+}
+
+#endif // GHOTI_WAVE_SMALLVECTOR_HPP
+
@@ -0,0 +1,259 @@
+/**
+ * @file
+ *
+ * Header file for declaring the Target class.
+ */
+
+#ifndef GHOTI_WAVE_TARGET_HPP
+#define GHOTI_WAVE_TARGET_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <ghoti.io/util/shared_string_view.hpp>
+
+namespace Ghoti::Wave {
+
+/**
+ * The request target of a Message, split into its components.
+ * https://datatracker.ietf.org/doc/html/rfc9112#section-3.2
+ *
+ * Every component is a view into the original target text, so parsing never
+ * copies or allocates.  Only the position of each component is stored, so a
+ * Target is little bigger than the text itself.  The components are not percent-decoded; a component
+ * is only decoded (and only copied, if it actually contains an escape) when
+ * it is passed to Target::decode(), or when a value is requested by name.
+ *
+ * The query string is split into its parameters the first time that they are
+ * accessed.  Because of this, even reading the target modifies it, so it must
+ * not be accessed by more than one thread at a time.
+ */
+class Target {
+  public:
+  /**
+   * The form of a request target.
+   */
+  enum class Form {
+    INVALID,   ///< The target is empty or malformed.
+    ORIGIN,    ///< An absolute path, with an optional query (`/a/b?c=d`).
+    ABSOLUTE,  ///< An absolute URI (`http://example.com/a?b=c`).
+    AUTHORITY, ///< A host and port, as used by CONNECT (`example.com:443`).
+    ASTERISK,  ///< The server as a whole, as used by OPTIONS (`*`).
+  };
+
+  /**
+   * One `name=value` parameter of a query string, not yet decoded.
+   */
+  struct QueryParameter {
+    Ghoti::shared_string_view name;  ///< The parameter name.
+    Ghoti::shared_string_view value; ///< The parameter value, which is empty
+                                     ///<   if there was no `=`.
+  };
+
+  /**
+   * The query parameters, in the order that they appear.
+   */
+  using QueryParameters = std::vector<QueryParameter>;
+
+  /**
+   * The default constructor, which creates an empty (invalid) target.
+   */
+  Target();
+
+  /**
+   * Parse a request target.
+   *
+   * @param text The request target.
+   */
+  Target(const Ghoti::shared_string_view & text);
+
+  /**
+   * Get the request target, as provided.
+   *
+   * @return The request target.
+   */
+  const Ghoti::shared_string_view & getText() const;
+
+  /**
+   * Get the form of the request target.
+   *
+   * @return The Target::Form, which is Form::INVALID if the target could not
+   *   be parsed.
+   */
+  Form getForm() const;
+
+  /**
+   * Get the scheme of an absolute-form target (e.g., `http`).
+   *
+   * @return The scheme, or an empty view.
+   */
+  Ghoti::shared_string_view getScheme() const;
+
+  /**
+   * Get the host of an absolute-form or authority-form target.  An IPv6
+   * address keeps its square brackets.
+   *
+   * @return The host, or an empty view.
+   */
+  Ghoti::shared_string_view getHost() const;
+
+  /**
+   * Get the port of an absolute-form or authority-form target.
+   *
+   * @return The port digits, or an empty view.
+   */
+  Ghoti::shared_string_view getPort() const;
+
+  /**
+   * Get the path.  The path of an absolute-form target may be empty.
+   *
+   * @return The path, still percent-encoded.
+   */
+  Ghoti::shared_string_view getPath() const;
+
+  /**
+   * Get the query string, without the leading `?`.
+   *
+   * @return The query string, still percent-encoded.
+   */
+  Ghoti::shared_string_view getQuery() const;
+
+  /**
+   * Get the fragment, without the leading `#`.  A fragment is not sent in a
+   * request, but it may be present in a target provided to a Client.
+   *
+   * @return The fragment, still percent-encoded.
+   */
+  Ghoti::shared_string_view getFragment() const;
+
+  /**
+   * Get the parameters of the query string.
+   *
+   * The query string is split at each `&`, and each parameter at its first
+   * `=`.  Empty parameters are ignored.
+   *
+   * @return The parameters, still percent-encoded.
+   */
+  const QueryParameters & getQueryParameters() const;
+
+  /**
+   * Get the decoded value of the first query parameter with the given
+   * (decoded) name.
+   *
+   * @param name The parameter name.
+   * @return The decoded value, or `std::nullopt` if there is no such
+   *   parameter.
+   */
+  std::optional<Ghoti::shared_string_view> getQueryParameter(std::string_view name) const;
+
+  /**
+   * Decode the percent-encoded octets of a component.
+   *
+   * If there is nothing to decode, then the component itself is returned,
+   * without copying it.  A `%` which is not followed by two hexadecimal
+   * digits is kept as it is.
+   *
+   * @param text The component.
+   * @param plusIsSpace Whether or not `+` represents a space, as it does in
+   *   a query string.
+   * @return The decoded component.
+   */
+  static Ghoti::shared_string_view decode(const Ghoti::shared_string_view & text, bool plusIsSpace = false);
+
+  private:
+  /**
+   * The position of a component within the target text.
+   */
+  struct Component {
+    uint32_t start;  ///< The offset of the first character.
+    uint32_t length; ///< The number of characters.
+
+    /**
+     * Describe a component by its start and end offsets.
+     *
+     * @param start The offset of the first character.
+     * @param end The offset following the last character.
+     * @return The component.
+     */
+    static Component between(size_t start, size_t end);
+  };
+
+  /**
+   * Get a view of a component.
+   *
+   * @param component The component.
+   * @return A view into the target text.
+   */
+  Ghoti::shared_string_view view(Component component) const;
+
+  /**
+   * Split the target into its components.
+   *
+   * @return The form of the target.
+   */
+  Form parse();
+
+  /**
+   * Split an authority into its host and port.
+   *
+   * @param start The offset of the authority, which may include userinfo.
+   * @param end The offset of the end of the authority.
+   * @return Whether or not the authority is valid.
+   */
+  bool parseAuthority(size_t start, size_t end);
+
+  /**
+   * The request target, as provided.
+   */
+  Ghoti::shared_string_view text;
+
+  /**
+   * The form of the target.
+   */
+  Form form;
+
+  /**
+   * The scheme of an absolute-form target.
+   */
+  Component scheme;
+
+  /**
+   * The host of an absolute-form or authority-form target.
+   */
+  Component host;
+
+  /**
+   * The port of an absolute-form or authority-form target.
+   */
+  Component port;
+
+  /**
+   * The path.
+   */
+  Component path;
+
+  /**
+   * The query string.
+   */
+  Component query;
+
+  /**
+   * The fragment.
+   */
+  Component fragment;
+
+  /**
+   * The query parameters, once the query string has been split.
+   */
+  mutable QueryParameters parameters;
+
+  /**
+   * Whether or not the query string has been split into `parameters`.
+   */
+  mutable bool parametersSplit;
+};
+
+}
+
+#endif // GHOTI_WAVE_TARGET_HPP
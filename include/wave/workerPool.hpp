@@ -0,0 +1,160 @@
+/**
+ * @file
+ *
+ * Header file for declaring the WorkerPool class.
+ */
+
+#ifndef GHOTI_WAVE_WORKERPOOL_HPP
+#define GHOTI_WAVE_WORKERPOOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Ghoti::Wave {
+
+/**
+ * A pool of worker threads which grows and shrinks with the workload.
+ *
+ * The pool always keeps at least `minThreads` workers.  When a job is queued
+ * and there are more queued jobs than idle workers, a new worker is started,
+ * up to `maxThreads`.  A worker which has been idle for longer than the idle
+ * timeout exits, as long as more than `minThreads` workers remain.
+ *
+ * Jobs may be queued from any thread.
+ */
+class WorkerPool {
+  public:
+  /**
+   * A unit of work to be run by a worker.
+   */
+  using Job = std::function<void()>;
+
+  /**
+   * The constructor.
+   *
+   * The constructor does not start any workers.  WorkerPool.start() must be
+   * called before queued jobs will run.
+   *
+   * @param minThreads The minimum number of workers (at least 1).
+   * @param maxThreads The maximum number of workers.  If this is less than
+   *   `minThreads`, then `minThreads` will be used.
+   */
+  WorkerPool(size_t minThreads, size_t maxThreads);
+
+  /**
+   * The destructor.
+   *
+   * The destructor will call WorkerPool.join().
+   */
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool & operator=(const WorkerPool &) = delete;
+
+  /**
+   * Start the minimum number of workers.
+   */
+  void start();
+
+  /**
+   * Queue a job to be run by a worker, starting a new worker if all of the
+   * existing workers are busy.
+   *
+   * @param job The job to run.
+   */
+  void enqueue(Job && job);
+
+  /**
+   * Run all queued jobs, then stop and join all workers.
+   */
+  void join();
+
+  /**
+   * Get the number of workers that are currently running.
+   *
+   * @return The number of workers.
+   */
+  size_t getThreadCount();
+
+  private:
+  /**
+   * The function run by each worker.
+   *
+   * @param self The position of the worker's thread in `threads`.
+   */
+  void workerLoop(std::list<std::jthread>::iterator self);
+
+  /**
+   * Start a new worker.
+   *
+   * It is up to the caller to ensure that `controlMutex` is locked.
+   */
+  void addWorker();
+
+  /**
+   * Join the workers which have exited because they were idle.
+   *
+   * It is up to the caller to ensure that `controlMutex` is locked.
+   */
+  void reapWorkers();
+
+  /**
+   * The minimum number of workers.
+   */
+  size_t minThreads;
+
+  /**
+   * The maximum number of workers.
+   */
+  size_t maxThreads;
+
+  /**
+   * Used to synchronize access to the pool state.
+   */
+  std::mutex controlMutex;
+
+  /**
+   * Signals the workers that a job is waiting or that the pool is stopping.
+   */
+  std::condition_variable jobReady;
+
+  /**
+   * The jobs waiting to be run.
+   */
+  std::queue<Job> jobs;
+
+  /**
+   * The worker threads.
+   */
+  std::list<std::jthread> threads;
+
+  /**
+   * The workers which have exited but have not yet been joined.
+   */
+  std::vector<std::list<std::jthread>::iterator> exited;
+
+  /**
+   * The number of running workers.
+   */
+  size_t threadCount;
+
+  /**
+   * The number of workers waiting for a job.
+   */
+  size_t idleCount;
+
+  /**
+   * Whether or not the pool has been started (and not yet joined).
+   */
+  bool running;
+};
+
+}
+
+#endif // GHOTI_WAVE_WORKERPOOL_HPP
+
@@ -4,22 +4,102 @@
  * Define the Ghoti::Wave::Blob class.
  */
 
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
 #include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
 #include "blob.hpp"
 
 using namespace std;
 using namespace Ghoti;
 using namespace Ghoti::Wave;
 
-Blob::Blob() : type{Blob::Type::TEXT}, text{}, file{} {}
+/**
+ * Write a sequence of buffers to a file, in order.
+ *
+ * @param hFile The file descriptor.
+ * @param vectors The buffers, which are modified as they are written.
+ * @param offset The offset in the file at which to write.
+ * @result An error code if the write failed.
+ */
+static error_code writeVectors(int hFile, vector<iovec> & vectors, size_t offset) {
+  size_t index{0};
+  while (index < vectors.size()) {
+    auto written = pwritev(hFile, vectors.data() + index, min(vectors.size() - index, size_t{IOV_MAX}), offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return {errno, system_category()};
+    }
+
+    // Skip past the buffers which were written completely.
+    offset += written;
+    size_t remaining = written;
+    while ((index < vectors.size()) && (remaining >= vectors[index].iov_len)) {
+      remaining -= vectors[index].iov_len;
+      ++index;
+    }
+    if (remaining) {
+      vectors[index].iov_base = static_cast<char *>(vectors[index].iov_base) + remaining;
+      vectors[index].iov_len -= remaining;
+    }
+  }
+  return {};
+}
+
+Blob::Blob() : type{Blob::Type::TEXT}, text{}, segments{}, segmentsLength{0}, file{}, hFile{-1}, fileLength{0}, mapping{nullptr}, mappingLength{0} {}
+
+Blob::Blob(const Ghoti::shared_string_view & text) : type{Blob::Type::TEXT}, text{text}, segments{}, segmentsLength{0}, file{}, hFile{-1}, fileLength{0}, mapping{nullptr}, mappingLength{0} {}
 
-Blob::Blob(const Ghoti::shared_string_view & text) : type{Blob::Type::TEXT}, text{text}, file{} {}
+Blob::Blob(Ghoti::Util::File && file) : type{Blob::Type::FILE}, text{}, segments{}, segmentsLength{0}, file{move(file)}, hFile{-1}, fileLength{0}, mapping{nullptr}, mappingLength{0} {}
 
-Blob::Blob(Ghoti::Util::File && file) : type{Blob::Type::FILE}, text{}, file{move(file)} {}
+Blob::Blob(Blob && source) :
+  type{exchange(source.type, Blob::Type::TEXT)},
+  text{exchange(source.text, {})},
+  segments{exchange(source.segments, {})},
+  segmentsLength{exchange(source.segmentsLength, 0)},
+  file{move(source.file)},
+  hFile{exchange(source.hFile, -1)},
+  fileLength{exchange(source.fileLength, 0)},
+  mapping{exchange(source.mapping, nullptr)},
+  mappingLength{exchange(source.mappingLength, 0)} {}
+
+Blob & Blob::operator=(Blob && source) {
+  if (this != &source) {
+    this->unmap();
+    this->closeFile();
+    this->type = exchange(source.type, Blob::Type::TEXT);
+    this->text = exchange(source.text, {});
+    this->segments = exchange(source.segments, {});
+    this->segmentsLength = exchange(source.segmentsLength, 0);
+    this->file = move(source.file);
+    this->hFile = exchange(source.hFile, -1);
+    this->fileLength = exchange(source.fileLength, 0);
+    this->mapping = exchange(source.mapping, nullptr);
+    this->mappingLength = exchange(source.mappingLength, 0);
+  }
+  return *this;
+}
+
+Blob::~Blob() {
+  this->unmap();
+  this->closeFile();
+}
 
 Util::ErrorOr<size_t> Blob::sizeOrError() const noexcept {
   if (this->type == Blob::Type::TEXT) {
-    return this->text.length();
+    return this->text.length() + this->segmentsLength;
+  }
+  if (this->type == Blob::Type::MAPPED) {
+    return this->mappingLength;
+  }
+  if (this->hFile != -1) {
+    return this->fileLength;
   }
   error_code ec{};
   auto size = filesystem::file_size(this->file.getPath(), ec);
@@ -33,79 +113,293 @@ Util::ErrorOr<size_t> Blob::lengthOrError() const noexcept {
 }
 
 void Blob::set(Ghoti::shared_string_view & text) {
+  this->unmap();
+  this->closeFile();
   this->text = text;
+  this->segments.clear();
+  this->segmentsLength = 0;
   this->type = Blob::Type::TEXT;
   this->file = {};
 }
 
 void Blob::set(Ghoti::Util::File && file) {
+  this->unmap();
+  this->closeFile();
   this->text = {};
+  this->segments.clear();
+  this->segmentsLength = 0;
   this->file = move(file);
   this->type = Blob::Type::FILE;
 }
 
-const Ghoti::shared_string_view & Blob::getText() const {
+const Ghoti::shared_string_view & Blob::getText() {
+  this->join();
   return this->text;
 }
 
+string_view Blob::getView() {
+  if (this->type == Blob::Type::MAPPED) {
+    return {static_cast<const char *>(this->mapping), this->mappingLength};
+  }
+  return this->type == Blob::Type::TEXT ? string_view{this->getText()} : string_view{};
+}
+
+vector<shared_string_view> Blob::getSegments() const {
+  vector<shared_string_view> views{};
+  if (this->type == Blob::Type::TEXT) {
+    views.reserve(1 + this->segments.size());
+    if (this->text.length()) {
+      views.push_back(this->text);
+    }
+    views.insert(views.end(), this->segments.begin(), this->segments.end());
+  }
+  return views;
+}
+
+vector<iovec> Blob::getIovecs() const {
+  vector<iovec> vectors{};
+  auto add = [&](string_view piece) {
+    if (piece.length()) {
+      vectors.push_back({const_cast<char *>(piece.data()), piece.length()});
+    }
+  };
+  if (this->type == Blob::Type::TEXT) {
+    vectors.reserve(1 + this->segments.size());
+    add(this->text);
+    for (auto & segment : this->segments) {
+      add(segment);
+    }
+  }
+  else if (this->type == Blob::Type::MAPPED) {
+    add({static_cast<const char *>(this->mapping), this->mappingLength});
+  }
+  return vectors;
+}
+
+void Blob::join() {
+  if (this->segments.empty()) {
+    return;
+  }
+  string joined{};
+  joined.reserve(this->text.length() + this->segmentsLength);
+  joined.append(string_view{this->text});
+  for (auto & segment : this->segments) {
+    joined.append(string_view{segment});
+  }
+  this->text = shared_string_view{move(joined)};
+  this->segments.clear();
+  this->segmentsLength = 0;
+}
+
 const Ghoti::Util::File & Blob::getFile() const {
   return this->file;
 }
 
+int Blob::getDescriptor() const {
+  return this->hFile;
+}
+
 Blob::Type Blob::getType() const {
   return this->type;
 }
 
 bool Blob::operator==(const Ghoti::shared_string_view & rhs) const {
-  if (this->type == Blob::Type::TEXT) {
-    return this->text == rhs;
+  if (this->type == Blob::Type::FILE) {
+    return this->readFile() == string_view{rhs};
+  }
+
+  // Appended text is compared in place, without being joined.
+  string_view remaining{rhs};
+  for (auto & buffer : this->getIovecs()) {
+    string_view piece{static_cast<const char *>(buffer.iov_base), buffer.iov_len};
+    if (remaining.substr(0, piece.length()) != piece) {
+      return false;
+    }
+    remaining.remove_prefix(piece.length());
   }
-  return string{this->file} == rhs;
+  return remaining.empty();
 }
 
 error_code Blob::append(const Ghoti::shared_string_view & text) {
   if (this->type == Blob::Type::TEXT) {
-    this->text += text;
+    if (this->text.empty() && this->segments.empty()) {
+      this->text = text;
+    }
+    else if (text.length()) {
+      this->segments.push_back(text);
+      this->segmentsLength += text.length();
+    }
     return {};
   }
-  return this->file.append(text);
+  error_code ec{};
+  if (this->hFile != -1) {
+    string_view view{text};
+    vector<iovec> vectors{{const_cast<char *>(view.data()), view.length()}};
+    if (!(ec = writeVectors(this->hFile, vectors, this->fileLength))) {
+      this->fileLength += view.length();
+    }
+  }
+  else {
+    ec = this->file.append(text);
+  }
+  return (ec || (this->type == Blob::Type::FILE)) ? ec : this->remap();
 }
 
 error_code Blob::truncate(const Ghoti::shared_string_view & text) {
   if (this->type == Blob::Type::TEXT) {
     this->text = text;
+    this->segments.clear();
+    this->segmentsLength = 0;
     return {};
   }
-  return this->file.truncate(text);
+  error_code ec{};
+  if (this->hFile != -1) {
+    if (ftruncate(this->hFile, 0) == -1) {
+      return {errno, system_category()};
+    }
+    this->fileLength = 0;
+    return this->append(text);
+  }
+  ec = this->file.truncate(text);
+  return (ec || (this->type == Blob::Type::FILE)) ? ec : this->remap();
 }
 
-error_code Blob::convertToFile() {
-  if (this->type == Blob::Type::FILE) {
+error_code Blob::convertToFile(const string & directory) {
+  if (this->type != Blob::Type::TEXT) {
     return {};
   }
 
-  // Attempt to create a temporary file.
-  this->file = Ghoti::Util::File::createTemp("");
+  // Attempt to create an anonymous file, which is removed by the OS when it
+  // is closed.
   error_code ec{};
-  if ((ec = this->file.test())) {
+  auto path = directory.empty() ? filesystem::temp_directory_path(ec) : filesystem::path{directory};
+  if (ec) {
     return ec;
   }
+  int hFile = open(path.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+  if ((hFile == -1) && ((errno == EOPNOTSUPP) || (errno == EISDIR))) {
+    // The file system does not support O_TMPFILE.
+    hFile = memfd_create("ghoti.io-wave-blob", MFD_CLOEXEC);
+  }
+  if (hFile == -1) {
+    return {errno, system_category()};
+  }
 
-  ec = this->file.truncate(this->text);
+  // The text is written without being joined first.
+  auto vectors = this->getIovecs();
+  if ((ec = writeVectors(hFile, vectors, 0))) {
+    close(hFile);
+    return ec;
+  }
 
   // Only switch the type if there have been no errors so far.
+  this->type = Blob::Type::FILE;
+  this->file = {};
+  this->hFile = hFile;
+  this->fileLength = this->text.length() + this->segmentsLength;
+  this->text = {};
+  this->segments.clear();
+  this->segmentsLength = 0;
+  return {};
+}
+
+error_code Blob::map() {
+  if (this->type != Blob::Type::FILE) {
+    return {};
+  }
+  auto ec = this->remap();
+
+  // Only switch the type if the file could be mapped.
   if (!ec) {
-    this->type = Blob::Type::FILE;
+    this->type = Blob::Type::MAPPED;
+  }
+  return ec;
+}
+
+error_code Blob::remap() {
+  // A named file must be opened to find its length.
+  int hFile = this->hFile;
+  size_t length = this->fileLength;
+  if (hFile == -1) {
+    hFile = open(this->file.getPath().c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if ((hFile == -1) || (fstat(hFile, &status) == -1)) {
+      error_code ec{errno, system_category()};
+      if (hFile != -1) {
+        close(hFile);
+      }
+      return ec;
+    }
+    length = status.st_size;
+  }
+
+  // An empty file cannot be mapped.
+  void * mapping = this->mapping;
+  if (!length) {
+    this->unmap();
+  }
+  else if (!mapping) {
+    mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, hFile, 0);
+  }
+  else if (length != this->mappingLength) {
+    // The existing mapping is resized in place if possible.
+    mapping = mremap(mapping, this->mappingLength, length, MREMAP_MAYMOVE);
+  }
+  error_code ec = (mapping == MAP_FAILED) ? error_code{errno, system_category()} : error_code{};
+  if (hFile != this->hFile) {
+    close(hFile);
+  }
+  if (!ec && length) {
+    this->mapping = mapping;
+    this->mappingLength = length;
   }
   return ec;
 }
 
+void Blob::unmap() {
+  if (this->mapping) {
+    munmap(this->mapping, this->mappingLength);
+    this->mapping = nullptr;
+  }
+  this->mappingLength = 0;
+}
+
+void Blob::closeFile() {
+  if (this->hFile != -1) {
+    close(this->hFile);
+    this->hFile = -1;
+  }
+  this->fileLength = 0;
+}
+
+string Blob::readFile() const {
+  if (this->hFile == -1) {
+    return string{this->file};
+  }
+  string contents(this->fileLength, '\0');
+  size_t offset{0};
+  while (offset < contents.length()) {
+    auto bytesRead = pread(this->hFile, contents.data() + offset, contents.length() - offset, offset);
+    if ((bytesRead == -1) && (errno == EINTR)) {
+      continue;
+    }
+    if (bytesRead <= 0) {
+      break;
+    }
+    offset += bytesRead;
+  }
+  contents.resize(offset);
+  return contents;
+}
+
 ostream & Ghoti::Wave::operator<<(ostream & out, const Blob & blob) {
-  if (blob.getType() == Blob::Type::TEXT) {
-    out << blob.getText();
+  if (blob.getType() == Blob::Type::FILE) {
+    out << blob.readFile();
   }
   else {
-    out << string{blob.getFile()};
+    for (auto & buffer : blob.getIovecs()) {
+      out.write(static_cast<const char *>(buffer.iov_base), buffer.iov_len);
+    }
   }
   return out;
 }
@@ -0,0 +1,134 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::BodyStream class.
+ */
+
+#include "wave/bodyStream.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+BodyStream::BodyStream() :
+  mutex{},
+  pending{},
+  handler{},
+  onResume{},
+  paused{false},
+  ended{false},
+  aborted{false},
+  delivering{false},
+  endDelivered{false} {}
+
+void BodyStream::onData(DataHandler && handler) {
+  {
+    scoped_lock lock{this->mutex};
+    this->handler = move(handler);
+  }
+  this->deliver();
+}
+
+void BodyStream::pause() {
+  scoped_lock lock{this->mutex};
+  this->paused = true;
+}
+
+void BodyStream::resume() {
+  function<void()> onResume;
+  {
+    scoped_lock lock{this->mutex};
+    if (!this->paused) {
+      return;
+    }
+    this->paused = false;
+    onResume = this->onResume;
+  }
+  this->deliver();
+  if (onResume) {
+    onResume();
+  }
+}
+
+bool BodyStream::isPaused() const {
+  scoped_lock lock{this->mutex};
+  return this->paused;
+}
+
+bool BodyStream::isEnded() const {
+  scoped_lock lock{this->mutex};
+  return this->ended;
+}
+
+bool BodyStream::isAborted() const {
+  scoped_lock lock{this->mutex};
+  return this->aborted;
+}
+
+void BodyStream::push(const shared_string_view & data) {
+  if (data.empty()) {
+    return;
+  }
+  {
+    scoped_lock lock{this->mutex};
+    if (this->ended) {
+      return;
+    }
+    this->pending.push_back(data);
+  }
+  this->deliver();
+}
+
+void BodyStream::finish() {
+  {
+    scoped_lock lock{this->mutex};
+    this->ended = true;
+  }
+  this->deliver();
+}
+
+void BodyStream::abort() {
+  {
+    scoped_lock lock{this->mutex};
+    if (this->ended) {
+      return;
+    }
+    this->ended = true;
+    this->aborted = true;
+  }
+  this->deliver();
+}
+
+void BodyStream::setResumeCallback(function<void()> && onResume) {
+  scoped_lock lock{this->mutex};
+  this->onResume = move(onResume);
+}
+
+void BodyStream::deliver() {
+  unique_lock lock{this->mutex};
+  if (this->delivering) {
+    // The other thread will deliver anything added in the meantime.
+    return;
+  }
+  this->delivering = true;
+  while (this->handler && !this->paused && !this->endDelivered) {
+    shared_string_view data{};
+    if (this->pending.size()) {
+      data = move(this->pending.front());
+      this->pending.pop_front();
+    }
+    else if (!this->ended) {
+      break;
+    }
+    bool finished = this->ended && this->pending.empty();
+    this->endDelivered = finished;
+
+    // The handler is called without holding the lock, so that it may pause
+    // the stream (or do anything else with it).
+    auto handler = this->handler;
+    lock.unlock();
+    handler(data, finished);
+    lock.lock();
+  }
+  this->delivering = false;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::BufferPool class.
+ */
+
+#include "wave/bufferPool.hpp"
+
+using namespace std;
+using namespace Ghoti::Wave;
+
+BufferPool::Buffer::Buffer(BufferPool * pool, unique_ptr<char[]> && memory) : pool{pool}, memory{move(memory)} {}
+
+BufferPool::Buffer::~Buffer() {
+  if (this->memory) {
+    this->pool->release(move(this->memory));
+  }
+}
+
+char * BufferPool::Buffer::data() const {
+  return this->memory.get();
+}
+
+size_t BufferPool::Buffer::size() const {
+  return this->pool->getBufferSize();
+}
+
+BufferPool::BufferPool(size_t bufferSize, size_t maxFree) : bufferSize{bufferSize}, maxFree{maxFree}, controlMutex{}, freeBuffers{} {}
+
+BufferPool::Buffer BufferPool::acquire() {
+  {
+    scoped_lock lock{this->controlMutex};
+    if (this->freeBuffers.size()) {
+      auto memory = move(this->freeBuffers.back());
+      this->freeBuffers.pop_back();
+      return {this, move(memory)};
+    }
+  }
+
+  // There are no free buffers, so allocate one.  It does not need to be
+  // zero-filled, because it will only ever be read after being written to.
+  return {this, make_unique_for_overwrite<char[]>(this->bufferSize)};
+}
+
+size_t BufferPool::getBufferSize() const {
+  return this->bufferSize;
+}
+
+void BufferPool::release(unique_ptr<char[]> && memory) {
+  scoped_lock lock{this->controlMutex};
+  if (this->freeBuffers.size() < this->maxFree) {
+    this->freeBuffers.push_back(move(memory));
+  }
+}
+
@@ -6,16 +6,15 @@
 
 #include <arpa/inet.h>
 #include <cstring>
-#include <ghoti.io/pool.hpp>
 #include <iostream>
 #include <sys/socket.h>
 #include <sstream>
 #include <poll.h>
 #include "wave/client.hpp"
 #include "wave/clientSession.hpp"
+#include "wave/workerPool.hpp"
 
 using namespace std;
-using namespace Ghoti::Pool;
 using namespace Ghoti::Wave;
 
 
@@ -26,10 +25,11 @@ using namespace Ghoti::Wave;
  * @param domain The domain to which the connection points
  * @param port The connection port of the target domain
  * @param client A pointer to the client class
+ * @param bufferPool The pool from which the session will borrow read buffers
  * @param response A response message which can hold an error message
  * @return A shared pointer to the client session (empty upon failure)
  */
-static std::shared_ptr<ClientSession> createClientSession(const Ghoti::shared_string_view & domain, size_t port, Client * client, shared_ptr<Message> response) {
+static std::shared_ptr<ClientSession> createClientSession(const Ghoti::shared_string_view & domain, size_t port, Client * client, shared_ptr<BufferPool> bufferPool, shared_ptr<Message> response) {
   int hSocket;
   // Open a new connection.
   sockaddr_in client_address;
@@ -97,14 +97,20 @@ static std::shared_ptr<ClientSession> createClientSession(const Ghoti::shared_st
     }
   }
 
-  return make_shared<ClientSession>(hSocket, client);
+  return make_shared<ClientSession>(hSocket, client, bufferPool);
 }
 
 void Client::dispatchLoop(stop_token stopToken) {
   // Create the worker pool queue.
-  Pool::Pool pool{1};
+  auto maxWorkers = *this->getParameter<uint32_t>(ClientParameter::MAXWORKERS);
+  WorkerPool pool{
+    *this->getParameter<uint32_t>(ClientParameter::MINWORKERS),
+    maxWorkers ? maxWorkers : thread::hardware_concurrency()};
   pool.start();
 
+  // Read buffers shared by the sessions.
+  shared_ptr<BufferPool> bufferPool;
+
   while (!stopToken.stop_requested()) {
     bool workDone{false};
 
@@ -118,7 +124,14 @@ void Client::dispatchLoop(stop_token stopToken) {
         size_t max_connections = 1;
         if ((sessions.size() < max_connections) && (requestQueue.size())) {
           auto [request, response] = requestQueue.front();
-          auto clientSession = createClientSession(domain, port, this, response);
+
+          // The buffer size is only read when a session is created, and the
+          // pool is only replaced if the size has changed.
+          auto maxBufferSize = *this->getParameter<uint32_t>(ClientParameter::MAXBUFFERSIZE);
+          if (!bufferPool || (bufferPool->getBufferSize() != maxBufferSize)) {
+            bufferPool = make_shared<BufferPool>(maxBufferSize);
+          }
+          auto clientSession = createClientSession(domain, port, this, bufferPool, response);
           if (clientSession) {
             // Set the parameter inheritance.
             clientSession->setInheritFrom(this);
@@ -221,6 +234,9 @@ Ghoti::Util::ErrorOr<any> Client::getParameterDefault(const ClientParameter & p)
   static unordered_map<ClientParameter, any> defaults{
     {ClientParameter::MAXBUFFERSIZE, {uint32_t{4096}}},
     {ClientParameter::MEMCHUNKSIZELIMIT, {uint32_t{1024 * 1024}}},
+    {ClientParameter::MINWORKERS, {uint32_t{1}}},
+    {ClientParameter::MAXWORKERS, {uint32_t{0}}},
+    {ClientParameter::MAXLINELENGTH, {uint32_t{8192}}},
   };
   if (defaults.contains(p)) {
     return defaults[p];
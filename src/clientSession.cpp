@@ -32,15 +32,11 @@ using namespace Ghoti::Wave;
 enum Phase {
   NEW,               ///< The Message has not started being transmitted or
                      ///<   received yet.
-  SEND_HEADER,       ///< The Header is being sent.
-  SEND_FIXED,        ///< A fixed-length message is being sent.
-  SEND_MULTIPART,    ///< A Multipart message is being sent.
-  SEND_CHUNK_HEADER, ///< A Chunk Header is being sent.
-  SEND_CHUNK_BODY,   ///< A Chunk body is being sent.
-  SEND_LAST_CHUNK,   ///< The last chunk of size 0.
-  SEND_STREAM,       ///< A streaming message is being sent.
-  FINISHED,          ///< The message is finished.
-  ERROR,             ///< There was an error performing the write.
+  SEND_HEADER,       ///< The Header has not yet been serialized.
+  SEND_CHUNKS,       ///< Chunks are being serialized as they become
+                     ///<   available.
+  FINISHED,          ///< The message is completely serialized.
+  ERROR,             ///< There was an error serializing the message.
 };
 
 /**
@@ -56,15 +52,14 @@ enum class Attribute {
 /**
  * Helper definition tracking the state of a message that is being transferred.
  *
- * <Phase, writeOffset, currentChunk>
+ * <Phase, currentChunk>
  */
 struct WriteState {
   Phase phase;
-  uint32_t writeOffset;
   uint32_t currentChunk;
 };
 
-ClientSession::ClientSession(int hServer, Client * client) :
+ClientSession::ClientSession(int hServer, Client * client, shared_ptr<BufferPool> bufferPool) :
   controlMutex{make_unique<mutex>()},
   hServer{hServer},
   requestSequence{0},
@@ -74,7 +69,9 @@ ClientSession::ClientSession(int hServer, Client * client) :
   finished{false},
   parser{},
   client{client},
-  messages{} {
+  bufferPool{bufferPool},
+  messages{},
+  output{} {
   this->parser.setInheritFrom(this);
 }
 
@@ -122,7 +119,7 @@ bool ClientSession::hasWriteDataWaiting() {
   bool dataIsWaiting{false};
 
   if (this->controlMutex->try_lock()) {
-    if (!this->working && (this->writeSequence <= this->messages.size())) {
+    if (!this->working && ((this->writeSequence < this->requestSequence) || !this->output.empty())) {
       // See if there is anything waiting to be read on the socket.
       pollfd pollFd{this->hServer, POLLOUT | POLLERR, 0};
       if (poll(&pollFd, 1, 0)) {
@@ -159,14 +156,12 @@ bool ClientSession::isFinished() {
 void ClientSession::read() {
   scoped_lock lock{*this->controlMutex};
 
+  // Borrow a buffer only for as long as the socket has data.
+  auto buffer = this->bufferPool->acquire();
   while (1) {
-    auto maxBufferSize = *this->getParameter<uint32_t>(ClientParameter::MAXBUFFERSIZE);
-    assert(maxBufferSize);
-    vector<char> bufferVector(maxBufferSize);
-    char * buffer{bufferVector.data()};
-    ssize_t byte_count = recv(this->hServer, buffer, maxBufferSize, 0);
+    ssize_t byte_count = recv(this->hServer, buffer.data(), buffer.size(), 0);
     if (byte_count > 0) {
-      this->parser.processBlock(buffer, byte_count);
+      this->parser.processBlock(buffer.data(), byte_count);
 
       // Notify the requester that we have a response.
       while (!this->parser.messages.empty()) {
@@ -223,42 +218,15 @@ void ClientSession::read() {
   this->working = false;
 }
 
-/**
- * Helper macro for repeatedly writing different parts of the message.
- *
- * Requires the following variables to be used in the calling code block:
- *  - `writeOffset`: How much of `source` has already been written.
- *  - `this` : The ClientSession object.
- *  - `phase` : The Phase of transfer of the message.
- *
- * @param source The text to be written.
- * @param completedTarget The new Phase to transition to, if all of `source`
- *   has been fully and successfully written.
- */
-#define ATTEMPT_WRITE(source, completedTarget) \
-  auto attemptedWriteLength = (source).length() - writeOffset; \
-  auto bytesWritten = ::write(this->hServer, string{source}.c_str() + writeOffset, attemptedWriteLength); \
-  if (bytesWritten == -1) { \
-    phase = ERROR; \
-  } \
-  else { \
-    writeOffset += bytesWritten; \
-    if (writeOffset == source.length()) { \
-      phase = (completedTarget); \
-    } \
-    else { \
-      writeOffset += bytesWritten; \
-    } \
-  }
-
-
 void ClientSession::write() {
   scoped_lock lock{*this->controlMutex};
 
-  if (this->writeSequence < this->requestSequence) {
-    // Attempt to write out some of the response.
+  // Serialize as much of the pending requests as is available.  Each part of
+  // a request is serialized exactly once, no matter how many write attempts
+  // it takes to send it.
+  while (!this->finished && (this->writeSequence < this->requestSequence)) {
     auto & [request, response, anyState] = this->messages[this->writeSequence];
-    auto & [phase, writeOffset, currentChunk] = any_cast<WriteState &>(anyState);
+    auto & [phase, currentChunk] = any_cast<WriteState &>(anyState);
 
     if (phase == NEW) {
       // Default to FIXED if no other transport has been declared.
@@ -268,125 +236,68 @@ void ClientSession::write() {
       phase = SEND_HEADER;
     }
 
-    bool stop{false};
-    while (!stop) {
-      switch (request->getTransport()) {
-        case Message::Transport::FIXED: {
-          switch (phase) {
-            case SEND_HEADER: {
-              auto header = request->getRenderedHeader1() + "Content-Length: " + to_string(request->getContentLength()) + "\r\n\r\n";
+    switch (request->getTransport()) {
+      case Message::Transport::FIXED: {
+        this->output.push(OutputSegment{request->getRenderedHeader1(request->getContentLength())});
+        if (request->getContentLength()) {
+          this->output.push(request->getMessageBody());
+        }
+        phase = FINISHED;
+        break;
+      }
 
-              // Write out as much as possible.
-              ATTEMPT_WRITE(header, request->getContentLength()
-                ? SEND_FIXED
-                : FINISHED);
-              break;
-            }
-            case SEND_FIXED: {
-              auto message = request->getMessageBody().getText();
-              ATTEMPT_WRITE(message, FINISHED);
-              stop = true;
-              break;
-            }
-            case FINISHED: {
-              // Move to the next message.
-              ++writeSequence;
-              stop = true;
-              break;
-            }
-            case ERROR: {
-              // There was an error writing to the socket.
-              cerr << "Error writing request: " << strerror(errno) << endl;
-              this->finished = true;
-              close(this->hServer);
-              stop = true;
-              break;
-            }
-            default: {
-              assert(false);
-            }
+      case Message::Transport::CHUNKED: {
+        if (phase == SEND_HEADER) {
+          this->output.push(OutputSegment{Ghoti::shared_string_view{request->getRenderedHeader1() + "Transfer-Encoding: chunked\r\n\r\n"}});
+          phase = SEND_CHUNKS;
+        }
+        auto & chunks = request->getChunks();
+        while (currentChunk < chunks.size()) {
+          auto & chunk = chunks[currentChunk];
+          auto size = chunk.sizeOrError();
+          if (!size) {
+            cerr << "Error reading blob length" << endl;
+            phase = ERROR;
+            break;
           }
-          break;
+          stringstream ss{};
+          ss << uppercase << hex << *size << "\r\n";
+          this->output.push(OutputSegment{Ghoti::shared_string_view{ss.str()}});
+          this->output.push(chunk);
+          this->output.push(OutputSegment{Ghoti::shared_string_view{"\r\n"}});
+          ++currentChunk;
         }
+        // Until the request is finished, more chunks may still be added.
+        if ((phase == SEND_CHUNKS) && request->isFinished()) {
+          this->output.push(OutputSegment{Ghoti::shared_string_view{"0\r\n\r\n"}});
+          phase = FINISHED;
+        }
+        break;
+      }
 
-        case Message::Transport::CHUNKED: {
-          switch (phase) {
-            case SEND_HEADER: {
-              auto header = request->getRenderedHeader1() + "Transfer-Encoding: chunked\r\n\r\n";
+      default: {}
+    }
 
-              // Write out as much as possible.
-              ATTEMPT_WRITE(header, request->getContentLength()
-                ? SEND_CHUNK_HEADER
-                : FINISHED);
-              break;
-            }
-            case SEND_CHUNK_HEADER: {
-              if (currentChunk < request->getChunks().size()) {
-                auto & chunk = request->getChunks()[currentChunk];
-                auto size = chunk.sizeOrError();
-                if (size) {
-                  stringstream ss{};
-                  ss << uppercase << hex << *size;
-                  auto header = ss.str() + "\r\n";
+    if (phase == ERROR) {
+      this->finished = true;
+      close(this->hServer);
+      break;
+    }
+    if (phase != FINISHED) {
+      // Wait for the rest of the message to become available.
+      break;
+    }
 
-                  // Write out as much as possible.
-                  ATTEMPT_WRITE(header, SEND_CHUNK_BODY);
-                }
-                else {
-                  cerr << "Error reading blob length" << endl;
-                  phase = ERROR;
-                }
-              }
-              else {
-                // There are no chunks waiting to write.  Either we are waiting
-                // on more chunks, or there is nothing else to write.
-                if (request->isFinished()) {
-                  phase = SEND_LAST_CHUNK;
-                }
-              }
-              break;
-            }
-            case SEND_CHUNK_BODY: {
-              if (currentChunk < request->getChunks().size()) {
-                auto & chunk = request->getChunks()[currentChunk];
-                string body{(chunk.getType() == Blob::Type::TEXT
-                  ? string{chunk.getText()}
-                  : string{chunk.getFile()})
-                  + "\r\n"};
+    // Move to the next message.
+    ++this->writeSequence;
+  }
 
-                // Write out as much as possible.
-                ATTEMPT_WRITE(body, SEND_CHUNK_HEADER);
-              }
-              stop = true;
-              break;
-            }
-            case SEND_LAST_CHUNK: {
-              string body{"0\r\n\r\n"};
-              ATTEMPT_WRITE(body, FINISHED);
-              break;
-            }
-            case FINISHED: {
-              // Move to the next message.
-              ++writeSequence;
-              stop = true;
-              break;
-            }
-            case ERROR: {
-              // There was an error writing to the socket.
-              cerr << "Error writing request: " << strerror(errno) << endl;
-              this->finished = true;
-              close(this->hServer);
-              stop = true;
-              break;
-            }
-            default: {
-              assert(false);
-            }
-          }
-          break;
-        }
-        default: {}
-      }
+  // Write as much as the socket will accept.
+  if (!this->finished) {
+    if (auto ec = this->output.sendTo(this->hServer)) {
+      cerr << "Error writing request: " << ec.message() << endl;
+      this->finished = true;
+      close(this->hServer);
     }
   }
   this->working = false;
@@ -395,7 +306,6 @@ void ClientSession::write() {
 void ClientSession::enqueue(shared_ptr<Message> request, shared_ptr<Message> response) {
   this->messages[this->requestSequence] = {request, response, WriteState{
     .phase = NEW,
-    .writeOffset = 0,
     .currentChunk = 0,
   }};
   ++this->requestSequence;
@@ -0,0 +1,314 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::FieldCollection class.
+ */
+
+#include <stdexcept>
+#include "wave/fieldCollection.hpp"
+#include "wave/parsing.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+FieldCollection::FieldCollection() : fields{}, firstKnown{}, distinctCount{0}, unparsedCount{0} {}
+
+FieldCollection::FieldCollection(FieldCollection && source) : fields{move(source.fields)}, firstKnown{source.firstKnown}, distinctCount{source.distinctCount}, unparsedCount{source.unparsedCount} {
+  source.clear();
+}
+
+FieldCollection & FieldCollection::operator=(FieldCollection && source) {
+  if (this != &source) {
+    this->fields = move(source.fields);
+    this->firstKnown = source.firstKnown;
+    this->distinctCount = source.distinctCount;
+    this->unparsedCount = source.unparsedCount;
+    source.clear();
+  }
+  return *this;
+}
+
+void FieldCollection::clear() {
+  this->fields.clear();
+  this->firstKnown.fill(0);
+  this->distinctCount = 0;
+  this->unparsedCount = 0;
+}
+
+void FieldCollection::add(const shared_string_view & name, const shared_string_view & value) {
+  this->add(lookupFieldName(name), name, value);
+}
+
+void FieldCollection::add(FieldName id, const shared_string_view & name, shared_string_view value) {
+  this->append(id, name, move(value), false);
+}
+
+void FieldCollection::addUnparsed(FieldName id, const shared_string_view & name, shared_string_view value) {
+  this->append(id, name, move(value), true);
+}
+
+void FieldCollection::append(FieldName id, const shared_string_view & name, shared_string_view value, bool unparsed) {
+  auto first = this->findFirst(id, name);
+  uint32_t index = this->fields.size();
+  if (first == index) {
+    ++this->distinctCount;
+    if (id != FieldName::UNKNOWN) {
+      this->firstKnown[static_cast<size_t>(id)] = index + 1;
+    }
+  }
+  else {
+    auto last = first;
+    while (this->fields[last].next) {
+      last = this->fields[last].next;
+    }
+    this->fields[last].next = index;
+  }
+  this->fields.emplace_back(id, unparsed, uint32_t{0}, name, move(value));
+  if (unparsed) {
+    ++this->unparsedCount;
+  }
+}
+
+size_t FieldCollection::size() const {
+  return this->distinctCount;
+}
+
+bool FieldCollection::empty() const {
+  return this->fields.empty();
+}
+
+FieldCollection::Values FieldCollection::get(string_view name) const {
+  auto id = lookupFieldName(name);
+  this->parse(id);
+  return {this, this->findFirst(id, name)};
+}
+
+FieldCollection::Values FieldCollection::get(FieldName name) const {
+  this->parse(name);
+  return {this, this->findFirst(name, {})};
+}
+
+FieldCollection::Values FieldCollection::at(string_view name) const {
+  auto values = this->get(name);
+  if (values.empty()) {
+    throw out_of_range{"FieldCollection::at"};
+  }
+  return values;
+}
+
+bool FieldCollection::contains(string_view name) const {
+  return !this->get(name).empty();
+}
+
+FieldCollection::iterator FieldCollection::begin() const {
+  this->parseAll();
+  return {this, 0};
+}
+
+FieldCollection::iterator FieldCollection::end() const {
+  return {this, this->fields.size()};
+}
+
+size_t FieldCollection::findFirst(FieldName id, string_view name) const {
+  if (id != FieldName::UNKNOWN) {
+    auto first = this->firstKnown[static_cast<size_t>(id)];
+    return first ? first - 1 : this->fields.size();
+  }
+  for (size_t i = 0; i < this->fields.size(); ++i) {
+    if ((this->fields[i].id == FieldName::UNKNOWN) && KnownNames::equalsIgnoreCase(this->fields[i].name, name)) {
+      return i;
+    }
+  }
+  return this->fields.size();
+}
+
+size_t FieldCollection::findNext(size_t index) const {
+  auto next = this->fields[index].next;
+  return next ? next : this->fields.size();
+}
+
+void FieldCollection::parse(FieldName id) const {
+  if (!this->unparsedCount || (id == FieldName::UNKNOWN)) {
+    return;
+  }
+  for (auto i = this->findFirst(id, {}); i < this->fields.size(); i = this->findNext(i)) {
+    if (this->fields[i].unparsed) {
+      this->parseValue(i);
+    }
+  }
+}
+
+void FieldCollection::parseAll() const {
+  for (size_t i = 0; this->unparsedCount && (i < this->fields.size()); ++i) {
+    if (this->fields[i].unparsed) {
+      this->parseValue(i);
+    }
+  }
+}
+
+void FieldCollection::parseValue(size_t index) const {
+  // https://datatracker.ietf.org/doc/html/rfc9110#section-5.6.1
+  auto list = this->fields[index].value;
+  string_view text{list};
+  SmallVector<shared_string_view, 8> elements;
+  size_t pos{0};
+  while (pos < text.length()) {
+    if ((text[pos] == ',') || isWhitespaceChar(text[pos])) {
+      // Empty elements are ignored.
+      // https://datatracker.ietf.org/doc/html/rfc9110#section-5.6.1.2-2
+      ++pos;
+      continue;
+    }
+    if (text[pos] == '"') {
+      // https://datatracker.ietf.org/doc/html/rfc9110#section-5.6.4
+      // The value is only copied if it must be unescaped.
+      string unescaped{};
+      bool escaped{false};
+      size_t start = ++pos;
+      while ((pos < text.length()) && (text[pos] != '"')) {
+        if ((text[pos] == '\\') && (pos + 1 < text.length())) {
+          unescaped.append(text.substr(start, pos - start));
+          escaped = true;
+          start = ++pos;
+        }
+        ++pos;
+      }
+      if (escaped) {
+        unescaped.append(text.substr(start, pos - start));
+        elements.emplace_back(shared_string_view{move(unescaped)});
+      }
+      else {
+        elements.emplace_back(list.substr(start, pos - start));
+      }
+      pos = min(text.find(',', pos), text.length());
+    }
+    else {
+      size_t end = min(text.find(',', pos), text.length());
+      size_t last = end;
+      while (isWhitespaceChar(text[last - 1])) {
+        --last;
+      }
+      elements.emplace_back(list.substr(pos, last - pos));
+      pos = end;
+    }
+  }
+
+  auto & field = this->fields[index];
+  field.unparsed = false;
+  --this->unparsedCount;
+  if (elements.empty()) {
+    // There is nothing to split, so keep the value as it is.
+    return;
+  }
+  field.value = elements[0];
+
+  // The remaining elements follow the first, before any later values.
+  auto id = field.id;
+  auto name = field.name;
+  size_t previous = index;
+  for (size_t i = 1; i < elements.size(); ++i) {
+    uint32_t following = this->fields[previous].next;
+    uint32_t current = this->fields.size();
+    this->fields.emplace_back(id, false, following, name, elements[i]);
+    this->fields[previous].next = current;
+    previous = current;
+  }
+}
+
+FieldCollection::Values::Values(const FieldCollection * collection, size_t first) : collection{collection}, first{first} {}
+
+size_t FieldCollection::Values::size() const {
+  size_t count{0};
+  for (auto it = this->begin(); it != this->end(); ++it) {
+    ++count;
+  }
+  return count;
+}
+
+bool FieldCollection::Values::empty() const {
+  return this->first == this->collection->fields.size();
+}
+
+const shared_string_view & FieldCollection::Values::operator[](size_t index) const {
+  auto it = this->begin();
+  while (index--) {
+    ++it;
+  }
+  return *it;
+}
+
+const shared_string_view & FieldCollection::Values::at(size_t index) const {
+  auto it = this->begin();
+  while (index-- && (it != this->end())) {
+    ++it;
+  }
+  if (it == this->end()) {
+    throw out_of_range{"FieldCollection::Values::at"};
+  }
+  return *it;
+}
+
+FieldCollection::Values::iterator FieldCollection::Values::begin() const {
+  return {this->collection, this->first};
+}
+
+FieldCollection::Values::iterator FieldCollection::Values::end() const {
+  return {this->collection, this->collection->fields.size()};
+}
+
+const shared_string_view & FieldCollection::Values::iterator::operator*() const {
+  return this->collection->fields[this->index].value;
+}
+
+const shared_string_view * FieldCollection::Values::iterator::operator->() const {
+  return &this->collection->fields[this->index].value;
+}
+
+FieldCollection::Values::iterator & FieldCollection::Values::iterator::operator++() {
+  this->index = this->collection->findNext(this->index);
+  return *this;
+}
+
+FieldCollection::Values::iterator FieldCollection::Values::iterator::operator++(int) {
+  auto previous = *this;
+  ++*this;
+  return previous;
+}
+
+FieldCollection::iterator::iterator(const FieldCollection * collection, size_t index) : collection{collection}, index{index}, current{} {
+  this->update();
+}
+
+const FieldCollection::NamedValues & FieldCollection::iterator::operator*() const {
+  return *this->current;
+}
+
+const FieldCollection::NamedValues * FieldCollection::iterator::operator->() const {
+  return &*this->current;
+}
+
+FieldCollection::iterator & FieldCollection::iterator::operator++() {
+  // Skip the values of names which have already been visited.
+  auto & fields = this->collection->fields;
+  do {
+    ++this->index;
+  } while ((this->index < fields.size())
+    && (this->collection->findFirst(fields[this->index].id, fields[this->index].name) != this->index));
+  this->update();
+  return *this;
+}
+
+bool FieldCollection::iterator::operator==(const iterator & rhs) const {
+  return this->index == rhs.index;
+}
+
+void FieldCollection::iterator::update() {
+  if (this->index < this->collection->fields.size()) {
+    this->current.emplace(this->collection->fields[this->index].name, Values{this->collection, this->index});
+  }
+  else {
+    this->current.reset();
+  }
+}
+
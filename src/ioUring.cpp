@@ -0,0 +1,371 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::IoUring class.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "wave/ioUring.hpp"
+
+using namespace std;
+using namespace Ghoti::Wave;
+
+/**
+ * Helper function to load a value shared with the kernel.
+ *
+ * @param value The shared value.
+ * @return The current value.
+ */
+template <typename T>
+static T loadAcquire(T * value) {
+  return atomic_ref<T>{*value}.load(memory_order_acquire);
+}
+
+/**
+ * Helper function to publish a value shared with the kernel.
+ *
+ * @param target The shared value.
+ * @param value The new value.
+ */
+template <typename T>
+static void storeRelease(T * target, T value) {
+  atomic_ref<T>{*target}.store(value, memory_order_release);
+}
+
+IoUring::IoUring() :
+  hRing{-1},
+  sqRing{MAP_FAILED},
+  sqRingSize{0},
+  cqRing{MAP_FAILED},
+  cqRingSize{0},
+  sqes{nullptr},
+  sqEntries{0},
+  sqHead{nullptr},
+  sqTail{nullptr},
+  sqMask{nullptr},
+  sqArray{nullptr},
+  cqHead{nullptr},
+  cqTail{nullptr},
+  cqMask{nullptr},
+  cqes{nullptr},
+  sqPending{0},
+  sqLocalTail{0},
+  bufferRing{nullptr},
+  bufferCount{0},
+  bufferSize{0},
+  bufferGroup{0},
+  bufferTail{0},
+  buffers{} {}
+
+IoUring::~IoUring() {
+  // Closing the ring handle also unregisters the provided buffer ring.
+  if (this->hRing >= 0) {
+    close(this->hRing);
+  }
+  if (this->bufferRing) {
+    munmap(this->bufferRing, this->bufferCount * sizeof(io_uring_buf));
+  }
+  if (this->sqes) {
+    munmap(this->sqes, this->sqEntries * sizeof(io_uring_sqe));
+  }
+  if ((this->cqRing != MAP_FAILED) && (this->cqRing != this->sqRing)) {
+    munmap(this->cqRing, this->cqRingSize);
+  }
+  if (this->sqRing != MAP_FAILED) {
+    munmap(this->sqRing, this->sqRingSize);
+  }
+}
+
+error_code IoUring::probe() {
+  IoUring ring{};
+  if (auto error = ring.init(4)) {
+    return error;
+  }
+  if (auto error = ring.registerBufferRing(0, 1, 64)) {
+    return error;
+  }
+
+  // Submit a single operation and wait for its first completion.
+  auto complete = [&](int & result) -> error_code {
+    if (auto error = ring.submit(1)) {
+      return error;
+    }
+    auto cqe = ring.peekCompletion();
+    result = cqe->res;
+    ring.advanceCompletion();
+    return result < 0 ? error_code{-result, system_category()} : error_code{};
+  };
+
+  // A connection to a loopback listener is completed by the kernel before it
+  // is accepted, so none of these calls will block.
+  int hListen{-1}, hClient{-1}, hAccepted{-1};
+  auto run = [&]() -> error_code {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    hListen = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    hClient = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ((hListen < 0) || (hClient < 0)
+      || bind(hListen, reinterpret_cast<sockaddr *>(&address), sizeof(address))
+      || listen(hListen, 1)
+      || getsockname(hListen, reinterpret_cast<sockaddr *>(&address), &length)
+      || connect(hClient, reinterpret_cast<sockaddr *>(&address), sizeof(address))) {
+      return {errno, system_category()};
+    }
+    ring.prepareAcceptMultishot(hListen, 0);
+    if (auto error = complete(hAccepted)) {
+      return error;
+    }
+    if (send(hClient, "x", 1, MSG_NOSIGNAL) < 0) {
+      return {errno, system_category()};
+    }
+    int received;
+    ring.prepareReceiveMultishot(hAccepted, 0);
+    return complete(received);
+  };
+  auto error = run();
+
+  // Closing the ring (in its destructor) cancels the multishot operations.
+  for (auto handle : {hAccepted, hClient, hListen}) {
+    if (handle >= 0) {
+      close(handle);
+    }
+  }
+  return error;
+}
+
+error_code IoUring::init(uint32_t entries) {
+  io_uring_params params{};
+  this->hRing = syscall(__NR_io_uring_setup, entries, &params);
+  if (this->hRing < 0) {
+    return {errno, system_category()};
+  }
+
+  // Map the submission and completion rings.  Newer kernels allow both rings
+  // to share a single mapping.
+  this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMap) {
+    this->sqRingSize = this->cqRingSize = max(this->sqRingSize, this->cqRingSize);
+  }
+  this->sqRing = mmap(nullptr, this->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->hRing, IORING_OFF_SQ_RING);
+  if (this->sqRing == MAP_FAILED) {
+    return {errno, system_category()};
+  }
+  if (singleMap) {
+    this->cqRing = this->sqRing;
+  }
+  else {
+    this->cqRing = mmap(nullptr, this->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->hRing, IORING_OFF_CQ_RING);
+    if (this->cqRing == MAP_FAILED) {
+      return {errno, system_category()};
+    }
+  }
+  void * sqesMap = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->hRing, IORING_OFF_SQES);
+  if (sqesMap == MAP_FAILED) {
+    return {errno, system_category()};
+  }
+  this->sqes = static_cast<io_uring_sqe *>(sqesMap);
+  this->sqEntries = params.sq_entries;
+
+  auto sq = static_cast<char *>(this->sqRing);
+  this->sqHead = reinterpret_cast<uint32_t *>(sq + params.sq_off.head);
+  this->sqTail = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+  this->sqMask = reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+  this->sqArray = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+  this->sqLocalTail = *this->sqTail;
+
+  auto cq = static_cast<char *>(this->cqRing);
+  this->cqHead = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+  this->cqTail = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+  this->cqMask = reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+  this->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  return {};
+}
+
+error_code IoUring::registerBufferRing(uint16_t groupId, uint16_t count, uint32_t size) {
+  // The ring must be page aligned, which mmap() guarantees.
+  void * ring = mmap(nullptr, count * sizeof(io_uring_buf), PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (ring == MAP_FAILED) {
+    return {errno, system_category()};
+  }
+  this->bufferRing = static_cast<io_uring_buf_ring *>(ring);
+  this->bufferCount = count;
+  this->bufferSize = size;
+  this->bufferGroup = groupId;
+  this->bufferTail = 0;
+
+  io_uring_buf_reg registration{};
+  registration.ring_addr = reinterpret_cast<uint64_t>(ring);
+  registration.ring_entries = count;
+  registration.bgid = groupId;
+  if (syscall(__NR_io_uring_register, this->hRing, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+    return {errno, system_category()};
+  }
+
+  // Hand every buffer to the kernel.
+  this->buffers = make_unique<char[]>(size_t{count} * size);
+  for (uint16_t i = 0; i < count; ++i) {
+    this->recycleBuffer(i);
+  }
+  return {};
+}
+
+char * IoUring::getBuffer(uint16_t bufferId) const {
+  return this->buffers.get() + size_t{bufferId} * this->bufferSize;
+}
+
+void IoUring::recycleBuffer(uint16_t bufferId) {
+  // The buffer entries overlay the ring header, starting at offset 0.  The
+  // flexible array member is not used, because the C++ layout of the kernel
+  // header's declaration may place it at a different offset.
+  auto & entry = reinterpret_cast<io_uring_buf *>(this->bufferRing)[this->bufferTail & (this->bufferCount - 1)];
+  entry.addr = reinterpret_cast<uint64_t>(this->getBuffer(bufferId));
+  entry.len = this->bufferSize;
+  entry.bid = bufferId;
+  ++this->bufferTail;
+  storeRelease(&this->bufferRing->tail, this->bufferTail);
+}
+
+bool IoUring::prepareAcceptMultishot(int fd, uint64_t userData) {
+  auto sqe = this->getSubmission();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = userData;
+  return true;
+}
+
+bool IoUring::prepareReceiveMultishot(int fd, uint64_t userData) {
+  auto sqe = this->getSubmission();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = this->bufferGroup;
+  sqe->user_data = userData;
+  return true;
+}
+
+bool IoUring::preparePollMultishot(int fd, uint64_t userData) {
+  auto sqe = this->getSubmission();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->poll32_events = POLLIN;
+  sqe->user_data = userData;
+  return true;
+}
+
+bool IoUring::preparePollWritable(int fd, uint64_t userData) {
+  auto sqe = this->getSubmission();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = POLLOUT;
+  sqe->user_data = userData;
+  return true;
+}
+
+bool IoUring::prepareSend(int fd, const void * buffer, uint32_t length, uint64_t userData, bool link) {
+  auto sqe = this->getSubmission();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer);
+  sqe->len = length;
+  // MSG_WAITALL asks the kernel to retry short sends internally, so that a
+  // link is only broken by a real error.
+  sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+  sqe->flags = link ? IOSQE_IO_LINK : 0;
+  sqe->user_data = userData;
+  return true;
+}
+
+error_code IoUring::submit(uint32_t waitFor) {
+  // Publish the pending entries.
+  uint32_t mask = *this->sqMask;
+  uint32_t tail = *this->sqTail;
+  for (uint32_t i = 0; i < this->sqPending; ++i) {
+    this->sqArray[tail & mask] = tail & mask;
+    ++tail;
+  }
+  storeRelease(this->sqTail, tail);
+  this->sqPending = 0;
+
+  while (1) {
+    // The kernel may consume fewer entries than it is offered (and then does
+    // not wait), so the entries which are still unconsumed are counted from
+    // the head, including any left over by a previous call.
+    uint32_t toSubmit = tail - loadAcquire(this->sqHead);
+    auto result = syscall(__NR_io_uring_enter, this->hRing, toSubmit, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return {errno, system_category()};
+    }
+    if (static_cast<uint32_t>(result) == toSubmit) {
+      return {};
+    }
+    if (!result) {
+      // No progress was made.  The entries remain published, and will be
+      // offered again by the next call.
+      return {EAGAIN, system_category()};
+    }
+  }
+}
+
+io_uring_cqe * IoUring::peekCompletion() {
+  uint32_t head = *this->cqHead;
+  if (head == loadAcquire(this->cqTail)) {
+    return nullptr;
+  }
+  return &this->cqes[head & *this->cqMask];
+}
+
+void IoUring::advanceCompletion() {
+  storeRelease(this->cqHead, *this->cqHead + 1);
+}
+
+uint32_t IoUring::getFreeSubmissionCount() const {
+  return this->sqEntries - (this->sqLocalTail - loadAcquire(this->sqHead));
+}
+
+io_uring_sqe * IoUring::getSubmission() {
+  if (this->getFreeSubmissionCount() == 0) {
+    return nullptr;
+  }
+  // Entries are used in order, so the index of the entry matches the
+  // position at which it will be published in the submission array.
+  auto sqe = &this->sqes[this->sqLocalTail & *this->sqMask];
+  ++this->sqLocalTail;
+  ++this->sqPending;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
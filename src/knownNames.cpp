@@ -0,0 +1,56 @@
+/**
+ * @file
+ *
+ * Define the well-known field name, method, and status functions.
+ */
+
+#include <string>
+#include "wave/knownNames.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+// Verify the tables at compile time.
+static_assert(lookupFieldName("Content-Length") == FieldName::CONTENT_LENGTH);
+static_assert(lookupFieldName("transfer-encoding") == FieldName::TRANSFER_ENCODING);
+static_assert(lookupFieldName("X-Content-Length") == FieldName::UNKNOWN);
+static_assert(lookupMethod("GET") == Method::GET);
+static_assert(lookupMethod("get") == Method::UNKNOWN);
+
+/**
+ * Create a shared string for each of the names in a table.
+ *
+ * @param texts The names.
+ * @result The shared strings.
+ */
+template <size_t COUNT>
+static array<shared_string_view, COUNT> makeSharedTexts(const array<string_view, COUNT> & texts) {
+  array<shared_string_view, COUNT> shared{};
+  for (size_t i = 0; i < COUNT; ++i) {
+    shared[i] = shared_string_view{texts[i]};
+  }
+  return shared;
+}
+
+const shared_string_view & Ghoti::Wave::getFieldNameText(FieldName name) {
+  static const auto names{makeSharedTexts(fieldNameTexts)};
+  return names[static_cast<size_t>(name)];
+}
+
+const shared_string_view & Ghoti::Wave::getMethodText(Method method) {
+  static const auto methods{makeSharedTexts(methodTexts)};
+  return methods[static_cast<size_t>(method)];
+}
+
+string_view Ghoti::Wave::getStatusLine(size_t statusCode) {
+  static const auto lines{[]() {
+    // Indexed by the status code, from 100 to 599.
+    array<string, 500> lines{};
+    for (auto & [code, text] : statusReasons) {
+      lines[code - 100] = "HTTP/1.1 " + to_string(code) + " " + string{text} + "\r\n";
+    }
+    return lines;
+  }()};
+  return ((statusCode >= 100) && (statusCode < 600)) ? string_view{lines[statusCode - 100]} : string_view{};
+}
@@ -3,8 +3,11 @@
  * Define the Ghoti::Wave::Message class.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <iostream>
+#include <memory>
 #include "wave/message.hpp"
 #include "wave/parsing.hpp"
 
@@ -13,6 +16,125 @@ using namespace Ghoti;
 using namespace Ghoti::Wave;
 
 static shared_string_view defaultMethod{"GET"};
+static shared_string_view emptyText{};
+
+/**
+ * Measures the length of rendered text, without writing it.
+ */
+struct MeasuredText {
+  size_t length{0};
+
+  void append(string_view text) {
+    this->length += text.length();
+  }
+
+  void appendNumber(size_t number) {
+    char digits[20];
+    this->length += to_chars(digits, digits + sizeof(digits), number).ptr - digits;
+  }
+
+  void appendFieldValue(const shared_string_view & value) {
+    // Only use double quotes if necessary.
+    // https://www.rfc-editor.org/rfc/rfc9110.html#section-5.6.4-5
+    this->length += fieldValueQuotesNeeded(value)
+      ? fieldValueEscapedLength(value) + 2
+      : value.length();
+  }
+};
+
+/**
+ * Writes rendered text into a buffer which has already been sized by
+ * MeasuredText.
+ */
+struct WrittenText {
+  char * cursor;
+
+  void append(string_view text) {
+    this->cursor = copy(text.begin(), text.end(), this->cursor);
+  }
+
+  void appendNumber(size_t number) {
+    this->cursor = to_chars(this->cursor, this->cursor + 20, number).ptr;
+  }
+
+  void appendFieldValue(const shared_string_view & value) {
+    if (fieldValueQuotesNeeded(value)) {
+      *this->cursor++ = '"';
+      this->cursor = fieldValueEscapeTo(this->cursor, value);
+      *this->cursor++ = '"';
+    }
+    else {
+      this->append(value);
+    }
+  }
+};
+
+/**
+ * Render text with a single allocation.
+ *
+ * The text is rendered twice: once to measure it, and once to write it into a
+ * buffer of exactly that size.
+ *
+ * @param render A function which renders the text into its argument, which is
+ *   either a MeasuredText or a WrittenText.
+ * @result The rendered text.
+ */
+template <typename Render>
+static shared_string_view renderText(Render render) {
+  MeasuredText measured{};
+  render(measured);
+  string text(measured.length, '\0');
+  WrittenText written{text.data()};
+  render(written);
+  assert(written.cursor == text.data() + text.length());
+  return shared_string_view{move(text)};
+}
+
+/**
+ * Render the start line and header fields of a message, as HTTP/1.1.
+ *
+ * The empty line which ends the header is not included.
+ *
+ * @param message The message.
+ * @param out The MeasuredText or WrittenText.
+ */
+template <typename Output>
+static void renderHeader1(const Message & message, Output & out) {
+  if (message.getType() == Message::Type::REQUEST) {
+    out.append(message.getMethod());
+    out.append(" ");
+    out.append(message.getTarget());
+    out.append(" HTTP/1.1\r\n");
+  }
+  else if (auto statusLine = getStatusLine(message.getStatusCode()); statusLine.length() && message.getMessage().empty()) {
+    out.append(statusLine);
+  }
+  else {
+    out.append("HTTP/1.1 ");
+    out.appendNumber(message.getStatusCode());
+    out.append(" ");
+    out.append(message.getMessage());
+    out.append("\r\n");
+  }
+  for (auto & [field, values] : message.getFields()) {
+    if (values.empty()) {
+      continue;
+    }
+    // Output the field name as provided.
+    out.append(field);
+    out.append(": ");
+
+    // Multiple values are joined as a list, and each is wrapped with double
+    // quotes only when necessary.
+    bool isFirst{true};
+    for (auto & value : values) {
+      out.append(isFirst ? "" : ", ");
+      out.appendFieldValue(value);
+      isFirst = false;
+    }
+    out.append("\r\n");
+  }
+}
 
 Message::Message(Type type) :
   headerIsRendered{false},
@@ -27,10 +149,12 @@ Message::Message(Type type) :
   contentLength{0},
   message{},
   method{defaultMethod},
+  methodId{Method::GET},
   domain{},
   target{},
   version{},
   messageBody{},
+  bodyStream{},
   headers{},
   trailers{},
   readySemaphore{0} {
@@ -50,11 +174,13 @@ void Message::adoptContents(Message & source) {
   this->contentLength = move(source.contentLength);
   this->message = move(source.message);
   this->method = move(source.method);
+  this->methodId = move(source.methodId);
   this->domain = move(source.domain);
   this->target = move(source.target);
   this->version = move(source.version);
   this->messageBody = move(source.messageBody);
   this->chunks = move(source.chunks);
+  this->bodyStream = move(source.bodyStream);
   this->headers = move(source.headers);
   this->trailers = move(source.trailers);
 
@@ -69,6 +195,39 @@ void Message::adoptContents(Message & source) {
   }
 }
 
+void Message::reset() {
+  this->headerIsRendered = false;
+  this->errorIsSet = false;
+  this->headerIsSent = false;
+  this->messageIsFinished = false;
+  this->transport = UNDECLARED;
+  this->id = 0;
+  this->port = 0;
+  this->statusCode = {};
+  this->contentLength = 0;
+  this->chunkBytesSent = 0;
+  this->currentChunk = 0;
+  this->renderedHeader = emptyText;
+  this->message = emptyText;
+  this->method = defaultMethod;
+  this->methodId = Method::GET;
+  this->domain = emptyText;
+  this->target = Target{emptyText};
+  this->version = emptyText;
+  this->messageBody.set(emptyText);
+  this->chunks.clear();
+  this->bodyStream.reset();
+  this->headers.clear();
+  this->trailers.clear();
+  HasMessageParameters::operator=(HasMessageParameters{});
+
+  // The message is no longer ready.  The semaphore is replaced, rather than
+  // drained with try_acquire(), which spins for about a microsecond when
+  // there is nothing to acquire.
+  destroy_at(&this->readySemaphore);
+  construct_at(&this->readySemaphore, 0);
+}
+
 Message::Type Message::getType() const noexcept {
   return this->type;
 }
@@ -84,61 +243,40 @@ Message::Transport Message::getTransport() const noexcept {
 
 const shared_string_view & Message::getRenderedHeader1() {
   if (!this->headerIsRendered) {
-    if (this->type == REQUEST) {
-      this->renderedHeader = this->getMethod()
-        + " " + this->getTarget()
-        + " HTTP/1.1\r\n";
-    }
-    else {
-      this->renderedHeader = "HTTP/1.1 "
-        + to_string(this->statusCode)
-        + " " + (this->message.length() ? string{this->message} : "OK")
-        + "\r\n";
-    }
-    for (auto & [field, values] : this->headers) {
-      if (values.size()) {
-        // Output the field name as provided.
-        this->renderedHeader += field + ": ";
-
-        // Convert the field name to uppercase for use by isListField().
-        auto temp = string{field};
-        transform(temp.begin(), temp.end(), temp.begin(), ::toupper);
-
-        // Wrap the field values with double quotes only when necessary.
-        if (!isListField(temp) && (values.size() == 1)) {
-          // Only use double quotes if necessary.
-          // https://www.rfc-editor.org/rfc/rfc9110.html#section-5.6.4-5
-          if (fieldValueQuotesNeeded(values[0])) {
-            this->renderedHeader += '"' + fieldValueEscape(values[0]) + '"';
-          }
-          else {
-            this->renderedHeader += values[0];
-          }
-          this->renderedHeader += "\r\n";
-        }
-        else {
-          bool isFirst{true};
-          for (auto & value : values) {
-            this->renderedHeader += isFirst ? "" : ", ";
-            // Only use double quotes if necessary.
-            // https://www.rfc-editor.org/rfc/rfc9110.html#section-5.6.4-5
-            if (fieldValueQuotesNeeded(value)) {
-              this->renderedHeader += '"' + fieldValueEscape(value) + '"';
-            }
-            else {
-              this->renderedHeader += value;
-            }
-            isFirst = false;
-          }
-          this->renderedHeader += "\r\n";
-        }
-      }
-    }
+    this->renderedHeader = renderText([&](auto & out) {
+      renderHeader1(*this, out);
+    });
     this->headerIsRendered = true;
   }
   return this->renderedHeader;
 }
 
+shared_string_view Message::getRenderedHeader1(size_t contentLength) {
+  auto renderFraming = [&](auto & out) {
+    out.append("Content-Length: ");
+    out.appendNumber(contentLength);
+    out.append("\r\n\r\n");
+  };
+  if (this->headerIsRendered) {
+    return renderText([&](auto & out) {
+      out.append(this->renderedHeader);
+      renderFraming(out);
+    });
+  }
+
+  // The header is rendered into the same buffer as the framing, and is kept
+  // as a view of it.
+  auto rendered = renderText([&](auto & out) {
+    renderHeader1(*this, out);
+    renderFraming(out);
+  });
+  MeasuredText framing{};
+  renderFraming(framing);
+  this->renderedHeader = rendered.substr(0, rendered.length() - framing.length);
+  this->headerIsRendered = true;
+  return rendered;
+}
+
 bool Message::hasError() const {
   return this->errorIsSet;
 }
@@ -176,6 +314,7 @@ const shared_string_view & Message::getMessage() const {
 Message & Message::setMethod(const shared_string_view & method) {
   if (!this->headerIsRendered) {
     this->method = method;
+    this->methodId = lookupMethod(method);
   }
   return *this;
 }
@@ -184,14 +323,22 @@ const shared_string_view & Message::getMethod() const {
   return this->method;
 }
 
+Method Message::getMethodId() const {
+  return this->methodId;
+}
+
 Message & Message::setTarget(const shared_string_view & target) {
   if (!this->headerIsRendered) {
-    this->target = target;
+    this->target = Target{target};
   }
   return *this;
 }
 
 const shared_string_view & Message::getTarget() const {
+  return this->target.getText();
+}
+
+const Target & Message::getParsedTarget() const {
   return this->target;
 }
 
@@ -208,21 +355,44 @@ const shared_string_view & Message::getVersion() const {
 
 Message & Message::addFieldValue(const shared_string_view & name, const shared_string_view & value) {
   if (!this->headerIsRendered) {
-    this->headers[name].push_back(value);
+    this->headers.add(name, value);
+  }
+  return *this;
+}
+
+Message & Message::addFieldValue(FieldName id, const shared_string_view & name, shared_string_view value) {
+  if (!this->headerIsRendered) {
+    this->headers.add(id, name, move(value));
+  }
+  return *this;
+}
+
+Message & Message::addUnparsedFieldValue(FieldName id, const shared_string_view & name, shared_string_view value) {
+  if (!this->headerIsRendered) {
+    this->headers.addUnparsed(id, name, move(value));
   }
   return *this;
 }
 
 Message & Message::addTrailerFieldValue(const shared_string_view & name, const shared_string_view & value) {
-  this->trailers[name].push_back(value);
+  this->trailers.add(name, value);
+  return *this;
+}
+
+Message & Message::addUnparsedTrailerFieldValue(FieldName id, const shared_string_view & name, shared_string_view value) {
+  this->trailers.addUnparsed(id, name, move(value));
   return *this;
 }
 
-const map<shared_string_view, vector<shared_string_view>> & Message::getFields() const {
+const FieldCollection & Message::getFields() const {
   return this->headers;
 }
 
-const map<shared_string_view, vector<shared_string_view>> & Message::getTrailerFields() const {
+FieldCollection::Values Message::getFieldValues(FieldName name) const {
+  return this->headers.get(name);
+}
+
+const FieldCollection & Message::getTrailerFields() const {
   return this->trailers;
 }
 
@@ -292,6 +462,15 @@ const std::vector<Ghoti::Wave::Blob> & Message::getChunks() const {
   return this->chunks;
 }
 
+Message & Message::setBodyStream(shared_ptr<BodyStream> bodyStream) {
+  this->bodyStream = move(bodyStream);
+  return *this;
+}
+
+const shared_ptr<BodyStream> & Message::getBodyStream() const {
+  return this->bodyStream;
+}
+
 ostream & Ghoti::Wave::operator<<(ostream & out, Message & message) {
   string indent{"  "};
 
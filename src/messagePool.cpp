@@ -0,0 +1,48 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::MessagePool class.
+ */
+
+#include "wave/messagePool.hpp"
+
+using namespace std;
+using namespace Ghoti::Wave;
+
+void MessagePool::Releaser::operator()(Message * message) const {
+  unique_ptr<Message> owned{message};
+  if (auto pool = this->pool.lock()) {
+    pool->release(move(owned));
+  }
+}
+
+MessagePool::MessagePool(size_t maxFree) : maxFree{maxFree}, controlMutex{}, freeMessages{} {}
+
+shared_ptr<Message> MessagePool::acquire(Message::Type type) {
+  unique_ptr<Message> message{};
+  {
+    scoped_lock lock{this->controlMutex};
+    auto & freeMessages = this->freeMessages[type];
+    if (freeMessages.size()) {
+      message = move(freeMessages.back());
+      freeMessages.pop_back();
+    }
+  }
+
+  // There are no free messages, so construct one.
+  if (!message) {
+    message = make_unique<Message>(type);
+  }
+  return {message.release(), Releaser{this->weak_from_this()}};
+}
+
+void MessagePool::release(unique_ptr<Message> && message) {
+  // The message is reset straight away, rather than when it is reused, so
+  // that it does not keep its body (or the input that it refers to) alive.
+  message->reset();
+  scoped_lock lock{this->controlMutex};
+  auto & freeMessages = this->freeMessages[message->getType()];
+  if (freeMessages.size() < this->maxFree) {
+    freeMessages.push_back(move(message));
+  }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::OutputQueue class.
+ */
+
+#include <array>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "wave/outputQueue.hpp"
+
+using namespace std;
+using namespace Ghoti::Wave;
+
+/**
+ * The maximum number of segments gathered into a single call to `sendmsg()`.
+ */
+#define MAX_WRITE_SEGMENTS 64
+
+OutputQueue::OutputQueue() : segments{}, offset{0} {}
+
+void OutputQueue::push(OutputSegment && segment) {
+  this->segments.push_back(move(segment));
+}
+
+void OutputQueue::push(const Blob & blob) {
+  for (auto & segment : OutputSegment::fromBlob(blob)) {
+    this->segments.push_back(move(segment));
+  }
+}
+
+bool OutputQueue::empty() const {
+  return this->segments.empty();
+}
+
+error_code OutputQueue::sendTo(int hSocket) {
+  while (this->segments.size()) {
+    // Remove the segments which have been completely written (or which are
+    // empty, since sendfile() cannot distinguish an empty file segment from
+    // one whose file has been truncated).
+    if (this->offset >= this->segments.front().length()) {
+      this->offset -= this->segments.front().length();
+      this->segments.pop_front();
+      continue;
+    }
+
+    ssize_t bytesWritten;
+    if (this->segments.front().isFile()) {
+      // File contents are sent directly from the file.
+      bytesWritten = this->segments.front().sendTo(hSocket, this->offset);
+    }
+    else {
+      // Gather the in-memory segments, starting from the partially written
+      // one, up to the next file segment.
+      array<iovec, MAX_WRITE_SEGMENTS> vectors;
+      size_t vectorCount{0};
+      for (auto & segment : this->segments) {
+        if ((vectorCount == vectors.size()) || segment.isFile()) {
+          break;
+        }
+        string_view view{segment.getText()};
+        size_t segmentOffset = vectorCount ? 0 : this->offset;
+        vectors[vectorCount].iov_base = const_cast<char *>(view.data() + segmentOffset);
+        vectors[vectorCount].iov_len = view.length() - segmentOffset;
+        ++vectorCount;
+      }
+      msghdr message{};
+      message.msg_iov = vectors.data();
+      message.msg_iovlen = vectorCount;
+      bytesWritten = sendmsg(hSocket, &message, MSG_NOSIGNAL);
+    }
+
+    // Detect any errors.
+    if (bytesWritten == -1) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        // The socket buffer is full.  The caller will try again when the
+        // socket becomes writable.
+        return {};
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      return {errno, system_category()};
+    }
+
+    this->offset += bytesWritten;
+  }
+  return {};
+}
+
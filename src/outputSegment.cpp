@@ -0,0 +1,144 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::OutputSegment class.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <limits>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include "wave/outputSegment.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+/**
+ * The largest number of bytes that Linux will transfer in a single call to
+ * `sendfile()`.
+ */
+#define MAX_SENDFILE_LENGTH 0x7ffff000
+
+OutputSegment::OutputSegment(const shared_string_view & text) : text{text}, hFile{-1}, fileError{0}, fileLength{0} {}
+
+OutputSegment::OutputSegment(const Blob & blob) : text{}, hFile{-1}, fileError{0}, fileLength{0} {
+  // An anonymous file is shared through a duplicate of its descriptor,
+  // which is safe because sendfile() is always given an explicit offset.
+  if (blob.getDescriptor() != -1) {
+    this->hFile = fcntl(blob.getDescriptor(), F_DUPFD_CLOEXEC, 0);
+    this->fileError = (this->hFile == -1) ? errno : 0;
+    this->fileLength = (this->hFile == -1) ? numeric_limits<size_t>::max() : *blob.sizeOrError();
+    return;
+  }
+
+  // The length is taken from the open file, so that it matches what will
+  // actually be sent.
+  struct stat status;
+  this->hFile = open(blob.getFile().getPath().c_str(), O_RDONLY | O_CLOEXEC);
+  if ((this->hFile == -1) || (fstat(this->hFile, &status) == -1)) {
+    // The segment can never be completed, so that a writer will always reach
+    // sendTo() and receive the error.
+    this->fileError = errno;
+    this->fileLength = numeric_limits<size_t>::max();
+    return;
+  }
+  this->fileLength = status.st_size;
+}
+
+vector<OutputSegment> OutputSegment::fromBlob(const Blob & blob) {
+  vector<OutputSegment> segments{};
+  if (blob.getType() != Blob::Type::TEXT) {
+    segments.push_back(OutputSegment{blob});
+    return segments;
+  }
+  auto views = blob.getSegments();
+  segments.reserve(views.size());
+  for (auto & view : views) {
+    segments.emplace_back(view);
+  }
+  return segments;
+}
+
+OutputSegment::OutputSegment(OutputSegment && source) :
+  text{move(source.text)},
+  hFile{exchange(source.hFile, -1)},
+  fileError{source.fileError},
+  fileLength{source.fileLength} {}
+
+OutputSegment & OutputSegment::operator=(OutputSegment && source) {
+  if (this != &source) {
+    if (this->hFile != -1) {
+      close(this->hFile);
+    }
+    this->text = move(source.text);
+    this->hFile = exchange(source.hFile, -1);
+    this->fileError = source.fileError;
+    this->fileLength = source.fileLength;
+  }
+  return *this;
+}
+
+OutputSegment::~OutputSegment() {
+  if (this->hFile != -1) {
+    close(this->hFile);
+  }
+}
+
+size_t OutputSegment::length() const {
+  return this->isFile() ? this->fileLength : this->text.length();
+}
+
+bool OutputSegment::isFile() const {
+  return (this->hFile != -1) || this->fileError;
+}
+
+string_view OutputSegment::getText() const {
+  return this->text;
+}
+
+ssize_t OutputSegment::sendTo(int hSocket, size_t offset) const {
+  if (!this->isFile()) {
+    string_view view{this->text};
+    return send(hSocket, view.data() + offset, view.length() - offset, MSG_NOSIGNAL);
+  }
+  if (this->fileError) {
+    errno = this->fileError;
+    return -1;
+  }
+
+  // sendfile() has no equivalent of MSG_NOSIGNAL, so SIGPIPE is blocked for
+  // the duration of the call, and any SIGPIPE that it raises is discarded.
+  sigset_t pipeSignal, previousSignals;
+  sigemptyset(&pipeSignal);
+  sigaddset(&pipeSignal, SIGPIPE);
+  sigset_t pending;
+  sigpending(&pending);
+  bool alreadyPending = sigismember(&pending, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSignal, &previousSignals);
+
+  off_t fileOffset = offset;
+  auto bytesWritten = sendfile(hSocket, this->hFile, &fileOffset, min<size_t>(this->fileLength - offset, MAX_SENDFILE_LENGTH));
+  if (!bytesWritten) {
+    // The file has been truncated since it was opened, so the segment can
+    // never be completed.
+    bytesWritten = -1;
+    errno = EIO;
+  }
+
+  if ((bytesWritten == -1) && (errno == EPIPE) && !alreadyPending) {
+    timespec noWait{0, 0};
+    sigtimedwait(&pipeSignal, nullptr, &noWait);
+    errno = EPIPE;
+  }
+  pthread_sigmask(SIG_SETMASK, &previousSignals, nullptr);
+  return bytesWritten;
+}
+
@@ -4,9 +4,13 @@
  * Define the text parsing functions.
  */
 
+#include <atomic>
 #include <cstdint>
 #include <ctype.h>
-#include <set>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WAVE_SCAN_X86
+#endif
 #include "parsing.hpp"
 
 using namespace std;
@@ -15,36 +19,8 @@ using namespace Ghoti::Wave;
 
 namespace Ghoti::Wave {
 
-/**
- * Fields identified as having values that are expected to be a list.
- * https://datatracker.ietf.org/doc/html/rfc9110
- */
-static set<shared_string_view> listFields{
-  "ACCEPT",
-  "ACCEPT-CHARSET",
-  "ACCEPT-ENCODING",
-  "ACCEPT-LANGUAGE",
-  "ACCEPT-RANGES",
-  "ALLOW",
-  "AUTHENTICATION-INFO",
-  "CONNECTION",
-  "CONTENT-ENCODING",
-  "CONTENT-LANGUAGE",
-  "EXPECT",
-  "IF-MATCH",
-  "IF-NONE-MATCH",
-  "PROXY-AUTHENTICATE",
-  "PROXY-AUTHENTICATION-INFO",
-  "TE",
-  "TRAILER",
-  "UPGRADE",
-  "VARY",
-  "VIA",
-  "WWW-AUTHENTICATE",
-};
-
 bool isListField(const shared_string_view & name) {
-  return listFields.contains(name);
+  return isListField(lookupFieldName(name));
 }
 
 bool isTokenChar(uint8_t c) {
@@ -219,6 +195,38 @@ bool isFieldContentChar(uint8_t c) {
   return map[c];
 }
 
+bool isTargetChar(uint8_t c) {
+  // https://datatracker.ietf.org/doc/html/rfc3986#appendix-A
+  static bool map[] = {
+    //Nul                  BelBs Tb Lf Vt Ff Cr
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    //                                 Esc
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    //SP !  "  #  $  %  &  '  (  )  *  +  ,  -  .  /
+      0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    //0  1  2  3  4  5  6  7  8  9  :  ;  <  =  >  ?
+      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1,
+    //@  A  B  C  D  E  F  G  H  I  J  K  L  M  N  O
+      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    //P  Q  R  S  T  U  V  W  X  Y  Z  [  \  ]  ^  _
+      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1,
+    //`  a  b  c  d  e  f  g  h  i  j  k  l  m  n  o
+      0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    //p  q  r  s  t  u  v  w  x  y  z  {  |  }  ~  Del
+      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0,
+    //Extended ascii
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  };
+  return map[c];
+}
+
 bool isCRLFChar(uint8_t c) {
   static bool map[] = {
     //Nul                  BelBs Tb Lf Vt Ff Cr
@@ -250,6 +258,229 @@ bool isCRLFChar(uint8_t c) {
   return map[c];
 }
 
+/**
+ * A character class, in the forms used by the scanning kernels.
+ *
+ * For the characters below 0x80, bit `h` of `rows[l]` is set if the character
+ * `(h << 4) | l` is a member of the class.  The characters from 0x80 upward
+ * are either all members (`extended`) or all non-members, which is true of
+ * every class that the parser scans for.
+ */
+struct CharClass {
+  /**
+   * The membership bitmap, indexed by the low nibble of the character.
+   */
+  alignas(16) uint8_t rows[16];
+
+  /**
+   * Whether or not the characters from 0x80 upward are members.
+   */
+  bool extended;
+
+  /**
+   * The membership of each character, for the scalar kernel.
+   */
+  bool members[256];
+};
+
+/**
+ * Build a CharClass from a character test function.
+ *
+ * @param contains The character test function.
+ * @result The CharClass.
+ */
+static CharClass makeCharClass(bool (*contains)(uint8_t c)) {
+  CharClass charClass{{}, contains(0x80), {}};
+  for (unsigned c = 0; c < 256; ++c) {
+    charClass.members[c] = contains(c);
+    if ((c < 0x80) && contains(c)) {
+      charClass.rows[c & 0x0f] |= 1 << (c >> 4);
+    }
+  }
+  return charClass;
+}
+
+static bool isNotCRLFChar(uint8_t c) {
+  return !isCRLFChar(c);
+}
+
+static bool isNotEncodedChar(uint8_t c) {
+  return (c != '%') && (c != '+');
+}
+
+static const CharClass tokenClass = makeCharClass(isTokenChar);
+static const CharClass fieldContentClass = makeCharClass(isFieldContentChar);
+static const CharClass quotedClass = makeCharClass(isQuotedChar);
+static const CharClass notCRLFClass = makeCharClass(isNotCRLFChar);
+static const CharClass targetClass = makeCharClass(isTargetChar);
+static const CharClass notEncodedClass = makeCharClass(isNotEncodedChar);
+
+/**
+ * A scanning kernel, which returns the offset of the first character that is
+ * not a member of the class, or `length` if there is none.
+ */
+using Scanner = size_t (*)(const uint8_t * data, size_t length, const CharClass & charClass);
+
+static size_t scanScalar(const uint8_t * data, size_t length, const CharClass & charClass) {
+  size_t i{0};
+  while ((i < length) && charClass.members[data[i]]) {
+    ++i;
+  }
+  return i;
+}
+
+#ifdef WAVE_SCAN_X86
+// The vector kernels classify 16 (or 32) characters at once.  The low nibble
+// of each character selects its row of the bitmap, and the high nibble
+// selects the bit within that row, both with `pshufb`.  Characters from 0x80
+// upward select no bit, and are handled with a sign test instead.
+
+[[gnu::target("sse4.2")]]
+static size_t scanSse42(const uint8_t * data, size_t length, const CharClass & charClass) {
+  const __m128i rows = _mm_load_si128(reinterpret_cast<const __m128i *>(charClass.rows));
+  const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i lowNibble = _mm_set1_epi8(0x0f);
+  const __m128i extended = _mm_set1_epi8(charClass.extended ? -1 : 0);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i{0};
+  for (; i + 16 <= length; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i row = _mm_shuffle_epi8(rows, _mm_and_si128(chunk, lowNibble));
+    __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(chunk, 4), lowNibble));
+    __m128i outside = _mm_cmpeq_epi8(_mm_and_si128(row, bit), zero);
+    __m128i extendedMember = _mm_and_si128(_mm_cmplt_epi8(chunk, zero), extended);
+    unsigned mask = _mm_movemask_epi8(_mm_andnot_si128(extendedMember, outside));
+    if (mask) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scanScalar(data + i, length - i, charClass);
+}
+
+[[gnu::target("avx2")]]
+static size_t scanAvx2(const uint8_t * data, size_t length, const CharClass & charClass) {
+  const __m256i rows = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(charClass.rows)));
+  const __m256i bits = _mm256_setr_epi8(
+    1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i lowNibble = _mm256_set1_epi8(0x0f);
+  const __m256i extended = _mm256_set1_epi8(charClass.extended ? -1 : 0);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i{0};
+  for (; i + 32 <= length; i += 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    __m256i row = _mm256_shuffle_epi8(rows, _mm256_and_si256(chunk, lowNibble));
+    __m256i bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), lowNibble));
+    __m256i outside = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), zero);
+    __m256i extendedMember = _mm256_and_si256(_mm256_cmpgt_epi8(zero, chunk), extended);
+    unsigned mask = _mm256_movemask_epi8(_mm256_andnot_si256(extendedMember, outside));
+    if (mask) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  // Finish any remaining 16 byte block before falling back to scalar code.
+  // The SSE kernel is not VEX-encoded, so the upper halves of the registers
+  // must be cleared first.  Otherwise, every later SSE instruction (including
+  // those in memcpy() and friends) pays for a false dependency on them.
+  _mm256_zeroupper();
+  return i + scanSse42(data + i, length - i, charClass);
+}
+#endif
+
+/**
+ * Identify the fastest scanning kernel supported by the CPU.
+ *
+ * @result The fastest supported kernel.
+ */
+static ScanKernel bestScanKernel() {
+#ifdef WAVE_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return ScanKernel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return ScanKernel::SSE4_2;
+  }
+#endif
+  return ScanKernel::SCALAR;
+}
+
+static Scanner getScanner(ScanKernel kernel) {
+  switch (kernel) {
+#ifdef WAVE_SCAN_X86
+    case ScanKernel::AVX2:
+      return scanAvx2;
+    case ScanKernel::SSE4_2:
+      return scanSse42;
+#endif
+    default:
+      return scanScalar;
+  }
+}
+
+static size_t scanResolve(const uint8_t * data, size_t length, const CharClass & charClass);
+
+/**
+ * The scanning kernel in use.
+ *
+ * It starts out as a stub which selects the best kernel on the first call, so
+ * that the CPU is only queried once, and only if it is needed.
+ */
+static atomic<Scanner> scanner{scanResolve};
+
+static size_t scanResolve(const uint8_t * data, size_t length, const CharClass & charClass) {
+  Scanner expected{scanResolve};
+  scanner.compare_exchange_strong(expected, getScanner(bestScanKernel()), memory_order_relaxed);
+  return scanner.load(memory_order_relaxed)(data, length, charClass);
+}
+
+ScanKernel getScanKernel() {
+  Scanner current = scanner.load(memory_order_relaxed);
+#ifdef WAVE_SCAN_X86
+  if (current == scanAvx2) {
+    return ScanKernel::AVX2;
+  }
+  if (current == scanSse42) {
+    return ScanKernel::SSE4_2;
+  }
+#endif
+  return current == scanScalar
+    ? ScanKernel::SCALAR
+    : bestScanKernel();
+}
+
+bool setScanKernel(ScanKernel kernel) {
+  if (static_cast<int>(kernel) > static_cast<int>(bestScanKernel())) {
+    return false;
+  }
+  scanner.store(getScanner(kernel), memory_order_relaxed);
+  return true;
+}
+
+size_t findNonTokenChar(const char * data, size_t length) {
+  return scanner.load(memory_order_relaxed)(reinterpret_cast<const uint8_t *>(data), length, tokenClass);
+}
+
+size_t findNonFieldContentChar(const char * data, size_t length) {
+  return scanner.load(memory_order_relaxed)(reinterpret_cast<const uint8_t *>(data), length, fieldContentClass);
+}
+
+size_t findNonQuotedChar(const char * data, size_t length) {
+  return scanner.load(memory_order_relaxed)(reinterpret_cast<const uint8_t *>(data), length, quotedClass);
+}
+
+size_t findCRLFChar(const char * data, size_t length) {
+  return scanner.load(memory_order_relaxed)(reinterpret_cast<const uint8_t *>(data), length, notCRLFClass);
+}
+
+size_t findNonTargetChar(const char * data, size_t length) {
+  return scanner.load(memory_order_relaxed)(reinterpret_cast<const uint8_t *>(data), length, targetClass);
+}
+
+size_t findEncodedChar(const char * data, size_t length) {
+  return scanner.load(memory_order_relaxed)(reinterpret_cast<const uint8_t *>(data), length, notEncodedClass);
+}
+
 bool fieldValueQuotesNeeded(const shared_string_view & str) {
   // The presence of any character that is not a token also requires the value
   // to be double-quoted.
@@ -266,44 +497,61 @@ bool fieldValueQuotesNeeded(const shared_string_view & str) {
   return false;
 }
 
+/**
+ * The characters which may appear unescaped in a quoted string, identified as
+ * "qdtext" in the spec.
+ * https://www.rfc-editor.org/rfc/rfc9110.html#section-5.6.4-2
+ */
+static const bool qdtextChars[] = {
+  //Nul                  BelBs Tb Lf Vt Ff Cr
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0,
+  //                                 Esc
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  //SP !  "  #  $  %  &  '  (  )  *  +  ,  -  .  /
+    1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  //0  0  2  3  4  5  6  7  8  9  :  ;  <  =  >  ?
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  //@  A  B  C  D  E  F  G  H  I  J  K  L  M  N  O
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  //P  Q  R  S  T  U  V  W  X  Y  Z  [  \  ]  ^  _
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1,
+  //`  a  b  c  d  e  f  g  h  i  j  k  l  m  n  o
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  //p  q  r  s  t  u  v  w  x  y  z  {  |  }  ~  Del
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0,
+  //Extended ascii
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+};
+
 string fieldValueEscape(const shared_string_view & str) {
-  // Safe characters, identified as "qdtext" in the spec.
-  // https://www.rfc-editor.org/rfc/rfc9110.html#section-5.6.4-2
-  static bool safe[] = {
-    //Nul                  BelBs Tb Lf Vt Ff Cr
-      0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0,
-    //                                 Esc
-      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    //SP !  "  #  $  %  &  '  (  )  *  +  ,  -  .  /
-      1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    //0  0  2  3  4  5  6  7  8  9  :  ;  <  =  >  ?
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    //@  A  B  C  D  E  F  G  H  I  J  K  L  M  N  O
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    //P  Q  R  S  T  U  V  W  X  Y  Z  [  \  ]  ^  _
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1,
-    //`  a  b  c  d  e  f  g  h  i  j  k  l  m  n  o
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    //p  q  r  s  t  u  v  w  x  y  z  {  |  }  ~  Del
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0,
-    //Extended ascii
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-  };
-  string temp{};
+  string temp(fieldValueEscapedLength(str), '\0');
+  fieldValueEscapeTo(temp.data(), str);
+  return temp;
+}
+
+size_t fieldValueEscapedLength(string_view str) {
+  size_t length{str.length()};
+  for (auto & ch : str) {
+    length += !qdtextChars[(uint8_t) ch];
+  }
+  return length;
+}
+
+char * fieldValueEscapeTo(char * out, string_view str) {
   for (auto & ch : str) {
-    if (!safe[(uint8_t) ch]) {
-      temp += '\\';
+    if (!qdtextChars[(uint8_t) ch]) {
+      *out++ = '\\';
     }
-    temp += ch;
+    *out++ = ch;
   }
-  return temp;
+  return out;
 }
 
 }
@@ -8,5 +8,26 @@
 using namespace std;
 using namespace Ghoti::Wave;
 
+Response::Response(function<void()> && onComplete) : Response{move(onComplete), make_shared<Message>(Message::Type::RESPONSE)} {}
 
+Response::Response(function<void()> && onComplete, shared_ptr<Message> && message) :
+  message{move(message)},
+  onComplete{move(onComplete)},
+  completed{false} {}
+
+Message & Response::getMessage() {
+  return *this->message;
+}
+
+void Response::complete() {
+  // The release ordering publishes the handler's changes to the Message to
+  // the thread which observes the completion.
+  if (!this->completed.exchange(true, memory_order_acq_rel) && this->onComplete) {
+    this->onComplete();
+  }
+}
+
+bool Response::isComplete() const {
+  return this->completed.load(memory_order_acquire);
+}
 
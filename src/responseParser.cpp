@@ -0,0 +1,9 @@
+/**
+ * @file
+ *
+ * Instantiate the Ghoti::Wave::ResponseParser state machine.
+ */
+
+#include "wave/parserStateMachine.hpp"
+
+template class Ghoti::Wave::BasicParser<Ghoti::Wave::Parser::RESPONSE, Ghoti::Wave::ClientParserParameters>;
@@ -5,71 +5,27 @@
  */
 
 #include <arpa/inet.h>
-#include <ghoti.io/pool.hpp>
 #include <iostream>
+#include <limits>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sstream>
+#include <unistd.h>
 #include "wave/server.hpp"
+#include "wave/serverReactor.hpp"
 #include "wave/serverSession.hpp"
 
 using namespace std;
-using namespace Ghoti::Pool;
 using namespace Ghoti::Wave;
 
 
-void Server::dispatchLoop(stop_token stopToken) {
-  // Create the worker pool queue.
-  Pool::Pool pool{1};
-  pool.start();
-
-  while (!stopToken.stop_requested()) {
-    // Poll existing connections
-    for (auto it = this->sessions.begin(); it != this->sessions.end();) {
-      auto session = it->second;
-
-      // Service existing requests.
-      if (session->hasReadDataWaiting()) {
-        pool.enqueue({[=](){
-          session->read();
-        }});
-      }
-      else if (session->hasWriteDataWaiting()) {
-        pool.enqueue({[=](){
-          session->write();
-        }});
-      }
-
-      // Remove any requests that are dead.
-      if (session->isFinished()) {
-        it = this->sessions.erase(it);
-      }
-      else {
-        ++it;
-      }
-    }
-
-    // Service new requests.
-    sockaddr_in client;
-    socklen_t clientLength = sizeof(client);
-    int hClient = accept4(this->hSocket, (sockaddr *)&client, &clientLength, SOCK_NONBLOCK);
-    if (hClient < 0) {
-      this_thread::sleep_for(1ms);
-    }
-    else {
-      auto ss{make_shared<ServerSession>(hClient, this)};
-      ss->setInheritFrom(this);
-      this->sessions.emplace(hClient, ss);
-    }
-  }
-
-  // TODO: Make session cleanup more elegant.
-  this->sessions.clear();
-
-  // Stop and join the worker threads.
-  pool.join();
-}
-
-Server::Server() : errorCode{ErrorCode::NO_ERROR}, errorMessage{}, running{false}, hSocket{0}, address{"127.0.0.1"}, port{0} {}
+Server::Server() : reactors{}, errorCode{ErrorCode::NO_ERROR}, errorMessage{}, running{false}, address{"127.0.0.1"}, port{0}, handler{[](auto, auto response) {
+  response->getMessage()
+    .setStatusCode(200)
+    .setMessageBody({"Hello World!"});
+  response->complete();
+}} {}
 
 Server::~Server() {
   this->stop();
@@ -123,8 +79,23 @@ const string & Server::getAddress() const {
   return this->address;
 }
 
+Server & Server::setHandler(Handler && handler) {
+  if (this->running) {
+    this->errorCode = ErrorCode::SERVER_ALREADY_RUNNING;
+    this->errorMessage = "Could not set handler of server because it is already running.";
+  }
+  else {
+    this->handler = move(handler);
+  }
+  return *this;
+}
+
+const Server::Handler & Server::getHandler() const {
+  return this->handler;
+}
+
 int Server::getSocketHandle() const {
-  return this->hSocket;
+  return this->reactors.size() ? this->reactors.front()->getSocketHandle() : 0;
 }
 
 Server& Server::start() {
@@ -148,48 +119,88 @@ Server& Server::start() {
   inet_ntop(AF_INET, &(server_address.sin_addr), processed_address, INET_ADDRSTRLEN);
   this->address = processed_address;
 
-  // Create the socket.
-  if ((this->hSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0) {
-    this->errorCode = ErrorCode::START_FAILED;
-    this->errorMessage = "Failed to create a TCP socket";
-    return *this;
+  // Determine how many reactors to run.
+  auto reactorCount = *this->getParameter<uint32_t>(ServerParameter::REACTORCOUNT);
+  if (!reactorCount) {
+    reactorCount = max(thread::hardware_concurrency(), 1u);
   }
+  int backlog = min<uint32_t>(*this->getParameter<uint32_t>(ServerParameter::LISTENBACKLOG), numeric_limits<int>::max());
+  int deferAccept = min<uint32_t>(*this->getParameter<uint32_t>(ServerParameter::DEFERACCEPT), numeric_limits<int>::max());
+
+  // Every reactor gets its own listening socket, bound to the same address
+  // and port.  The kernel will distribute new connections among them.
+  for (uint32_t i = 0; i < reactorCount; ++i) {
+    int hSocket;
+
+    // Create the socket.
+    if ((hSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+      this->errorCode = ErrorCode::START_FAILED;
+      this->errorMessage = "Failed to create a TCP socket";
+      this->reactors.clear();
+      return *this;
+    }
 
-  // Set the socket options.
-  int opt = 1;
-  if (setsockopt(this->hSocket, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
-    this->errorCode = ErrorCode::START_FAILED;
-    this->errorMessage = "Filed to set socket options";
-    return *this;
-  }
+    // Set the socket options.  The options must be set individually, because
+    // they are not bit flags.
+    int opt = 1;
+    if ((setsockopt(hSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+      || (setsockopt(hSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)) {
+      close(hSocket);
+      this->errorCode = ErrorCode::START_FAILED;
+      this->errorMessage = "Filed to set socket options";
+      this->reactors.clear();
+      return *this;
+    }
 
-  // Bind to the port.
-  server_address.sin_port = htons(this->port);
-  if (bind(this->hSocket, (sockaddr *)&server_address, addrlen) < 0) {
-    this->errorCode = ErrorCode::START_FAILED;
-    this->errorMessage = "Failed to bind to socket";
-    return *this;
-  }
+    // Do not wake the server for a connection until the client has sent
+    // something.
+    if (deferAccept && (setsockopt(hSocket, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferAccept, sizeof(deferAccept)) < 0)) {
+      close(hSocket);
+      this->errorCode = ErrorCode::START_FAILED;
+      this->errorMessage = "Failed to set TCP_DEFER_ACCEPT";
+      this->reactors.clear();
+      return *this;
+    }
 
-  // Get the socket number that was bound to.
-  if (getsockname(this->hSocket, (sockaddr *)&server_address, &addrlen) < 0) {
-    this->errorCode = ErrorCode::START_FAILED;
-    this->errorMessage = "Could not get the socket number";
-    return *this;
-  }
-  this->port = ntohs(server_address.sin_port);
+    // Bind to the port.  After the first socket, this is the port that the
+    // operating system assigned (if one was not configured).
+    server_address.sin_port = htons(this->port);
+    if (bind(hSocket, (sockaddr *)&server_address, addrlen) < 0) {
+      close(hSocket);
+      this->errorCode = ErrorCode::START_FAILED;
+      this->errorMessage = "Failed to bind to socket";
+      this->reactors.clear();
+      return *this;
+    }
 
-  // Start listening.
-  if (listen(this->hSocket, 10) < 0) {
-    this->errorCode = ErrorCode::START_FAILED;
-    this->errorMessage = "Failed to listen on port " + to_string(port);
-    return *this;
-  }
+    // Get the socket number that was bound to.
+    if (getsockname(hSocket, (sockaddr *)&server_address, &addrlen) < 0) {
+      close(hSocket);
+      this->errorCode = ErrorCode::START_FAILED;
+      this->errorMessage = "Could not get the socket number";
+      this->reactors.clear();
+      return *this;
+    }
+    this->port = ntohs(server_address.sin_port);
+
+    // Start listening.
+    if (listen(hSocket, backlog) < 0) {
+      close(hSocket);
+      this->errorCode = ErrorCode::START_FAILED;
+      this->errorMessage = "Failed to listen on port " + to_string(port);
+      this->reactors.clear();
+      return *this;
+    }
 
-  // Start the dispatch thread.
-  this->dispatchThread = jthread{[&] (stop_token stoken) {
-    this->dispatchLoop(stoken);
-  }};
+    // Start the reactor, which takes ownership of the socket.
+    auto & reactor = this->reactors.emplace_back(make_unique<ServerReactor>(this));
+    if (!reactor->start(hSocket)) {
+      this->errorCode = ErrorCode::START_FAILED;
+      this->errorMessage = reactor->getErrorMessage();
+      this->reactors.clear();
+      return *this;
+    }
+  }
 
   this->running = true;
 
@@ -197,16 +208,9 @@ Server& Server::start() {
 }
 
 Server& Server::stop() {
-  // Stop the dispatch thread.
-  if (this->dispatchThread.joinable()) {
-    this->dispatchThread.request_stop();
-    this->dispatchThread.join();
-    this->running = false;
-  }
-  if (this->hSocket) {
-    close(this->hSocket);
-    this->hSocket = 0;
-  }
+  // Stop the reactors, closing their sessions and listening sockets.
+  this->reactors.clear();
+  this->running = false;
   return *this;
 }
 
@@ -214,6 +218,18 @@ Ghoti::Util::ErrorOr<any> Server::getParameterDefault(const ServerParameter & p)
   static unordered_map<ServerParameter, any> defaults{
     {ServerParameter::MAXBUFFERSIZE, {uint32_t{4096}}},
     {ServerParameter::MEMCHUNKSIZELIMIT, {uint32_t{1024 * 1024}}},
+    {ServerParameter::IOBACKEND, {ServerIOBackend::EPOLL}},
+    {ServerParameter::REACTORCOUNT, {uint32_t{1}}},
+    {ServerParameter::MINWORKERS, {uint32_t{1}}},
+    {ServerParameter::MAXWORKERS, {uint32_t{0}}},
+    {ServerParameter::MAXHANDLERS, {uint32_t{0}}},
+    {ServerParameter::LISTENBACKLOG, {uint32_t{SOMAXCONN}}},
+    {ServerParameter::DEFERACCEPT, {uint32_t{0}}},
+    {ServerParameter::STREAMBODIES, {false}},
+    {ServerParameter::LAZYFIELDS, {false}},
+    {ServerParameter::PRESERVECHUNKS, {false}},
+    {ServerParameter::SPILLDIRECTORY, {string{}}},
+    {ServerParameter::MAXLINELENGTH, {uint32_t{8192}}},
   };
   if (defaults.contains(p)) {
     return defaults[p];
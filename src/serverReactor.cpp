@@ -0,0 +1,906 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::ServerReactor class.
+ */
+
+#include <arpa/inet.h>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include "wave/ioUring.hpp"
+#include "wave/server.hpp"
+#include "wave/serverReactor.hpp"
+#include "wave/serverSession.hpp"
+#include "wave/workerPool.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+/**
+ * The maximum number of readiness events to collect in a single call to
+ * `epoll_wait()`.
+ */
+#define MAX_EPOLL_EVENTS 256
+
+/**
+ * The number of handler threads per hardware thread that each reactor may
+ * grow to, if ServerParameter::MAXHANDLERS is 0.
+ */
+#define HANDLERS_PER_HARDWARE_THREAD 8
+
+/**
+ * The number of submission queue entries requested for the io_uring instance.
+ */
+#define URING_ENTRIES 4096
+
+/**
+ * The number of receive buffers provided to io_uring.  Must be a power of 2.
+ */
+#define URING_BUFFER_COUNT 1024
+
+/**
+ * The buffer group id used for the provided receive buffers.
+ */
+#define URING_BUFFER_GROUP 0
+
+/**
+ * The maximum number of sends that will be linked together for a single
+ * connection.
+ */
+#define URING_MAX_LINKED_SENDS 16
+
+/**
+ * Build the io_uring user data value from an operation and a file handle.
+ */
+#define URING_USER_DATA(operation, fd) ((uint64_t{operation} << 32) | static_cast<uint32_t>(fd))
+
+/**
+ * The operations tracked through the io_uring user data.
+ *
+ * Helper enum only for use in the Ghoti::Wave::Server object file.
+ */
+enum UringOperation : uint32_t {
+  URING_ACCEPT,   ///< A multishot accept on the listening socket.
+  URING_RECEIVE,  ///< A multishot receive on a session socket.
+  URING_SEND,     ///< A send on a session socket.
+  URING_WAKE,     ///< A multishot poll on the wake eventfd.
+  URING_WRITABLE, ///< A poll for a session socket to become writable.
+};
+
+/**
+ * Helper struct tracking the io_uring state of a single connection.
+ *
+ * Helper struct only for use in the Ghoti::Wave::Server object file.
+ */
+struct UringConnection {
+  /**
+   * Segments waiting to be sent, with the number of bytes already sent.
+   */
+  deque<pair<OutputSegment, size_t>> output;
+
+  /**
+   * The file segment at the front of the output, which has been taken out of
+   * `output` to be sent by a worker.  The worker's job shares it, so that it
+   * remains valid even if the connection is removed first.
+   */
+  shared_ptr<OutputSegment> fileSegment;
+
+  /**
+   * The number of bytes of `fileSegment` already sent.
+   */
+  size_t fileOffset;
+
+  /**
+   * The number of send (or writability poll) operations that have not yet
+   * completed.
+   */
+  uint32_t sendsInFlight;
+
+  /**
+   * Whether or not a multishot receive is armed.
+   */
+  bool receiving;
+
+  /**
+   * Whether or not the session has finished and the connection should be
+   * removed once all operations have completed.
+   */
+  bool closing;
+
+  /**
+   * Whether or not a send has failed.
+   */
+  bool failed;
+};
+
+/**
+ * Helper struct holding a completion which was taken out of the io_uring
+ * completion queue before it could be handled.
+ *
+ * Helper struct only for use in the Ghoti::Wave::Server object file.
+ */
+struct UringCompletion {
+  /**
+   * The user data of the operation.
+   */
+  uint64_t userData;
+
+  /**
+   * The result of the operation.
+   */
+  int32_t result;
+
+  /**
+   * The completion flags.
+   */
+  uint32_t flags;
+};
+
+void ServerReactor::dispatchLoop(stop_token stopToken) {
+  // Create the worker pool queue.
+  auto maxWorkers = *this->server->getParameter<uint32_t>(ServerParameter::MAXWORKERS);
+  WorkerPool pool{
+    *this->server->getParameter<uint32_t>(ServerParameter::MINWORKERS),
+    maxWorkers ? maxWorkers : thread::hardware_concurrency()};
+  pool.start();
+
+  // Create the handler pool.  Handlers may block, so they are kept apart
+  // from the socket I/O, and the pool may grow larger than the worker pool.
+  // It is still bounded, so that a burst of slow requests cannot start one
+  // thread per request.
+  auto maxHandlers = *this->server->getParameter<uint32_t>(ServerParameter::MAXHANDLERS);
+  WorkerPool handlers{1, maxHandlers ? maxHandlers : HANDLERS_PER_HARDWARE_THREAD * max(thread::hardware_concurrency(), 1u)};
+  handlers.start();
+
+  // A stop request must interrupt a blocking wait.
+  stop_callback stopCallback{stopToken, [this]() {
+    this->wake();
+  }};
+
+  auto backend = this->server->getParameter<ServerIOBackend>(ServerParameter::IOBACKEND);
+  if (!backend || (*backend != ServerIOBackend::IO_URING) || !this->dispatchIoUring(stopToken, pool, handlers)) {
+    this->dispatchEpoll(stopToken, pool, handlers);
+  }
+
+  // TODO: Make session cleanup more elegant.
+  this->sessions.clear();
+
+  // Stop and join the worker threads, then the handler threads, because the
+  // workers may still be queuing handlers.
+  pool.join();
+  handlers.join();
+}
+
+void ServerReactor::dispatchEpoll(stop_token stopToken, WorkerPool & pool, WorkerPool & handlers) {
+  array<epoll_event, MAX_EPOLL_EVENTS> events;
+
+  // Read from the socket, pass the requests to the handler, and write any
+  // responses.  Reading may produce responses, and the socket will not report
+  // a new EPOLLOUT edge for them if it is already writable, so the write is
+  // attempted immediately.
+  auto service = [&, this](int fd, shared_ptr<ServerSession> session) {
+    pool.enqueue({[=, this, &handlers](){
+      do {
+        session->read();
+        this->dispatchRequests(handlers, *session);
+      } while (session->hasDeferredInput());
+      session->write();
+      if (session->isFinished()) {
+        this->retireSession(fd);
+      }
+    }});
+  };
+
+  while (!stopToken.stop_requested()) {
+    int eventCount = epoll_wait(this->hEpoll, events.data(), events.size(), -1);
+    if (eventCount < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      cerr << "epoll_wait failed: " << strerror(errno) << endl;
+      break;
+    }
+
+    for (int i = 0; i < eventCount; ++i) {
+      auto & event = events[i];
+      int fd = event.data.fd;
+
+      // Service new requests.
+      if (fd == this->hSocket) {
+        this->acceptConnections();
+        continue;
+      }
+
+      // Clean up finished sessions, and write completed responses.
+      if (fd == this->hWake) {
+        uint64_t counter;
+        [[maybe_unused]] auto result = ::read(this->hWake, &counter, sizeof(counter));
+        this->reapSessions();
+        for (auto hClient : this->takeReadySessions()) {
+          auto it = this->sessions.find(hClient);
+          if (it == this->sessions.end()) {
+            continue;
+          }
+          pool.enqueue({[=, this, session = it->second](){
+            session->write();
+            if (session->isFinished()) {
+              this->retireSession(hClient);
+            }
+          }});
+        }
+        for (auto hClient : this->takeResumedSessions()) {
+          auto it = this->sessions.find(hClient);
+          if (it != this->sessions.end()) {
+            service(hClient, it->second);
+          }
+        }
+        continue;
+      }
+
+      // Service existing requests.
+      auto it = this->sessions.find(fd);
+      if (it == this->sessions.end()) {
+        continue;
+      }
+      auto session = it->second;
+      if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        service(fd, session);
+      }
+      else if (event.events & EPOLLOUT) {
+        // The edge is not repeated, so the write is always attempted, even
+        // if the session is busy.  A write with nothing queued does nothing.
+        pool.enqueue({[=, this](){
+          session->write();
+          if (session->isFinished()) {
+            this->retireSession(fd);
+          }
+        }});
+      }
+    }
+  }
+}
+
+bool ServerReactor::dispatchIoUring(stop_token stopToken, WorkerPool & pool, WorkerPool & handlers) {
+  IoUring ring{};
+  auto maxBufferSize = *this->server->getParameter<uint32_t>(ServerParameter::MAXBUFFERSIZE);
+  error_code ec{};
+  if ((ec = IoUring::probe()) || (ec = ring.init(URING_ENTRIES)) || (ec = ring.registerBufferRing(URING_BUFFER_GROUP, URING_BUFFER_COUNT, maxBufferSize))) {
+    cerr << "io_uring is unavailable, falling back to epoll: " << ec.message() << endl;
+    return false;
+  }
+
+  map<int, UringConnection> connections;
+
+  // The kernel refuses submissions (with EAGAIN or EBUSY) while it has no
+  // room for their completions, so completions may have to be taken out of
+  // the ring before they can be handled.  They are handled first.
+  deque<UringCompletion> reaped;
+  auto nextCompletion = [&](UringCompletion & completion) {
+    if (reaped.size()) {
+      completion = reaped.front();
+      reaped.pop_front();
+      return true;
+    }
+    auto cqe = ring.peekCompletion();
+    if (!cqe) {
+      return false;
+    }
+    completion = {cqe->user_data, cqe->res, cqe->flags};
+    ring.advanceCompletion();
+    return true;
+  };
+
+  // Submit the queued operations, making room for completions as needed.
+  // Only waits if there are no completions already waiting to be handled.
+  // Any other error is kept in ringError, which ends the dispatch loop.
+  error_code ringError{};
+  auto submit = [&](uint32_t waitFor) {
+    while (!ringError) {
+      auto error = ring.submit(reaped.empty() ? waitFor : 0);
+      if ((error != errc::resource_unavailable_try_again) && (error != errc::device_or_resource_busy)) {
+        ringError = error;
+        break;
+      }
+      size_t count = reaped.size();
+      while (auto cqe = ring.peekCompletion()) {
+        reaped.push_back({cqe->user_data, cqe->res, cqe->flags});
+        ring.advanceCompletion();
+      }
+      if (reaped.size() == count) {
+        // There was nothing to reap, so the kernel is short of memory.
+        this_thread::yield();
+      }
+    }
+    return !ringError;
+  };
+
+  // Queue an operation, flushing the submission queue if it is full.
+  auto prepare = [&](auto && queueOperation) {
+    while (!queueOperation() && submit(0)) {}
+  };
+
+  // Parse received input on a worker thread, and pass the requests to the
+  // handler.  Completed responses are collected by this thread to be sent.
+  auto schedule = [&, this](int fd, shared_ptr<ServerSession> session) {
+    pool.enqueue({[=, this, &handlers](){
+      do {
+        session->processInput();
+        this->dispatchRequests(handlers, *session);
+      } while (!session->releaseInput());
+      if (session->isFinished()) {
+        this->retireSession(fd);
+      }
+    }});
+  };
+
+  // Abandon the output of a connection whose socket can no longer be written.
+  auto fail = [&, this](int fd, UringConnection & connection) {
+    connection.failed = true;
+    connection.output.clear();
+    connection.fileSegment.reset();
+    auto session = this->sessions.find(fd);
+    if ((session != this->sessions.end()) && session->second->closeInput()) {
+      schedule(fd, session->second);
+    }
+  };
+
+  // Send as many queued segments as possible as a single linked chain.  Only
+  // one chain is in flight per connection, so that a short send can be
+  // resumed without reordering the stream.
+  auto flush = [&](int fd, UringConnection & connection) {
+    if (connection.sendsInFlight || connection.failed) {
+      return;
+    }
+
+    // io_uring has no sendfile operation, so a file segment is sent by a
+    // worker with sendfile() on the non-blocking socket, which reports its
+    // progress back to this thread.  The segment is shared with the job, and
+    // the connection stays in the map until then, because the send counts as
+    // in flight.
+    if (!connection.fileSegment && connection.output.size() && connection.output.front().first.isFile()) {
+      auto & [segment, offset] = connection.output.front();
+      connection.fileSegment = make_shared<OutputSegment>(move(segment));
+      connection.fileOffset = offset;
+      connection.output.pop_front();
+    }
+    if (connection.fileSegment) {
+      pool.enqueue({[=, this, segment = connection.fileSegment, offset = connection.fileOffset](){
+        size_t bytesSent{0};
+        int error{0};
+        while (offset + bytesSent < segment->length()) {
+          auto bytesWritten = segment->sendTo(fd, offset + bytesSent);
+          if (bytesWritten > 0) {
+            bytesSent += bytesWritten;
+          }
+          else if ((bytesWritten < 0) && (errno == EINTR)) {
+            continue;
+          }
+          else {
+            // The file may have been truncated.
+            error = bytesWritten < 0 ? errno : EIO;
+            break;
+          }
+        }
+        this->fileSent({fd, bytesSent, error});
+      }});
+      connection.sendsInFlight = 1;
+      return;
+    }
+
+    uint32_t count{0};
+    while ((count < connection.output.size()) && (count < URING_MAX_LINKED_SENDS) && !connection.output[count].first.isFile()) {
+      ++count;
+    }
+    if (!count) {
+      return;
+    }
+    if ((ring.getFreeSubmissionCount() < count) && !submit(0)) {
+      // A chain must not be split across submissions.
+      return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      auto & [segment, offset] = connection.output[i];
+      string_view view{segment.getText()};
+      uint32_t length = min<size_t>(view.length() - offset, numeric_limits<int32_t>::max());
+      ring.prepareSend(fd, view.data() + offset, length, URING_USER_DATA(URING_SEND, fd), i + 1 < count);
+    }
+    connection.sendsInFlight = count;
+  };
+
+  // Remove a connection once its session has finished and nothing else
+  // refers to its socket or buffers.
+  auto tryRemove = [&, this](int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) {
+      return;
+    }
+    auto & connection = it->second;
+    if (connection.closing && !connection.receiving && !connection.sendsInFlight && ((connection.output.empty() && !connection.fileSegment) || connection.failed)) {
+      connections.erase(it);
+      this->sessions.erase(fd);
+    }
+  };
+
+  prepare([&](){
+    return ring.prepareAcceptMultishot(this->hSocket, URING_USER_DATA(URING_ACCEPT, this->hSocket));
+  });
+  prepare([&](){
+    return ring.preparePollMultishot(this->hWake, URING_USER_DATA(URING_WAKE, this->hWake));
+  });
+
+  UringCompletion completion;
+  while (!stopToken.stop_requested() && submit(1)) {
+    while (nextCompletion(completion)) {
+      UringOperation operation = static_cast<UringOperation>(completion.userData >> 32);
+      int fd = static_cast<int>(completion.userData & 0xFFFFFFFF);
+      int result = completion.result;
+      uint32_t flags = completion.flags;
+      bool more = flags & IORING_CQE_F_MORE;
+
+      switch (operation) {
+        case URING_ACCEPT: {
+          // Service new requests.
+          if (result >= 0) {
+            auto ss{make_shared<ServerSession>(result, this->server, this->bufferPool, this->messagePool, this->makeResponseReadyCallback(result), this->makeInputResumedCallback(result))};
+            ss->setInheritFrom(this->server);
+            this->sessions.emplace(result, ss);
+            connections[result] = {};
+            prepare([&](){
+              return ring.prepareReceiveMultishot(result, URING_USER_DATA(URING_RECEIVE, result));
+            });
+            connections[result].receiving = true;
+          }
+          if (!more) {
+            prepare([&](){
+              return ring.prepareAcceptMultishot(this->hSocket, URING_USER_DATA(URING_ACCEPT, this->hSocket));
+            });
+          }
+          break;
+        }
+        case URING_WAKE: {
+          // Reset the eventfd.  The queued work is handled below.
+          uint64_t counter;
+          [[maybe_unused]] auto bytesRead = ::read(this->hWake, &counter, sizeof(counter));
+          if (!more) {
+            prepare([&](){
+              return ring.preparePollMultishot(this->hWake, URING_USER_DATA(URING_WAKE, this->hWake));
+            });
+          }
+          break;
+        }
+        case URING_RECEIVE: {
+          auto connection = connections.find(fd);
+          auto session = this->sessions.find(fd);
+          if (flags & IORING_CQE_F_BUFFER) {
+            // Copy the data once, into the reference-counted block which the
+            // parser adopts as its input, so that the buffer can be returned
+            // to the kernel immediately.  The parsed messages refer to the
+            // block, so it must outlive the provided buffer.
+            uint16_t bufferId = flags >> IORING_CQE_BUFFER_SHIFT;
+            if ((result > 0) && (session != this->sessions.end())) {
+              if (session->second->pushInput(shared_string_view{string(ring.getBuffer(bufferId), result)})) {
+                schedule(fd, session->second);
+              }
+            }
+            ring.recycleBuffer(bufferId);
+          }
+          if (!more && (connection != connections.end())) {
+            connection->second.receiving = false;
+            if (((result > 0) || (result == -ENOBUFS)) && !connection->second.closing) {
+              // The receive stopped without the connection closing (e.g., the
+              // buffers ran out), so re-arm it.
+              prepare([&](){
+                return ring.prepareReceiveMultishot(fd, URING_USER_DATA(URING_RECEIVE, fd));
+              });
+              connection->second.receiving = true;
+            }
+          }
+          if (((result == 0) || ((result < 0) && (result != -ENOBUFS))) && (session != this->sessions.end())) {
+            // There was an orderly shutdown, or an error.
+            if (session->second->closeInput()) {
+              schedule(fd, session->second);
+            }
+          }
+          tryRemove(fd);
+          break;
+        }
+        case URING_SEND: {
+          auto it = connections.find(fd);
+          if (it == connections.end()) {
+            break;
+          }
+          auto & connection = it->second;
+          --connection.sendsInFlight;
+          // An empty segment completes with a result of 0.
+          if ((result >= 0) && !connection.failed) {
+            auto & [segment, offset] = connection.output.front();
+            offset += result;
+            if (offset == segment.length()) {
+              connection.output.pop_front();
+            }
+          }
+          else if (result != -ECANCELED) {
+            // The send failed.  A cancellation only means that an earlier
+            // send in the chain was short, and will be retried.
+            fail(fd, connection);
+          }
+          if (!connection.sendsInFlight) {
+            flush(fd, connection);
+            tryRemove(fd);
+          }
+          break;
+        }
+        case URING_WRITABLE: {
+          auto it = connections.find(fd);
+          if (it == connections.end()) {
+            break;
+          }
+          auto & connection = it->second;
+          --connection.sendsInFlight;
+          if ((result < 0) && !connection.failed) {
+            fail(fd, connection);
+          }
+          flush(fd, connection);
+          tryRemove(fd);
+          break;
+        }
+      }
+    }
+
+    // Continue the file segments whose sends were completed by a worker.
+    for (auto & progress : this->takeSentFiles()) {
+      auto it = connections.find(progress.hClient);
+      if (it == connections.end()) {
+        continue;
+      }
+      auto & connection = it->second;
+      connection.sendsInFlight = 0;
+      if (!connection.failed) {
+        connection.fileOffset += progress.bytesSent;
+        if (connection.fileOffset == connection.fileSegment->length()) {
+          connection.fileSegment.reset();
+        }
+        else if ((progress.error == EAGAIN) || (progress.error == EWOULDBLOCK)) {
+          // Wait for the socket to become writable.
+          prepare([&](){
+            return ring.preparePollWritable(progress.hClient, URING_USER_DATA(URING_WRITABLE, progress.hClient));
+          });
+          connection.sendsInFlight = 1;
+          continue;
+        }
+        else {
+          fail(progress.hClient, connection);
+        }
+      }
+      flush(progress.hClient, connection);
+      tryRemove(progress.hClient);
+    }
+
+    // Queue the responses completed by the handlers.
+    for (auto fd : this->takeReadySessions()) {
+      auto it = connections.find(fd);
+      auto session = this->sessions.find(fd);
+      if ((it == connections.end()) || (session == this->sessions.end())) {
+        continue;
+      }
+      for (auto & segment : session->second->collectOutput()) {
+        it->second.output.emplace_back(move(segment), 0);
+      }
+      flush(fd, it->second);
+    }
+
+    // Continue parsing the input of sessions whose handlers resumed a paused
+    // request body.
+    for (auto fd : this->takeResumedSessions()) {
+      auto session = this->sessions.find(fd);
+      if ((session != this->sessions.end()) && session->second->resumeInput()) {
+        schedule(fd, session->second);
+      }
+    }
+
+    // Remove finished sessions.
+    vector<int> retired;
+    {
+      scoped_lock lock{this->retiredMutex};
+      swap(retired, this->retiredSessions);
+    }
+    for (auto fd : retired) {
+      auto it = connections.find(fd);
+      if (it == connections.end()) {
+        continue;
+      }
+      it->second.closing = true;
+      if (it->second.receiving) {
+        // End the multishot receive.
+        shutdown(fd, SHUT_RD);
+      }
+      tryRemove(fd);
+    }
+  }
+
+  // Shut down every connection so that all outstanding operations complete,
+  // then wait for them so that neither the kernel nor a worker references any
+  // buffers or sockets.  A worker reports the end of a file send through the
+  // wake eventfd, so its poll must stay armed.
+  for (auto & [fd, connection] : connections) {
+    shutdown(fd, SHUT_RDWR);
+  }
+  auto outstanding = [&]() {
+    for (auto & progress : this->takeSentFiles()) {
+      auto it = connections.find(progress.hClient);
+      if (it != connections.end()) {
+        it->second.sendsInFlight = 0;
+      }
+    }
+    for (auto & [fd, connection] : connections) {
+      if (connection.receiving || connection.sendsInFlight) {
+        return true;
+      }
+    }
+    return false;
+  };
+  if (ringError) {
+    this->errorMessage = "io_uring_enter failed: " + ringError.message();
+  }
+  while (outstanding() && submit(1)) {
+    while (nextCompletion(completion)) {
+      UringOperation operation = static_cast<UringOperation>(completion.userData >> 32);
+      int fd = static_cast<int>(completion.userData & 0xFFFFFFFF);
+      bool more = completion.flags & IORING_CQE_F_MORE;
+      if (operation == URING_WAKE) {
+        uint64_t counter;
+        [[maybe_unused]] auto bytesRead = ::read(this->hWake, &counter, sizeof(counter));
+        if (!more) {
+          prepare([&](){
+            return ring.preparePollMultishot(this->hWake, URING_USER_DATA(URING_WAKE, this->hWake));
+          });
+        }
+        continue;
+      }
+      auto it = connections.find(fd);
+      if (it == connections.end()) {
+        continue;
+      }
+      if ((operation == URING_RECEIVE) && !more) {
+        it->second.receiving = false;
+      }
+      else if ((operation == URING_SEND) || (operation == URING_WRITABLE)) {
+        --it->second.sendsInFlight;
+      }
+    }
+  }
+  return true;
+}
+
+void ServerReactor::dispatchRequests(WorkerPool & handlers, ServerSession & session) {
+  // Each request is handled by its own job on the handler pool, so that a
+  // slow handler delays neither the socket I/O nor the other requests.
+  for (auto & [request, response] : session.takeRequests()) {
+    handlers.enqueue({[this, request, response](){
+      try {
+        this->server->getHandler()(request, response);
+      }
+      catch (...) {
+        // Do not leave the client waiting for a response that will never
+        // be completed.
+        if (!response->isComplete()) {
+          response->getMessage()
+            .setStatusCode(500)
+            .setMessageBody(Blob{});
+          response->complete();
+        }
+      }
+    }});
+  }
+}
+
+function<void()> ServerReactor::makeResponseReadyCallback(int hClient) {
+  return [sink = this->completionSink, hClient]() {
+    scoped_lock lock{sink->mutex};
+    if (sink->reactor) {
+      sink->reactor->responseReady(hClient);
+    }
+  };
+}
+
+void ServerReactor::responseReady(int hClient) {
+  {
+    scoped_lock lock{this->readyMutex};
+    this->readySessions.push_back(hClient);
+  }
+  this->wake();
+}
+
+vector<int> ServerReactor::takeReadySessions() {
+  scoped_lock lock{this->readyMutex};
+  return exchange(this->readySessions, {});
+}
+
+function<void()> ServerReactor::makeInputResumedCallback(int hClient) {
+  return [sink = this->completionSink, hClient]() {
+    scoped_lock lock{sink->mutex};
+    if (sink->reactor) {
+      sink->reactor->inputResumed(hClient);
+    }
+  };
+}
+
+void ServerReactor::inputResumed(int hClient) {
+  {
+    scoped_lock lock{this->readyMutex};
+    this->resumedSessions.push_back(hClient);
+  }
+  this->wake();
+}
+
+vector<int> ServerReactor::takeResumedSessions() {
+  scoped_lock lock{this->readyMutex};
+  return exchange(this->resumedSessions, {});
+}
+
+void ServerReactor::fileSent(FileProgress progress) {
+  {
+    scoped_lock lock{this->readyMutex};
+    this->sentFiles.push_back(progress);
+  }
+  this->wake();
+}
+
+vector<ServerReactor::FileProgress> ServerReactor::takeSentFiles() {
+  scoped_lock lock{this->readyMutex};
+  return exchange(this->sentFiles, {});
+}
+
+void ServerReactor::acceptConnections() {
+  while (1) {
+    sockaddr_in client;
+    socklen_t clientLength = sizeof(client);
+    int hClient = accept4(this->hSocket, (sockaddr *)&client, &clientLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (hClient < 0) {
+      if ((errno == EINTR) || (errno == ECONNABORTED)) {
+        continue;
+      }
+      // EAGAIN/EWOULDBLOCK means that the queue has been drained.  Anything
+      // else (e.g., EMFILE) cannot be resolved here.
+      break;
+    }
+
+    auto ss{make_shared<ServerSession>(hClient, this->server, this->bufferPool, this->messagePool, this->makeResponseReadyCallback(hClient), this->makeInputResumedCallback(hClient))};
+    ss->setInheritFrom(this->server);
+
+    // Watch the socket for both reading and writing.  The registration is
+    // edge-triggered, so the session is only reported when its state changes.
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = hClient;
+    if (epoll_ctl(this->hEpoll, EPOLL_CTL_ADD, hClient, &event) < 0) {
+      // The session destructor will close the socket.
+      continue;
+    }
+    this->sessions.emplace(hClient, ss);
+  }
+}
+
+void ServerReactor::retireSession(int hClient) {
+  {
+    scoped_lock lock{this->retiredMutex};
+    this->retiredSessions.push_back(hClient);
+  }
+  this->wake();
+}
+
+void ServerReactor::reapSessions() {
+  vector<int> retired;
+  {
+    scoped_lock lock{this->retiredMutex};
+    swap(retired, this->retiredSessions);
+  }
+  for (auto hClient : retired) {
+    // A session keeps its socket open until it is destroyed, so the handle
+    // cannot have been reused by a newer session unless this session has
+    // already been removed.  Verify before erasing.
+    auto it = this->sessions.find(hClient);
+    if ((it != this->sessions.end()) && it->second->isFinished()) {
+      epoll_ctl(this->hEpoll, EPOLL_CTL_DEL, hClient, nullptr);
+      this->sessions.erase(it);
+    }
+  }
+}
+
+void ServerReactor::wake() {
+  if (this->hWake) {
+    uint64_t one{1};
+    [[maybe_unused]] auto result = ::write(this->hWake, &one, sizeof(one));
+  }
+}
+
+ServerReactor::ServerReactor(Server * server) : server{server}, completionSink{make_shared<CompletionSink>()}, bufferPool{}, messagePool{}, hSocket{0}, hEpoll{0}, hWake{0}, errorMessage{} {
+  this->completionSink->reactor = this;
+}
+
+ServerReactor::~ServerReactor() {
+  this->stop();
+}
+
+bool ServerReactor::start(int hSocket) {
+  this->hSocket = hSocket;
+  this->bufferPool = make_shared<BufferPool>(*this->server->getParameter<uint32_t>(ServerParameter::MAXBUFFERSIZE));
+  this->messagePool = make_shared<MessagePool>();
+
+  // Create the epoll instance, which will monitor the listening socket and
+  // all of the session sockets.
+  if ((this->hEpoll = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    this->hEpoll = 0;
+    this->errorMessage = "Failed to create the epoll instance";
+    return false;
+  }
+  if ((this->hWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+    this->hWake = 0;
+    this->errorMessage = "Failed to create the wake eventfd";
+    return false;
+  }
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = this->hSocket;
+  if (epoll_ctl(this->hEpoll, EPOLL_CTL_ADD, this->hSocket, &event) < 0) {
+    this->errorMessage = "Failed to register the listening socket with epoll";
+    return false;
+  }
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = this->hWake;
+  if (epoll_ctl(this->hEpoll, EPOLL_CTL_ADD, this->hWake, &event) < 0) {
+    this->errorMessage = "Failed to register the wake eventfd with epoll";
+    return false;
+  }
+
+  // Start the dispatch thread.
+  this->dispatchThread = jthread{[&] (stop_token stoken) {
+    this->dispatchLoop(stoken);
+  }};
+
+  return true;
+}
+
+void ServerReactor::stop() {
+  // Stop the dispatch thread.
+  if (this->dispatchThread.joinable()) {
+    this->dispatchThread.request_stop();
+    this->dispatchThread.join();
+  }
+
+  // Responses completed from now on have nowhere to go.
+  {
+    scoped_lock lock{this->completionSink->mutex};
+    this->completionSink->reactor = nullptr;
+  }
+  if (this->hSocket) {
+    close(this->hSocket);
+    this->hSocket = 0;
+  }
+  if (this->hEpoll) {
+    close(this->hEpoll);
+    this->hEpoll = 0;
+  }
+  if (this->hWake) {
+    close(this->hWake);
+    this->hWake = 0;
+  }
+}
+
+int ServerReactor::getSocketHandle() const {
+  return this->hSocket;
+}
+
+const string & ServerReactor::getErrorMessage() const {
+  return this->errorMessage;
+}
+
@@ -11,6 +11,7 @@
 #include <set>
 #include <string.h>
 #include <unistd.h>
+#include <utility>
 #include <arpa/inet.h>
 #include <ghoti.io/pool.hpp>
 #include <sys/socket.h>
@@ -19,6 +20,7 @@
 #include "wave/serverSession.hpp"
 
 using namespace std;
+using namespace Ghoti;
 using namespace Ghoti::Pool;
 using namespace Ghoti::Wave;
 
@@ -26,23 +28,45 @@ namespace Ghoti::Wave {
   class Server;
 }
 
-ServerSession::ServerSession(int hClient, Server * server) :
+ServerSession::ServerSession(int hClient, Server * server, shared_ptr<BufferPool> bufferPool, shared_ptr<MessagePool> messagePool, function<void()> onResponseReady, function<void()> onInputResumed) :
   controlMutex{make_unique<mutex>()},
   hClient{hClient},
   requestSequence{0},
-  writeOffset{0},
   chunkOffset{0},
   working{false},
   finished{false},
   parser{},
   server{server},
+  bufferPool{bufferPool},
+  messagePool{messagePool},
+  onResponseReady{move(onResponseReady)},
+  onInputResumed{move(onInputResumed)},
+  bodyStream{},
+  inputDeferred{false},
   messages{},
-  pipeline{} {
+  newRequests{},
+  pipeline{},
+  inputMutex{make_unique<mutex>()},
+  pendingInput{},
+  inputScheduled{false},
+  inputClosed{false},
+  inputClosedSeen{false},
+  output{} {
+  this->parser.setInheritFrom(server);
+  this->parser.setStreaming(*server->getParameter<bool>(ServerParameter::STREAMBODIES));
+  this->parser.setLazyFields(*server->getParameter<bool>(ServerParameter::LAZYFIELDS));
+  this->parser.setPreserveChunks(*server->getParameter<bool>(ServerParameter::PRESERVECHUNKS));
+  this->parser.setSpillDirectory(*server->getParameter<string>(ServerParameter::SPILLDIRECTORY));
+  this->parser.setMessagePool(this->messagePool);
   cout << "Open: " << this->hClient << endl;
 }
 
 ServerSession::~ServerSession() {
   cout << "Close: " << this->hClient << endl;
+  if (this->bodyStream) {
+    // The rest of the body will never arrive.
+    this->bodyStream->abort();
+  }
   close(this->hClient);
 }
 
@@ -73,29 +97,13 @@ bool ServerSession::hasWriteDataWaiting() {
   bool dataIsWaiting{false};
 
   if (this->controlMutex->try_lock()) {
-    if (this->pipeline.size()) {
-      auto currentRequest = this->pipeline.front();
-      auto [request, response] = this->messages[currentRequest];
-      switch (response->getTransport()) {
-        case Message::Transport::UNDECLARED: {
-          break;
-        }
-        case Message::Transport::FIXED : {
-          // A fixed message is waiting to be written.
-          dataIsWaiting = true;
-          break;
-        }
-        case Message::Transport::MULTIPART : {
-          break;
-        }
-        case Message::Transport::CHUNKED : {
-          dataIsWaiting = true;
-          break;
-        }
-        case Message::Transport::STREAM : {
-          break;
-        }
-      }
+    if (!this->output.empty()) {
+      // A response has been partially written.
+      dataIsWaiting = true;
+    }
+    else if (this->pipeline.size() && this->messages[this->pipeline.front()].second->isComplete()) {
+      // A response is waiting to be written.
+      dataIsWaiting = true;
     }
     this->controlMutex->unlock();
   }
@@ -110,32 +118,21 @@ bool ServerSession::isFinished() {
 void ServerSession::read() {
   scoped_lock lock{*this->controlMutex};
 
-  while (1) {
-    auto maxBufferSize = *this->getParameter<uint32_t>(ServerParameter::MAXBUFFERSIZE);
-    assert(maxBufferSize);
-
-    vector<char> bufferVector(maxBufferSize);
-    char * buffer{bufferVector.data()};
-    ssize_t byte_count = recv(hClient, buffer, maxBufferSize, 0);
+  // Borrow a buffer only for as long as the socket has data.
+  auto buffer = this->bufferPool->acquire();
+  while (!this->isInputPaused()) {
+    ssize_t byte_count = recv(hClient, buffer.data(), buffer.size(), 0);
     if (byte_count > 0) {
-      this->parser.processBlock(buffer, byte_count);
-
-      // Enqueue the completed messages for processing.
-      while (!this->parser.messages.empty()) {
-        auto temp = this->parser.messages.front();
-        cout << *temp;
-        this->parser.messages.pop();
-        auto response = make_shared<Message>(Message::Type::RESPONSE);
-        response->setStatusCode(200)
-          .setMessageBody({"Hello World!"});
-        this->messages[this->requestSequence] = {temp, response};
-        this->pipeline.push(this->requestSequence);
-        ++this->requestSequence;
+      this->receive(buffer.data(), byte_count);
+      if (this->inputDeferred) {
+        // Let the handler see the request before reading its body.
+        break;
       }
     }
     else if (byte_count == 0) {
       // There was an orderly shutdown.
-      close(this->hClient);
+      // The socket itself is closed by the destructor, so that the handle
+      // cannot be reused while the Server still tracks this session.
       this->finished = true;
       break;
     }
@@ -158,7 +155,6 @@ void ServerSession::read() {
         }
         default: {
           //cout << strerror(errno) << endl;
-          close(this->hClient);
           this->finished = true;
         }
       }
@@ -177,54 +173,158 @@ void ServerSession::read() {
   this->working = false;
 }
 
-void ServerSession::write() {
+bool ServerSession::hasDeferredInput() {
   scoped_lock lock{*this->controlMutex};
+  return exchange(this->inputDeferred, false) && !this->isInputPaused();
+}
 
-  if (this->pipeline.size()) {
-    // Attempt to write out some of the response.
-    auto currentRequest = this->pipeline.front();
-    auto [request, response] = this->messages[currentRequest];
-    switch (response->getTransport()) {
-      case Message::Transport::UNDECLARED: {
-        break;
-      }
-      case Message::Transport::FIXED : {
-        auto assembledMessage = response->getRenderedHeader1() + "Content-Length: " + to_string(response->getContentLength()) + "\r\n\r\n";
-        if (response->getContentLength()) {
-          assembledMessage += response->getMessageBody().getText();
-        }
+bool ServerSession::isInputPaused() const {
+  return this->bodyStream && this->bodyStream->isPaused() && !this->bodyStream->isEnded();
+}
 
-        // Write out as much as possible.
-        auto bytesWritten = ::write(this->hClient, string{assembledMessage}.c_str() + this->writeOffset, assembledMessage.length() - this->writeOffset);
+void ServerSession::receive(const char * buffer, size_t len) {
+  this->parser.processBlock(buffer, len);
+  this->queueParsedRequests();
+}
 
-        // Detect any errors.
-        if (bytesWritten == -1) {
-          cout << "Error writing response: " << strerror(errno) << endl;
-          this->finished = true;
-          close(this->hClient);
-          return;
-        }
+void ServerSession::receive(const shared_string_view & block) {
+  this->parser.processBlock(block);
+  this->queueParsedRequests();
+}
 
-        // Advance the internal pointer.
-        this->writeOffset += bytesWritten;
+void ServerSession::queueParsedRequests() {
+  // Enqueue the completed messages for processing.
+  while (!this->parser.messages.empty()) {
+    auto temp = this->parser.messages.front();
+    this->parser.messages.pop();
+    auto response = make_shared<Response>(function<void()>{this->onResponseReady}, this->messagePool->acquire(Message::Type::RESPONSE));
+    this->messages[this->requestSequence] = {temp, response};
+    this->newRequests.emplace_back(temp, response);
+    this->pipeline.push(this->requestSequence);
+    ++this->requestSequence;
 
-        // If everything has been written, then remove this message from the
-        // pipeline queue.
-        if (this->writeOffset == assembledMessage.length()) {
-          this->removeCompletedMessage();
-        }
-        break;
-      }
-      case Message::Transport::MULTIPART : {
-        break;
-      }
-      case Message::Transport::CHUNKED : {
-        break;
-      }
-      case Message::Transport::STREAM : {
-        break;
+    // The body of a streamed request is still arriving.
+    auto & stream = temp->getBodyStream();
+    if (stream && !stream->isEnded()) {
+      stream->setResumeCallback(function<void()>{this->onInputResumed});
+      this->bodyStream = stream;
+      this->inputDeferred = true;
+    }
+  }
+}
+
+bool ServerSession::pushInput(shared_string_view && block) {
+  scoped_lock lock{*this->inputMutex};
+  this->pendingInput.push_back(move(block));
+  return !exchange(this->inputScheduled, true);
+}
+
+bool ServerSession::closeInput() {
+  scoped_lock lock{*this->inputMutex};
+  this->inputClosed = true;
+  return !exchange(this->inputScheduled, true);
+}
+
+void ServerSession::processInput() {
+  deque<shared_string_view> blocks;
+  bool closed;
+  {
+    scoped_lock lock{*this->inputMutex};
+    swap(blocks, this->pendingInput);
+    closed = this->inputClosedSeen = this->inputClosed;
+  }
+
+  scoped_lock lock{*this->controlMutex};
+  while (blocks.size() && !this->isInputPaused()) {
+    this->receive(blocks.front());
+    blocks.pop_front();
+    if (exchange(this->inputDeferred, false)) {
+      // Let the handler see the request before parsing its body.
+      break;
+    }
+  }
+  if (blocks.size()) {
+    // Keep the unparsed input, ahead of anything received since.
+    scoped_lock inputLock{*this->inputMutex};
+    this->pendingInput.insert(this->pendingInput.begin(), make_move_iterator(blocks.begin()), make_move_iterator(blocks.end()));
+  }
+  else if (closed) {
+    this->finished = true;
+  }
+}
+
+bool ServerSession::releaseInput() {
+  scoped_lock lock{*this->controlMutex, *this->inputMutex};
+  if ((this->pendingInput.size() && !this->isInputPaused()) || (this->inputClosed != this->inputClosedSeen)) {
+    return false;
+  }
+  this->inputScheduled = false;
+  return true;
+}
+
+bool ServerSession::resumeInput() {
+  scoped_lock lock{*this->inputMutex};
+  return !exchange(this->inputScheduled, true);
+}
+
+vector<pair<shared_ptr<Message>, shared_ptr<Response>>> ServerSession::takeRequests() {
+  scoped_lock lock{*this->controlMutex};
+  return exchange(this->newRequests, {});
+}
+
+vector<OutputSegment> ServerSession::collectOutput() {
+  scoped_lock lock{*this->controlMutex};
+  return this->takeOutput();
+}
+
+vector<OutputSegment> ServerSession::takeOutput() {
+  vector<OutputSegment> segments;
+  while (this->pipeline.size()) {
+    auto currentRequest = this->pipeline.front();
+    auto & [request, completion] = this->messages[currentRequest];
+    if (!completion->isComplete()) {
+      // Responses must be sent in order, so wait for the handler.
+      break;
+    }
+    auto * response = &completion->getMessage();
+    if (response->getTransport() == Message::Transport::UNDECLARED) {
+      // The handler did not provide a body.
+      response->setTransport(Message::Transport::FIXED);
+    }
+    if (response->getTransport() != Message::Transport::FIXED) {
+      // Only fixed-length responses are supported so far.
+      break;
+    }
+    // The body is kept as a separate segment so that it is sent from its
+    // existing storage, whether that is memory or a file.
+    segments.emplace_back(response->getRenderedHeader1(response->getContentLength()));
+    if (response->getContentLength()) {
+      for (auto & segment : OutputSegment::fromBlob(response->getMessageBody())) {
+        segments.push_back(move(segment));
       }
     }
+    this->removeCompletedMessage();
+  }
+  return segments;
+}
+
+void ServerSession::write() {
+  scoped_lock lock{*this->controlMutex};
+
+  // Queue the segments of every response that is ready to be sent.
+  for (auto & segment : this->takeOutput()) {
+    this->output.push(move(segment));
+  }
+
+  // Write as much as possible.  The socket is monitored with edge-triggered
+  // notifications, so the queue is drained until either it is empty or the
+  // socket would block.
+  if (this->finished) {
+    return;
+  }
+  if (auto ec = this->output.sendTo(this->hClient)) {
+    cout << "Error writing response: " << ec.message() << endl;
+    this->finished = true;
   }
 }
 
@@ -232,7 +332,6 @@ void ServerSession::removeCompletedMessage() {
   auto currentRequest = this->pipeline.front();
   this->messages.erase(currentRequest);
   this->pipeline.pop();
-  this->writeOffset = 0;
   this->chunkOffset = 0;
 }
 
@@ -0,0 +1,267 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::Target class.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include "wave/parsing.hpp"
+#include "wave/target.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+/**
+ * Get the value of a hexadecimal digit.
+ *
+ * @param c The character.
+ * @result The value of the digit, or -1 if it is not a hexadecimal digit.
+ */
+static int hexValue(char c) {
+  if ((c >= '0') && (c <= '9')) {
+    return c - '0';
+  }
+  if ((c >= 'a') && (c <= 'f')) {
+    return c - 'a' + 10;
+  }
+  if ((c >= 'A') && (c <= 'F')) {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+Target::Target() : text{}, form{Form::INVALID}, scheme{}, host{}, port{}, path{}, query{}, fragment{}, parameters{}, parametersSplit{false} {}
+
+Target::Target(const shared_string_view & text) : text{text}, form{Form::INVALID}, scheme{}, host{}, port{}, path{}, query{}, fragment{}, parameters{}, parametersSplit{false} {
+  this->form = this->parse();
+  if (this->form == Form::INVALID) {
+    // Do not leave a partial result.
+    this->scheme = this->host = this->port = this->path = this->query = this->fragment = {};
+  }
+}
+
+const shared_string_view & Target::getText() const {
+  return this->text;
+}
+
+Target::Form Target::getForm() const {
+  return this->form;
+}
+
+shared_string_view Target::getScheme() const {
+  return this->view(this->scheme);
+}
+
+shared_string_view Target::getHost() const {
+  return this->view(this->host);
+}
+
+shared_string_view Target::getPort() const {
+  return this->view(this->port);
+}
+
+shared_string_view Target::getPath() const {
+  return this->view(this->path);
+}
+
+shared_string_view Target::getQuery() const {
+  return this->view(this->query);
+}
+
+shared_string_view Target::getFragment() const {
+  return this->view(this->fragment);
+}
+
+Target::Component Target::Component::between(size_t start, size_t end) {
+  return {static_cast<uint32_t>(start), static_cast<uint32_t>(end - start)};
+}
+
+shared_string_view Target::view(Component component) const {
+  return this->text.substr(component.start, component.length);
+}
+
+Target::Form Target::parse() {
+  // https://datatracker.ietf.org/doc/html/rfc9112#section-3.2
+  string_view text{this->text};
+  if (text.empty() || (text.length() > UINT32_MAX) || (findNonTargetChar(text.data(), text.length()) < text.length())) {
+    return Form::INVALID;
+  }
+
+  // https://datatracker.ietf.org/doc/html/rfc9112#section-3.2.4
+  if (text == "*") {
+    return Form::ASTERISK;
+  }
+
+  // The fragment, and then the query, are split from the end.
+  // https://datatracker.ietf.org/doc/html/rfc3986#section-3
+  size_t end = min(text.find('#'), text.length());
+  if (end < text.length()) {
+    this->fragment = Component::between(end + 1, text.length());
+  }
+  size_t queryStart = min(text.substr(0, end).find('?'), end);
+  if (queryStart < end) {
+    this->query = Component::between(queryStart + 1, end);
+  }
+
+  // https://datatracker.ietf.org/doc/html/rfc9112#section-3.2.1
+  if (text[0] == '/') {
+    this->path = Component::between(0, queryStart);
+    return Form::ORIGIN;
+  }
+
+  // https://datatracker.ietf.org/doc/html/rfc3986#section-3.1
+  size_t schemeEnd = min(text.substr(0, queryStart).find(':'), queryStart);
+  bool hasScheme = (schemeEnd > 0) && (schemeEnd < queryStart) && isalpha(static_cast<unsigned char>(text[0]))
+    && all_of(text.begin(), text.begin() + schemeEnd, [](char c) {
+      return isalnum(static_cast<unsigned char>(c)) || (c == '+') || (c == '-') || (c == '.');
+    });
+
+  // https://datatracker.ietf.org/doc/html/rfc9112#section-3.2.2
+  if (hasScheme && (text.substr(schemeEnd + 1, 2) == "//") && (schemeEnd + 3 <= queryStart)) {
+    this->scheme = Component::between(0, schemeEnd);
+    size_t authorityStart = schemeEnd + 3;
+    size_t authorityEnd = min(text.substr(0, queryStart).find('/', authorityStart), queryStart);
+    if (!this->parseAuthority(authorityStart, authorityEnd)) {
+      return Form::INVALID;
+    }
+    this->path = Component::between(authorityEnd, queryStart);
+    return Form::ABSOLUTE;
+  }
+
+  // An authority-form target (`host:port`) also looks like a scheme followed
+  // by a path, so it is tried first.
+  // https://datatracker.ietf.org/doc/html/rfc9112#section-3.2.3
+  if ((end == text.length()) && (queryStart == end) && (text.find('/') == string_view::npos)
+    && this->parseAuthority(0, text.length()) && this->port.length) {
+    return Form::AUTHORITY;
+  }
+  this->host = this->port = {};
+
+  // An absolute URI without an authority (e.g., `urn:example`).
+  if (hasScheme) {
+    this->scheme = Component::between(0, schemeEnd);
+    this->path = Component::between(schemeEnd + 1, queryStart);
+    return Form::ABSOLUTE;
+  }
+  return Form::INVALID;
+}
+
+bool Target::parseAuthority(size_t start, size_t end) {
+  // https://datatracker.ietf.org/doc/html/rfc3986#section-3.2
+  string_view text = string_view{this->text}.substr(start, end - start);
+
+  // Any userinfo is discarded.
+  // https://datatracker.ietf.org/doc/html/rfc9110#section-4.2.4
+  size_t at = text.rfind('@');
+  size_t hostStart = (at == string_view::npos) ? 0 : at + 1;
+  size_t hostEnd{};
+  if ((hostStart < text.length()) && (text[hostStart] == '[')) {
+    // An IP literal.
+    hostEnd = text.find(']', hostStart);
+    if (hostEnd == string_view::npos) {
+      return false;
+    }
+    ++hostEnd;
+  }
+  else {
+    hostEnd = min(text.find(':', hostStart), text.length());
+    if (text.substr(hostStart, hostEnd - hostStart).find_first_of("[]") != string_view::npos) {
+      return false;
+    }
+  }
+
+  // The host of an http(s) URI must not be empty.
+  // https://datatracker.ietf.org/doc/html/rfc9110#section-4.2.1-2
+  if (hostEnd == hostStart) {
+    return false;
+  }
+  if (hostEnd < text.length()) {
+    if ((text[hostEnd] != ':') || !all_of(text.begin() + hostEnd + 1, text.end(), [](char c) {
+      return (c >= '0') && (c <= '9');
+    })) {
+      return false;
+    }
+    this->port = Component::between(start + hostEnd + 1, end);
+  }
+  this->host = Component::between(start + hostStart, start + hostEnd);
+  return true;
+}
+
+const Target::QueryParameters & Target::getQueryParameters() const {
+  if (!this->parametersSplit) {
+    // https://url.spec.whatwg.org/#urlencoded-parsing
+    auto all = this->getQuery();
+    string_view query{all};
+    size_t pos{0};
+    while (pos < query.length()) {
+      size_t end = min(query.find('&', pos), query.length());
+      if (end > pos) {
+        size_t equals = min(query.find('=', pos), end);
+        this->parameters.emplace_back(QueryParameter{
+          all.substr(pos, equals - pos),
+          equals < end ? all.substr(equals + 1, end - equals - 1) : shared_string_view{},
+        });
+      }
+      pos = end + 1;
+    }
+    this->parametersSplit = true;
+  }
+  return this->parameters;
+}
+
+optional<shared_string_view> Target::getQueryParameter(string_view name) const {
+  for (auto & parameter : this->getQueryParameters()) {
+    string_view rawName{parameter.name};
+    bool matches = (findEncodedChar(rawName.data(), rawName.length()) == rawName.length())
+      ? (rawName == name)
+      : (string_view{Target::decode(parameter.name, true)} == name);
+    if (matches) {
+      return Target::decode(parameter.value, true);
+    }
+  }
+  return nullopt;
+}
+
+shared_string_view Target::decode(const shared_string_view & text, bool plusIsSpace) {
+  // https://datatracker.ietf.org/doc/html/rfc3986#section-2.1
+  string_view source{text};
+  const char * data = source.data();
+  size_t length = source.length();
+
+  // Find the first character that must be decoded.  Usually there is none,
+  // and the text can be returned as it is.
+  size_t pos = findEncodedChar(data, length);
+  while ((pos < length) && !plusIsSpace && (data[pos] == '+')) {
+    pos += 1 + findEncodedChar(data + pos + 1, length - pos - 1);
+  }
+  if (pos == length) {
+    return text;
+  }
+
+  // The runs between escapes are copied whole.
+  string decoded{};
+  decoded.reserve(length);
+  size_t start{0};
+  while (pos < length) {
+    decoded.append(data + start, pos - start);
+    if (data[pos] == '+') {
+      decoded += plusIsSpace ? ' ' : '+';
+      start = pos + 1;
+    }
+    else if ((pos + 2 < length) && (hexValue(data[pos + 1]) >= 0) && (hexValue(data[pos + 2]) >= 0)) {
+      decoded += static_cast<char>((hexValue(data[pos + 1]) << 4) | hexValue(data[pos + 2]));
+      start = pos + 3;
+    }
+    else {
+      decoded += '%';
+      start = pos + 1;
+    }
+    pos = start + findEncodedChar(data + start, length - start);
+  }
+  decoded.append(data + start, length - start);
+  return shared_string_view{move(decoded)};
+}
@@ -0,0 +1,134 @@
+/**
+ * @file
+ *
+ * Define the Ghoti::Wave::WorkerPool class.
+ */
+
+#include <algorithm>
+#include "wave/workerPool.hpp"
+
+using namespace std;
+using namespace Ghoti::Wave;
+
+/**
+ * How long a worker may wait for a job before it exits (if the pool has more
+ * than its minimum number of workers).
+ */
+#define WORKER_IDLE_TIMEOUT 2s
+
+WorkerPool::WorkerPool(size_t minThreads, size_t maxThreads) :
+  minThreads{max<size_t>(minThreads, 1)},
+  maxThreads{max<size_t>(maxThreads, max<size_t>(minThreads, 1))},
+  controlMutex{},
+  jobReady{},
+  jobs{},
+  threads{},
+  exited{},
+  threadCount{0},
+  idleCount{0},
+  running{false} {}
+
+WorkerPool::~WorkerPool() {
+  this->join();
+}
+
+void WorkerPool::start() {
+  scoped_lock lock{this->controlMutex};
+  if (this->running) {
+    return;
+  }
+  this->running = true;
+  while (this->threadCount < this->minThreads) {
+    this->addWorker();
+  }
+}
+
+void WorkerPool::enqueue(Job && job) {
+  {
+    scoped_lock lock{this->controlMutex};
+    this->jobs.push(move(job));
+    this->reapWorkers();
+
+    // Grow the pool if the queued work cannot be picked up by an idle worker.
+    if (this->running && (this->jobs.size() > this->idleCount) && (this->threadCount < this->maxThreads)) {
+      this->addWorker();
+    }
+  }
+  this->jobReady.notify_one();
+}
+
+void WorkerPool::join() {
+  list<jthread> workers;
+  {
+    scoped_lock lock{this->controlMutex};
+    this->running = false;
+    swap(workers, this->threads);
+    this->exited.clear();
+  }
+  this->jobReady.notify_all();
+
+  // The workers will finish the queued jobs before exiting.
+  for (auto & worker : workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+size_t WorkerPool::getThreadCount() {
+  scoped_lock lock{this->controlMutex};
+  return this->threadCount;
+}
+
+void WorkerPool::workerLoop(list<jthread>::iterator self) {
+  unique_lock lock{this->controlMutex};
+  while (1) {
+    if (this->jobs.size()) {
+      auto job = move(this->jobs.front());
+      this->jobs.pop();
+      lock.unlock();
+      job();
+      lock.lock();
+      continue;
+    }
+    if (!this->running) {
+      break;
+    }
+
+    // Wait for a job.  A worker that stays idle is not needed, so it exits,
+    // unless that would leave the pool below its minimum size.
+    ++this->idleCount;
+    bool ready = this->jobReady.wait_for(lock, WORKER_IDLE_TIMEOUT, [&]() {
+      return this->jobs.size() || !this->running;
+    });
+    --this->idleCount;
+    if (!ready && (this->threadCount > this->minThreads)) {
+      // Only a running pool still owns its threads.  A joining pool has
+      // already taken them, and will join this one itself.
+      if (this->running) {
+        this->exited.push_back(self);
+      }
+      break;
+    }
+  }
+  --this->threadCount;
+}
+
+void WorkerPool::addWorker() {
+  ++this->threadCount;
+  auto self = this->threads.emplace(this->threads.end());
+  *self = jthread{[this, self]() {
+    this->workerLoop(self);
+  }};
+}
+
+void WorkerPool::reapWorkers() {
+  for (auto worker : this->exited) {
+    // The worker has already given up the lock for the last time, so the
+    // join will not wait on anything other than the thread exiting.
+    worker->join();
+    this->threads.erase(worker);
+  }
+  this->exited.clear();
+}
+
@@ -4,7 +4,13 @@
  * Test the general Wave server behavior.
  */
 
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <sstream>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
 #include <ghoti.io/util/file.hpp>
 #include "wave/blob.hpp"
@@ -15,6 +21,23 @@ using namespace Ghoti::Wave;
 
 static string tempName{"waveTest"};
 
+/**
+ * Read the whole contents of the anonymous file of a Blob.
+ *
+ * @param blob The Blob.
+ * @return The contents of its file.
+ */
+static string readFile(const Blob & blob) {
+  struct stat status;
+  if ((blob.getDescriptor() == -1) || (fstat(blob.getDescriptor(), &status) == -1)) {
+    return "<no file>";
+  }
+  string contents(status.st_size, '\0');
+  auto bytesRead = pread(blob.getDescriptor(), contents.data(), contents.length(), 0);
+  contents.resize(max<ssize_t>(bytesRead, 0));
+  return contents;
+}
+
 TEST(Blob, General) {
   {
     // Default blob object.
@@ -57,11 +80,14 @@ TEST(Blob, General) {
     EXPECT_FALSE(b.convertToFile());
     EXPECT_EQ(b.getType(), Blob::Type::FILE);
     // Verify that the file contains the text.
-    ASSERT_EQ(string{b.getFile()}, "a");
+    ASSERT_EQ(readFile(b), "a");
+    // The file is anonymous.
+    ASSERT_EQ(b.getFile().getPath(), "");
     // Write to the file and verify.
     ASSERT_FALSE(b.append("b"));
     // Verify the file wite was successful.
-    ASSERT_EQ(string{b.getFile()}, "ab");
+    ASSERT_EQ(readFile(b), "ab");
+    ASSERT_TRUE(b == "ab");
     ASSERT_EQ(*b.sizeOrError(), 2);
     ASSERT_EQ(*b.lengthOrError(), 2);
   }
@@ -79,6 +105,161 @@ TEST(Blob, General) {
     ASSERT_EQ(*b.sizeOrError(), 3);
     ASSERT_FALSE(b.truncate("hello"));
     ASSERT_EQ(*b.sizeOrError(), 5);
+    ASSERT_EQ(readFile(b), "hello");
+  }
+}
+
+TEST(Blob, Segmented) {
+  {
+    // Appended text is kept as views, without being copied.
+    shared_string_view source{string{"abcdef"}};
+    Blob b{};
+    ASSERT_FALSE(b.append(source.substr(0, 2)));
+    ASSERT_FALSE(b.append(source.substr(2, 0)));
+    ASSERT_FALSE(b.append(source.substr(2, 3)));
+    ASSERT_FALSE(b.append(source.substr(5)));
+    ASSERT_EQ(*b.sizeOrError(), 6);
+    auto vectors = b.getIovecs();
+    ASSERT_EQ(vectors.size(), 3);
+    ASSERT_EQ(vectors[0].iov_base, string_view{source}.data());
+    ASSERT_EQ(vectors[0].iov_len, 2);
+    ASSERT_EQ(vectors[1].iov_base, string_view{source}.data() + 2);
+    ASSERT_EQ(vectors[2].iov_len, 1);
+
+    // The views are compared and written without being joined.
+    ASSERT_TRUE(b == "abcdef");
+    ASSERT_FALSE(b == "abcdeg");
+    ASSERT_FALSE(b == "abcde");
+    ASSERT_FALSE(b == "abcdefg");
+    stringstream out;
+    out << b;
+    ASSERT_EQ(out.str(), "abcdef");
+    ASSERT_EQ(b.getIovecs().size(), 3);
+
+    // They are joined when contiguous text is requested.
+    ASSERT_EQ(b.getText(), "abcdef");
+    ASSERT_EQ(b.getIovecs().size(), 1);
+    ASSERT_EQ(b.getView(), "abcdef");
+    ASSERT_FALSE(b.append("gh"));
+    ASSERT_EQ(b.getView(), "abcdefgh");
+  }
+  {
+    // A segmented blob can be converted to a file.
+    Blob b{"ab"};
+    ASSERT_FALSE(b.append("cd"));
+    ASSERT_FALSE(b.append("ef"));
+    ASSERT_FALSE(b.convertToFile());
+    ASSERT_EQ(b.getType(), Blob::Type::FILE);
+    ASSERT_EQ(b.getText(), "");
+    ASSERT_TRUE(b.getIovecs().empty());
+    ASSERT_EQ(readFile(b), "abcdef");
+    ASSERT_EQ(*b.sizeOrError(), 6);
+  }
+  {
+    // Truncating discards the appended views.
+    Blob b{"ab"};
+    ASSERT_FALSE(b.append("cd"));
+    ASSERT_FALSE(b.truncate("x"));
+    ASSERT_EQ(*b.sizeOrError(), 1);
+    ASSERT_EQ(b.getIovecs().size(), 1);
+    ASSERT_TRUE(b == "x");
+  }
+}
+
+TEST(Blob, Mapped) {
+  {
+    // A text blob is already in memory.
+    Blob b{"ab"};
+    ASSERT_FALSE(b.map());
+    ASSERT_EQ(b.getType(), Blob::Type::TEXT);
+    ASSERT_EQ(b.getView(), "ab");
+  }
+  {
+    // Map a file blob.
+    Blob b{"ab"};
+    ASSERT_FALSE(b.convertToFile());
+    ASSERT_EQ(b.getView(), "");
+    ASSERT_FALSE(b.map());
+    ASSERT_EQ(b.getType(), Blob::Type::MAPPED);
+    ASSERT_EQ(b.getView(), "ab");
+    ASSERT_EQ(*b.sizeOrError(), 2);
+    ASSERT_TRUE(b == "ab");
+
+    // The mapping grows as the file is appended to.
+    ASSERT_FALSE(b.append("cd"));
+    ASSERT_EQ(b.getType(), Blob::Type::MAPPED);
+    ASSERT_EQ(b.getView(), "abcd");
+    ASSERT_EQ(readFile(b), "abcd");
+    ASSERT_EQ(*b.sizeOrError(), 4);
+    string large(100000, 'x');
+    ASSERT_FALSE(b.append(large));
+    ASSERT_EQ(b.getView(), "abcd" + large);
+
+    // ... and shrinks as it is truncated.
+    ASSERT_FALSE(b.truncate("hello"));
+    ASSERT_EQ(b.getView(), "hello");
+    stringstream out;
+    out << b;
+    ASSERT_EQ(out.str(), "hello");
+    ASSERT_FALSE(b.truncate(""));
+    ASSERT_EQ(b.getView(), "");
+    ASSERT_EQ(*b.sizeOrError(), 0);
+    ASSERT_FALSE(b.append("x"));
+    ASSERT_EQ(b.getView(), "x");
+
+    // The mapping moves with the blob.
+    Blob moved{move(b)};
+    ASSERT_EQ(moved.getType(), Blob::Type::MAPPED);
+    ASSERT_EQ(moved.getView(), "x");
+    ASSERT_EQ(b.getType(), Blob::Type::TEXT);
+    ASSERT_EQ(b.getView(), "");
+    b = move(moved);
+    ASSERT_EQ(b.getView(), "x");
+    ASSERT_FALSE(b.convertToFile());
+    ASSERT_EQ(b.getType(), Blob::Type::MAPPED);
+  }
+  {
+    // An empty file may be mapped.
+    Blob b{Util::File::createTemp(tempName)};
+    ASSERT_FALSE(b.map());
+    ASSERT_EQ(b.getType(), Blob::Type::MAPPED);
+    ASSERT_EQ(b.getView(), "");
+    ASSERT_FALSE(b.append("ab"));
+    ASSERT_EQ(b.getView(), "ab");
+  }
+}
+
+TEST(Blob, SpillDirectory) {
+  {
+    // The file is created in the requested directory, without a name.
+    auto directory = filesystem::temp_directory_path() / "waveSpillTest";
+    filesystem::create_directories(directory);
+    Blob b{"ab"};
+    ASSERT_FALSE(b.convertToFile(directory.string()));
+    ASSERT_NE(b.getDescriptor(), -1);
+    ASSERT_TRUE(filesystem::is_empty(directory));
+    ASSERT_FALSE(b.append("cd"));
+    ASSERT_EQ(*b.sizeOrError(), 4);
+    ASSERT_EQ(readFile(b), "abcd");
+    stringstream out;
+    out << b;
+    ASSERT_EQ(out.str(), "abcd");
+
+    // The descriptor moves with the blob, and is closed with it.
+    int descriptor = b.getDescriptor();
+    Blob moved{move(b)};
+    ASSERT_EQ(b.getDescriptor(), -1);
+    ASSERT_EQ(moved.getDescriptor(), descriptor);
+    moved = Blob{};
+    ASSERT_EQ(fcntl(descriptor, F_GETFD), -1);
+    filesystem::remove(directory);
+  }
+  {
+    // A directory which does not exist is an error.
+    Blob b{"ab"};
+    ASSERT_TRUE(b.convertToFile("/nonexistent/waveSpillTest"));
+    ASSERT_EQ(b.getType(), Blob::Type::TEXT);
+    ASSERT_EQ(b.getText(), "ab");
   }
 }
 
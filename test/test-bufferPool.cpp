@@ -0,0 +1,98 @@
+/**
+ * @file
+ *
+ * Test the BufferPool free list.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "wave/bufferPool.hpp"
+
+using namespace std;
+using namespace Ghoti::Wave;
+
+TEST(BufferPool, Acquire) {
+  BufferPool pool{1024};
+  ASSERT_EQ(pool.getBufferSize(), 1024);
+
+  // Buffers which are borrowed at the same time are distinct.
+  auto a = pool.acquire();
+  auto b = pool.acquire();
+  ASSERT_NE(a.data(), nullptr);
+  ASSERT_NE(b.data(), nullptr);
+  ASSERT_NE(a.data(), b.data());
+  ASSERT_EQ(a.size(), 1024);
+  ASSERT_EQ(b.size(), 1024);
+
+  // The whole buffer is usable.
+  memset(a.data(), 'a', a.size());
+  memset(b.data(), 'b', b.size());
+  ASSERT_EQ(a.data()[1023], 'a');
+  ASSERT_EQ(b.data()[0], 'b');
+}
+
+TEST(BufferPool, Reuse) {
+  BufferPool pool{64};
+  char * first;
+  char * second;
+  {
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    first = a.data();
+    second = b.data();
+    a.data()[0] = 'x';
+  }
+
+  // Returned buffers are handed out again (most recently returned first),
+  // without being cleared.
+  auto c = pool.acquire();
+  auto d = pool.acquire();
+  ASSERT_EQ(c.data(), first);
+  ASSERT_EQ(d.data(), second);
+  ASSERT_EQ(c.data()[0], 'x');
+}
+
+TEST(BufferPool, MaxFree) {
+  BufferPool pool{64, 1};
+  char * kept;
+  {
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    kept = b.data();
+    // `b` is returned first, and fills the free list, so `a` is freed.
+  }
+  auto c = pool.acquire();
+  ASSERT_EQ(c.data(), kept);
+}
+
+TEST(BufferPool, Threads) {
+  // Buffers may be borrowed and returned from any thread, and a buffer is
+  // never lent to two borrowers at once.
+  BufferPool pool{16, 4};
+  vector<thread> threads;
+  atomic<bool> overlap{false};
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < 10000; ++j) {
+        auto buffer = pool.acquire();
+        buffer.data()[0] = 'a' + i;
+        this_thread::yield();
+        if (buffer.data()[0] != 'a' + i) {
+          overlap = true;
+        }
+      }
+    });
+  }
+  for (auto & t : threads) {
+    t.join();
+  }
+  ASSERT_FALSE(overlap);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
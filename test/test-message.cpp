@@ -4,7 +4,11 @@
  * Test the general Wave server behavior.
  */
 
+#include <algorithm>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 #include <gtest/gtest.h>
 #include <ghoti.io/util/file.hpp>
 #include "wave.hpp"
@@ -129,6 +133,356 @@ TEST(Message, adoptContents) {
   }
 }
 
+TEST(Message, Render) {
+  {
+    // A request.
+    Message m{Message::Type::REQUEST};
+    m.setMethod("POST")
+      .setTarget("/a?b=c")
+      .addFieldValue("Host", "example.com")
+      .addFieldValue("Accept-Encoding", "gzip")
+      .addFieldValue("Accept-Encoding", "a,b")
+      .addFieldValue("X-Quote", "say \"hi\"\\");
+    ASSERT_EQ(m.getRenderedHeader1(), "POST /a?b=c HTTP/1.1\r\nHost: example.com\r\nAccept-Encoding: gzip, \"a,b\"\r\nX-Quote: \"say \\\"hi\\\"\\\\\"\r\n");
+
+    // Once rendered, the header cannot be changed.
+    m.setMethod("GET");
+    ASSERT_EQ(m.getRenderedHeader1(), "POST /a?b=c HTTP/1.1\r\nHost: example.com\r\nAccept-Encoding: gzip, \"a,b\"\r\nX-Quote: \"say \\\"hi\\\"\\\\\"\r\n");
+    ASSERT_EQ(m.getRenderedHeader1(12), m.getRenderedHeader1() + "Content-Length: 12\r\n\r\n");
+  }
+  {
+    // Standard status codes use their reason phrase, unless one is set.
+    Message m{Message::Type::RESPONSE};
+    m.setStatusCode(404).addFieldValue("Server", "wave");
+    ASSERT_EQ(m.getRenderedHeader1(0), "HTTP/1.1 404 Not Found\r\nServer: wave\r\nContent-Length: 0\r\n\r\n");
+    ASSERT_EQ(m.getRenderedHeader1(), "HTTP/1.1 404 Not Found\r\nServer: wave\r\n");
+    Message custom{Message::Type::RESPONSE};
+    custom.setStatusCode(200).setMessage("Fine");
+    ASSERT_EQ(custom.getRenderedHeader1(1234567890), "HTTP/1.1 200 Fine\r\nContent-Length: 1234567890\r\n\r\n");
+    Message unknown{Message::Type::RESPONSE};
+    unknown.setStatusCode(299);
+    ASSERT_EQ(unknown.getRenderedHeader1(), "HTTP/1.1 299 \r\n");
+  }
+  for (auto & [code, text] : statusReasons) {
+    ASSERT_EQ(getStatusLine(code), "HTTP/1.1 " + to_string(code) + " " + string{text} + "\r\n");
+  }
+  ASSERT_EQ(getStatusLine(0), "");
+  ASSERT_EQ(getStatusLine(600), "");
+}
+
+TEST(Message, Pool) {
+  {
+    auto pool = make_shared<MessagePool>(1);
+    Message * first{};
+    {
+      auto m = pool->acquire(Message::Type::REQUEST);
+      first = m.get();
+      m->setMethod("POST").setTarget("/a?b=c").setStatusCode(404).setId(3);
+      m->addFieldValue("X-Test", "1");
+      m->setMessageBody(Blob{"hello"});
+      m->setReady(true);
+    }
+
+    // A released message is reset and reused.
+    auto m = pool->acquire(Message::Type::REQUEST);
+    ASSERT_EQ(m.get(), first);
+    ASSERT_EQ(m->getType(), Message::Type::REQUEST);
+    ASSERT_EQ(m->getMethod(), "GET");
+    ASSERT_EQ(m->getTarget(), "");
+    ASSERT_EQ(m->getParsedTarget().getForm(), Target::Form::INVALID);
+    ASSERT_EQ(m->getStatusCode(), 0);
+    ASSERT_EQ(m->getId(), 0);
+    ASSERT_FALSE(m->hasError());
+    ASSERT_FALSE(m->isFinished());
+    ASSERT_TRUE(m->getFields().empty());
+    ASSERT_EQ(m->getMessageBody(), "");
+    ASSERT_EQ(m->getTransport(), Message::Transport::UNDECLARED);
+    ASSERT_FALSE(m->getReadySemaphore().try_acquire());
+
+    // Messages of a different type are kept separately.
+    auto response = pool->acquire(Message::Type::RESPONSE);
+    ASSERT_NE(response.get(), first);
+    ASSERT_EQ(response->getType(), Message::Type::RESPONSE);
+
+    // Only `maxFree` messages of each type are kept, so the second message
+    // to be released is not.
+    auto second = pool->acquire(Message::Type::REQUEST);
+    m.reset();
+    second.reset();
+    ASSERT_EQ(pool->acquire(Message::Type::REQUEST).get(), first);
+
+    // A message may outlive its pool.
+    pool.reset();
+    response->setStatusCode(200);
+  }
+}
+
+TEST(FieldCollection, Storage) {
+  FieldCollection fields{};
+  ASSERT_TRUE(fields.empty());
+  fields.add("Host", "example.com");
+  fields.add("x-custom", "a");
+  fields.add("Accept", "text/html");
+  fields.add("X-Custom", "b");
+  fields.add("ACCEPT", "text/plain");
+
+  // Names are compared without regard to case.
+  ASSERT_EQ(fields.size(), 3);
+  ASSERT_TRUE(fields.contains("HOST"));
+  ASSERT_FALSE(fields.contains("Date"));
+  ASSERT_EQ(fields.at("X-CUSTOM").size(), 2);
+  ASSERT_EQ(fields.at("X-CUSTOM")[1], "b");
+  ASSERT_EQ(fields.get(FieldName::ACCEPT).size(), 2);
+  ASSERT_EQ(fields.get(FieldName::ACCEPT).at(1), "text/plain");
+  ASSERT_TRUE(fields.get(FieldName::DATE).empty());
+  ASSERT_THROW(fields.at("Date"), out_of_range);
+  ASSERT_THROW(fields.at("Host").at(1), out_of_range);
+
+  // Iteration visits each name once, in the order first added.
+  vector<string> names{};
+  for (auto & [name, values] : fields) {
+    names.emplace_back(string_view{name});
+    ASSERT_FALSE(values.empty());
+  }
+  ASSERT_EQ(names, (vector<string>{"Host", "x-custom", "Accept"}));
+
+  // Values beyond the inline capacity are kept in order.
+  for (size_t i = 0; i < FieldCollection::INLINE_FIELDS * 2; ++i) {
+    fields.add("X-Count", to_string(i));
+  }
+  ASSERT_EQ(fields.size(), 4);
+  auto counts = fields.get("x-count");
+  ASSERT_EQ(counts.size(), FieldCollection::INLINE_FIELDS * 2);
+  size_t expected{0};
+  for (auto & value : counts) {
+    ASSERT_EQ(value, to_string(expected++));
+  }
+
+  // Copies and moves keep the contents.
+  FieldCollection copy{fields};
+  FieldCollection moved{move(fields)};
+  ASSERT_EQ(copy.get("Host")[0], "example.com");
+  ASSERT_EQ(moved.get("X-Count").size(), FieldCollection::INLINE_FIELDS * 2);
+  ASSERT_TRUE(fields.empty());
+  FieldCollection small{};
+  small.add("Host", "a");
+  FieldCollection smallMoved{move(small)};
+  ASSERT_EQ(smallMoved.get(FieldName::HOST)[0], "a");
+}
+
+TEST(FieldCollection, Unparsed) {
+  FieldCollection fields{};
+  fields.add("Host", "example.com");
+  fields.addUnparsed(FieldName::ACCEPT, "Accept", "text/html, , \"a,\\\"b\"  ,*/*");
+  fields.add("X-Custom", "a");
+  fields.addUnparsed(FieldName::ACCEPT, "accept", "\"\",text/plain ");
+  fields.addUnparsed(FieldName::CONNECTION, "Connection", "keep-alive");
+  ASSERT_EQ(fields.size(), 4);
+
+  // A view of another field is not disturbed by the parsing of a list.
+  auto custom = fields.get("X-Custom");
+  auto host = fields.get(FieldName::HOST);
+
+  // The elements of every value are kept in order, with empty elements
+  // ignored and quoted elements unescaped.
+  auto accept = fields.get("ACCEPT");
+  vector<string> values{};
+  for (auto & value : accept) {
+    values.emplace_back(string_view{value});
+  }
+  ASSERT_EQ(values, (vector<string>{"text/html", "a,\"b", "*/*", "", "text/plain"}));
+  ASSERT_EQ(custom.size(), 1);
+  ASSERT_EQ(custom[0], "a");
+  ASSERT_EQ(host[0], "example.com");
+
+  // Iteration visits each name once, in the order first added.
+  vector<string> names{};
+  for (auto & [name, values] : fields) {
+    names.emplace_back(string_view{name});
+  }
+  ASSERT_EQ(names, (vector<string>{"Host", "Accept", "X-Custom", "Connection"}));
+  ASSERT_EQ(fields.get(FieldName::CONNECTION).size(), 1);
+
+  // More values may be added after parsing.
+  fields.add("Accept", "text/css");
+  ASSERT_EQ(fields.get(FieldName::ACCEPT).size(), 6);
+  ASSERT_EQ(fields.get(FieldName::ACCEPT)[5], "text/css");
+}
+
+TEST(KnownNames, Lookup) {
+  // Every well-known name is found, in any case.
+  for (size_t i = 1; i < FIELD_NAME_COUNT; ++i) {
+    string name{fieldNameTexts[i]};
+    ASSERT_EQ(lookupFieldName(name), static_cast<FieldName>(i));
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    ASSERT_EQ(lookupFieldName(name), static_cast<FieldName>(i));
+    ASSERT_EQ(lookupFieldName(name.substr(1)), FieldName::UNKNOWN);
+    ASSERT_EQ(string_view{getFieldNameText(static_cast<FieldName>(i))}, fieldNameTexts[i]);
+  }
+  ASSERT_EQ(lookupFieldName(""), FieldName::UNKNOWN);
+  ASSERT_EQ(lookupFieldName("X-Custom"), FieldName::UNKNOWN);
+  ASSERT_TRUE(isListField(FieldName::ACCEPT));
+  ASSERT_FALSE(isListField(FieldName::CONTENT_LENGTH));
+  ASSERT_TRUE(isListField("Accept"));
+
+  // Methods are case-sensitive.
+  for (size_t i = 1; i < METHOD_COUNT; ++i) {
+    ASSERT_EQ(lookupMethod(methodTexts[i]), static_cast<Method>(i));
+    ASSERT_EQ(string_view{getMethodText(static_cast<Method>(i))}, methodTexts[i]);
+  }
+  ASSERT_EQ(lookupMethod("get"), Method::UNKNOWN);
+  ASSERT_EQ(lookupMethod("BREW"), Method::UNKNOWN);
+
+  // The IDs are available from a Message.
+  {
+    Message m{Message::Type::REQUEST};
+    ASSERT_EQ(m.getMethodId(), Method::GET);
+    m.setMethod("POST")
+      .addFieldValue("Content-Length", "5")
+      .addFieldValue("X-Custom", "a")
+      .addFieldValue("Accept", "text/html")
+      .addFieldValue("Accept", "text/plain");
+    ASSERT_EQ(m.getMethodId(), Method::POST);
+    ASSERT_EQ(m.getFieldValues(FieldName::CONTENT_LENGTH).size(), 1);
+    ASSERT_EQ(m.getFieldValues(FieldName::CONTENT_LENGTH)[0], "5");
+    ASSERT_EQ(m.getFieldValues(FieldName::ACCEPT).size(), 2);
+    ASSERT_EQ(m.getFieldValues(FieldName::TRANSFER_ENCODING).size(), 0);
+
+    Message adopter{Message::Type::REQUEST};
+    adopter.adoptContents(m);
+    ASSERT_EQ(adopter.getFieldValues(FieldName::ACCEPT).size(), 2);
+    ASSERT_EQ(m.getFieldValues(FieldName::ACCEPT).size(), 0);
+  }
+}
+
+TEST(Parsing, ScanKernels) {
+  // Every character, at every position in a block, so that each kernel's
+  // vector loop and scalar tail are both exercised.
+  using Finder = size_t (*)(const char *, size_t);
+  using Test = bool (*)(uint8_t);
+  vector<pair<Finder, Test>> scans{
+    {findNonTokenChar, isTokenChar},
+    {findNonFieldContentChar, isFieldContentChar},
+    {findNonQuotedChar, isQuotedChar},
+    {findCRLFChar, [](uint8_t c) {return !isCRLFChar(c);}},
+    {findNonTargetChar, isTargetChar},
+    {findEncodedChar, [](uint8_t c) {return (c != '%') && (c != '+');}},
+  };
+  auto original = getScanKernel();
+  for (auto kernel : {ScanKernel::SCALAR, ScanKernel::SSE4_2, ScanKernel::AVX2}) {
+    if (!setScanKernel(kernel)) {
+      continue;
+    }
+    for (auto & [find, test] : scans) {
+      // Build a run of member characters to surround the character under
+      // test.
+      char filler{0};
+      while (!test(filler)) {
+        ++filler;
+      }
+      for (unsigned c = 0; c < 256; ++c) {
+        for (size_t position : {0, 5, 15, 16, 31, 32, 47, 70}) {
+          string text(80, filler);
+          text[position] = c;
+          size_t expected = test(c) ? text.length() : position;
+          size_t expectedUnaligned = (test(c) || !position) ? text.length() - 1 : position - 1;
+          ASSERT_EQ(find(text.data(), text.length()), expected);
+          ASSERT_EQ(find(text.data(), position), position);
+          ASSERT_EQ(find(text.data() + 1, text.length() - 1), expectedUnaligned);
+        }
+      }
+    }
+  }
+  ASSERT_TRUE(setScanKernel(original));
+}
+
+TEST(Target, Forms) {
+  {
+    Target target{"/a/b%20c?x=1&y=&&z&q=a+b%26c#frag"};
+    ASSERT_EQ(target.getForm(), Target::Form::ORIGIN);
+    ASSERT_EQ(target.getPath(), "/a/b%20c");
+    ASSERT_EQ(target.getQuery(), "x=1&y=&&z&q=a+b%26c");
+    ASSERT_EQ(target.getFragment(), "frag");
+    ASSERT_TRUE(target.getScheme().empty());
+    ASSERT_TRUE(target.getHost().empty());
+
+    // The components are views into the target.
+    string_view text{target.getText()};
+    ASSERT_EQ(string_view{target.getPath()}.data(), text.data());
+
+    auto & parameters = target.getQueryParameters();
+    ASSERT_EQ(parameters.size(), 4);
+    ASSERT_EQ(parameters[0].name, "x");
+    ASSERT_EQ(parameters[0].value, "1");
+    ASSERT_EQ(parameters[1].name, "y");
+    ASSERT_TRUE(parameters[1].value.empty());
+    ASSERT_EQ(parameters[2].name, "z");
+    ASSERT_EQ(parameters[3].value, "a+b%26c");
+    ASSERT_EQ(*target.getQueryParameter("q"), "a b&c");
+    ASSERT_EQ(*target.getQueryParameter("x"), "1");
+    ASSERT_FALSE(target.getQueryParameter("w"));
+    ASSERT_EQ(Target::decode(target.getPath()), "/a/b c");
+  }
+  {
+    Target target{"http://user@example.com:8080/p?q#f"};
+    ASSERT_EQ(target.getForm(), Target::Form::ABSOLUTE);
+    ASSERT_EQ(target.getScheme(), "http");
+    ASSERT_EQ(target.getHost(), "example.com");
+    ASSERT_EQ(target.getPort(), "8080");
+    ASSERT_EQ(target.getPath(), "/p");
+    ASSERT_EQ(target.getQuery(), "q");
+    ASSERT_EQ(target.getFragment(), "f");
+  }
+  {
+    Target target{"https://[::1]?a=b"};
+    ASSERT_EQ(target.getForm(), Target::Form::ABSOLUTE);
+    ASSERT_EQ(target.getHost(), "[::1]");
+    ASSERT_TRUE(target.getPort().empty());
+    ASSERT_TRUE(target.getPath().empty());
+    ASSERT_EQ(*target.getQueryParameter("a"), "b");
+  }
+  {
+    Target target{"example.com:443"};
+    ASSERT_EQ(target.getForm(), Target::Form::AUTHORITY);
+    ASSERT_EQ(target.getHost(), "example.com");
+    ASSERT_EQ(target.getPort(), "443");
+  }
+  {
+    Target target{"urn:example:a"};
+    ASSERT_EQ(target.getForm(), Target::Form::ABSOLUTE);
+    ASSERT_EQ(target.getScheme(), "urn");
+    ASSERT_EQ(target.getPath(), "example:a");
+  }
+  ASSERT_EQ(Target{"*"}.getForm(), Target::Form::ASTERISK);
+  for (auto text : {"", "a b", "/a\"b", "http://:80/", "http://a:b/", "http://[::1/", "/\x80", "a"}) {
+    Target target{text};
+    ASSERT_EQ(target.getForm(), Target::Form::INVALID) << text;
+    ASSERT_TRUE(target.getPath().empty()) << text;
+    ASSERT_EQ(target.getText(), text);
+  }
+}
+
+TEST(Target, Decode) {
+  // Nothing is copied if there is nothing to decode.
+  shared_string_view plain{"/a/b+c"};
+  auto same = Target::decode(plain);
+  ASSERT_EQ(string_view{same}.data(), string_view{plain}.data());
+  ASSERT_EQ(Target::decode(plain, true), "/a/b c");
+
+  // Invalid escapes are kept as they are.
+  ASSERT_EQ(Target::decode("%41%4a%4B%%2%zz%"), "AJK%%2%zz%");
+
+  // Long runs between the escapes (which are scanned a block at a time).
+  string run(100, 'x');
+  ASSERT_EQ(Target::decode(shared_string_view{run + "%2F" + run + "%2f"}), run + "/" + run + "/");
+
+  // Query parameter names are matched after decoding.
+  Message message{Message::Type::REQUEST};
+  message.setTarget("/?a%20b=c&d+e=f");
+  ASSERT_EQ(*message.getParsedTarget().getQueryParameter("a b"), "c");
+  ASSERT_EQ(*message.getParsedTarget().getQueryParameter("d e"), "f");
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
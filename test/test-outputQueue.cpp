@@ -0,0 +1,181 @@
+/**
+ * @file
+ *
+ * Test the OutputQueue writes to a non-blocking socket.
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <ghoti.io/util/file.hpp>
+#include "wave/outputQueue.hpp"
+
+using namespace std;
+using namespace Ghoti;
+using namespace Ghoti::Wave;
+
+static string tempName{"waveTest"};
+
+/**
+ * Create text which does not repeat at any power of 2, so that output which
+ * resumes from the wrong offset is detected.
+ *
+ * @param length The length of the text.
+ * @param first The first character of the pattern.
+ * @return The text.
+ */
+static string pattern(size_t length, char first) {
+  string text(length, '\0');
+  for (size_t i = 0; i < length; ++i) {
+    text[i] = first + (i % 23);
+  }
+  return text;
+}
+
+/**
+ * Create a file-backed segment.
+ *
+ * @param contents The contents of the file.
+ * @return The segment.
+ */
+static OutputSegment fileSegment(const string & contents) {
+  auto f{Util::File::createTemp(tempName)};
+  if (contents.length()) {
+    [[maybe_unused]] auto error = f.append(contents);
+  }
+  return move(OutputSegment::fromBlob(Blob{move(f)}).front());
+}
+
+/**
+ * Drain a queue into a socket pair whose send buffer is much smaller than
+ * the queued output, reading whatever arrives after each write attempt.
+ *
+ * @param queue The queue.
+ * @param received Set to all of the bytes read from the socket pair.
+ * @return The number of write attempts which left output in the queue.
+ */
+static size_t drain(OutputQueue & queue, string & received) {
+  int handles[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, handles)) {
+    return 0;
+  }
+  int sendBuffer{4096};
+  setsockopt(handles[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+  fcntl(handles[0], F_SETFL, O_NONBLOCK);
+  fcntl(handles[1], F_SETFL, O_NONBLOCK);
+
+  size_t blocked{0};
+  char buffer[1024];
+  while (1) {
+    if (auto error = queue.sendTo(handles[0])) {
+      ADD_FAILURE() << error.message();
+      break;
+    }
+    if (queue.empty()) {
+      break;
+    }
+    ++blocked;
+    ssize_t bytesRead;
+    while ((bytesRead = read(handles[1], buffer, sizeof(buffer))) > 0) {
+      received.append(buffer, bytesRead);
+    }
+  }
+  close(handles[0]);
+  ssize_t bytesRead;
+  while ((bytesRead = read(handles[1], buffer, sizeof(buffer))) > 0) {
+    received.append(buffer, bytesRead);
+  }
+  close(handles[1]);
+  return blocked;
+}
+
+TEST(OutputQueue, Text) {
+  // Text segments are gathered together, and a segment which is only partly
+  // written is resumed from where it stopped, including when the write
+  // stopped in the middle of a later segment of the same gather.
+  OutputQueue queue{};
+  string expected;
+  for (auto length : {size_t{100}, size_t{50000}, size_t{3}, size_t{70000}}) {
+    auto text = pattern(length, 'a' + (expected.length() % 5));
+    expected += text;
+    queue.push(OutputSegment{shared_string_view{text}});
+  }
+  string received;
+  ASSERT_GT(drain(queue, received), 1);
+  ASSERT_EQ(received, expected);
+}
+
+TEST(OutputQueue, Empty) {
+  // Zero-length segments, at the start, the middle, and the end of the
+  // queue, are skipped without ending the write.
+  OutputQueue queue{};
+  string expected{pattern(20000, 'a') + pattern(20000, 'A')};
+  queue.push(fileSegment(""));
+  queue.push(OutputSegment{shared_string_view{}});
+  queue.push(OutputSegment{shared_string_view{expected.substr(0, 20000)}});
+  queue.push(OutputSegment{shared_string_view{}});
+  queue.push(fileSegment(""));
+  queue.push(fileSegment(expected.substr(20000)));
+  queue.push(OutputSegment{shared_string_view{}});
+  string received;
+  ASSERT_GT(drain(queue, received), 0);
+  ASSERT_EQ(received, expected);
+
+  // A queue of only zero-length segments is emptied by a single write.
+  queue.push(OutputSegment{shared_string_view{}});
+  queue.push(fileSegment(""));
+  received.clear();
+  ASSERT_EQ(drain(queue, received), 0);
+  ASSERT_EQ(received, "");
+}
+
+TEST(OutputQueue, Mixed) {
+  // Text and file segments alternate, each larger than the send buffer, so
+  // the write stops part-way through segments of both kinds.
+  OutputQueue queue{};
+  string expected;
+  for (int i = 0; i < 6; ++i) {
+    auto text = pattern(30000 + i * 1000, 'a' + i);
+    expected += text;
+    if (i % 2) {
+      queue.push(fileSegment(text));
+    }
+    else {
+      queue.push(OutputSegment{shared_string_view{text}});
+    }
+  }
+  string received;
+  ASSERT_GT(drain(queue, received), 5);
+  ASSERT_EQ(received, expected);
+}
+
+TEST(OutputQueue, Blob) {
+  // The views appended to a text Blob are queued as separate segments and
+  // gathered by the write, without being joined.
+  Blob blob{};
+  string expected;
+  for (int i = 0; i < 5; ++i) {
+    auto text = pattern(20000 + i, 'a' + i);
+    expected += text;
+    ASSERT_FALSE(blob.append(shared_string_view{text}));
+  }
+  ASSERT_EQ(OutputSegment::fromBlob(blob).size(), 5);
+  OutputQueue queue{};
+  queue.push(blob);
+  ASSERT_EQ(blob.getIovecs().size(), 5);
+  string received;
+  ASSERT_GT(drain(queue, received), 0);
+  ASSERT_EQ(received, expected);
+
+  // An empty Blob queues nothing.
+  queue.push(Blob{});
+  ASSERT_TRUE(queue.empty());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
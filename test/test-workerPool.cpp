@@ -0,0 +1,98 @@
+/**
+ * @file
+ *
+ * Test the WorkerPool scaling behavior.
+ */
+
+#include <atomic>
+#include <latch>
+#include <gtest/gtest.h>
+#include "wave/workerPool.hpp"
+
+using namespace std;
+using namespace Ghoti::Wave;
+
+TEST(WorkerPool, RunsJobs) {
+  atomic<int> count{0};
+  {
+    WorkerPool pool{1, 4};
+    pool.start();
+    for (int i = 0; i < 100; ++i) {
+      pool.enqueue([&]() {
+        ++count;
+      });
+    }
+
+    // Joining the pool runs all queued jobs.
+    pool.join();
+    ASSERT_EQ(count, 100);
+    ASSERT_EQ(pool.getThreadCount(), 0);
+  }
+}
+
+TEST(WorkerPool, Limits) {
+  {
+    // The minimum is always at least 1, and the maximum is never less than
+    // the minimum.
+    WorkerPool pool{0, 0};
+    pool.start();
+    ASSERT_EQ(pool.getThreadCount(), 1);
+  }
+  {
+    WorkerPool pool{3, 1};
+    pool.start();
+    ASSERT_EQ(pool.getThreadCount(), 3);
+  }
+}
+
+TEST(WorkerPool, Grows) {
+  {
+    // Block every worker, so that each new job requires a new worker.
+    WorkerPool pool{1, 4};
+    pool.start();
+    latch release{1};
+    for (int i = 0; i < 8; ++i) {
+      pool.enqueue([&]() {
+        release.wait();
+      });
+    }
+
+    // The pool grows, but not past its maximum.
+    ASSERT_EQ(pool.getThreadCount(), 4);
+    release.count_down();
+  }
+}
+
+TEST(WorkerPool, Shrinks) {
+  {
+    WorkerPool pool{1, 4};
+    pool.start();
+    latch release{1};
+    for (int i = 0; i < 4; ++i) {
+      pool.enqueue([&]() {
+        release.wait();
+      });
+    }
+    ASSERT_EQ(pool.getThreadCount(), 4);
+    release.count_down();
+
+    // Idle workers exit, down to the minimum.
+    for (int i = 0; (i < 100) && (pool.getThreadCount() > 1); ++i) {
+      this_thread::sleep_for(100ms);
+    }
+    ASSERT_EQ(pool.getThreadCount(), 1);
+
+    // The pool can still grow again.
+    atomic<int> count{0};
+    pool.enqueue([&]() {
+      ++count;
+    });
+    pool.join();
+    ASSERT_EQ(count, 1);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
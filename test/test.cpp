@@ -4,7 +4,15 @@
  * Test the general Wave server behavior.
  */
 
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
 #include <gtest/gtest.h>
 #include "wave.hpp"
 
@@ -92,6 +100,839 @@ TEST(Integration, Simple) {
   }
 }
 
+TEST(Integration, IoUring) {
+  {
+    // Verify that the io_uring backend serves requests (falling back to epoll
+    // if io_uring is not available).
+    Server s{};
+    s.setParameter(ServerParameter::IOBACKEND, ServerIOBackend::IO_URING);
+    s.start();
+    for (int i = 0; i < 3; ++i) {
+      Client c{};
+      auto request = make_shared<Message>(Message::Type::REQUEST);
+      request
+        ->setDomain("127.0.0.1")
+        .setPort(s.getPort())
+        .setTarget("/foo");
+      auto response = c.sendRequest(request);
+      response->getReadySemaphore().acquire();
+
+      // Verify the basic Response Message details.
+      ASSERT_EQ(response->getTransport(), Message::Transport::FIXED);
+      ASSERT_EQ(response->getContentLength(), 12);
+      ASSERT_EQ(response->getMessageBody().getType(), Blob::Type::TEXT);
+    }
+  }
+}
+
+TEST(Integration, Reactors) {
+  {
+    // Verify that a server with several reactors (sharing a port) serves
+    // requests.
+    Server s{};
+    s.setParameter(ServerParameter::REACTORCOUNT, uint32_t{4});
+    s.start();
+    ASSERT_EQ(s.getErrorCode(), Server::ErrorCode::NO_ERROR);
+    ASSERT_NE(s.getPort(), 0);
+    for (int i = 0; i < 8; ++i) {
+      Client c{};
+      auto request = make_shared<Message>(Message::Type::REQUEST);
+      request
+        ->setDomain("127.0.0.1")
+        .setPort(s.getPort())
+        .setTarget("/foo");
+      auto response = c.sendRequest(request);
+      response->getReadySemaphore().acquire();
+
+      // Verify the basic Response Message details.
+      ASSERT_EQ(response->getTransport(), Message::Transport::FIXED);
+      ASSERT_EQ(response->getContentLength(), 12);
+    }
+
+    // Verify that the server can be restarted.
+    s.stop();
+    ASSERT_EQ(s.isRunning(), false);
+    s.start();
+    ASSERT_EQ(s.isRunning(), true);
+    ASSERT_EQ(s.getErrorCode(), Server::ErrorCode::NO_ERROR);
+  }
+}
+
+TEST(Integration, ListenOptions) {
+  {
+    // Verify that the listen backlog and TCP_DEFER_ACCEPT options are
+    // accepted, and that requests are still served.
+    Server s{};
+    s.setParameter(ServerParameter::LISTENBACKLOG, uint32_t{1024});
+    s.setParameter(ServerParameter::DEFERACCEPT, uint32_t{5});
+    s.start();
+    ASSERT_EQ(s.getErrorCode(), Server::ErrorCode::NO_ERROR);
+    Client c{};
+    auto request = make_shared<Message>(Message::Type::REQUEST);
+    request
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/foo");
+    auto response = c.sendRequest(request);
+    response->getReadySemaphore().acquire();
+    ASSERT_EQ(response->getContentLength(), 12);
+  }
+}
+
+TEST(Server, Handler) {
+  for (auto backend : {ServerIOBackend::EPOLL, ServerIOBackend::IO_URING}) {
+    // Verify that a handler may complete its response later, from another
+    // thread, without holding up the requests on other connections.
+    binary_semaphore release{0};
+    vector<jthread> completers;
+    Server s{};
+    s.setParameter(ServerParameter::IOBACKEND, backend);
+    s.setHandler([&](auto request, auto response) {
+      if (request->getTarget() == "/slow") {
+        completers.emplace_back([&, response]() {
+          release.acquire();
+          response->getMessage()
+            .setStatusCode(202)
+            .setMessageBody({"Later"});
+          response->complete();
+        });
+        return;
+      }
+      if (request->getTarget() == "/throw") {
+        throw runtime_error{"Handler failure"};
+      }
+      response->getMessage()
+        .setStatusCode(200)
+        .setMessageBody({"Now"});
+      response->complete();
+    });
+    s.start();
+    ASSERT_EQ(s.getErrorCode(), Server::ErrorCode::NO_ERROR);
+
+    // The handler cannot be changed while the server is running.
+    s.setHandler([](auto, auto) {});
+    ASSERT_EQ(s.getErrorCode(), Server::ErrorCode::SERVER_ALREADY_RUNNING);
+    s.clearError();
+
+    Client slowClient{};
+    auto slowRequest = make_shared<Message>(Message::Type::REQUEST);
+    slowRequest
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/slow");
+    auto slowResponse = slowClient.sendRequest(slowRequest);
+
+    Client fastClient{};
+    auto fastRequest = make_shared<Message>(Message::Type::REQUEST);
+    fastRequest
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/fast");
+    auto fastResponse = fastClient.sendRequest(fastRequest);
+    fastResponse->getReadySemaphore().acquire();
+
+    // Only now allow the slow response to complete.
+    bool slowWasPending = !slowResponse->getReadySemaphore().try_acquire();
+    release.release();
+    ASSERT_TRUE(slowWasPending);
+    ASSERT_EQ(fastResponse->getStatusCode(), 200);
+    ASSERT_EQ(fastResponse->getContentLength(), 3);
+    slowResponse->getReadySemaphore().acquire();
+    ASSERT_EQ(slowResponse->getStatusCode(), 202);
+    ASSERT_EQ(slowResponse->getContentLength(), 5);
+
+    // A handler which throws is answered with an error.
+    Client throwClient{};
+    auto throwRequest = make_shared<Message>(Message::Type::REQUEST);
+    throwRequest
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/throw");
+    auto throwResponse = throwClient.sendRequest(throwRequest);
+    throwResponse->getReadySemaphore().acquire();
+    ASSERT_EQ(throwResponse->getStatusCode(), 500);
+  }
+}
+
+TEST(Server, BlockingHandler) {
+  for (auto backend : {ServerIOBackend::EPOLL, ServerIOBackend::IO_URING}) {
+    // Verify that handlers which block, more of them than there are worker
+    // threads, do not stop other connections from being served.
+    constexpr int blockedCount{4};
+    counting_semaphore<blockedCount> release{0};
+    atomic<int> blocked{0};
+    Server s{};
+    s.setParameter(ServerParameter::IOBACKEND, backend);
+    s.setParameter(ServerParameter::MAXWORKERS, uint32_t{2});
+    s.setParameter(ServerParameter::MAXHANDLERS, uint32_t{blockedCount + 1});
+    s.setHandler([&](auto request, auto response) {
+      if (request->getTarget() == "/block") {
+        ++blocked;
+        release.acquire();
+      }
+      response->getMessage()
+        .setStatusCode(200)
+        .setMessageBody({"Done"});
+      response->complete();
+    });
+    s.start();
+    ASSERT_EQ(s.getErrorCode(), Server::ErrorCode::NO_ERROR);
+
+    vector<unique_ptr<Client>> blockedClients;
+    vector<shared_ptr<Message>> blockedResponses;
+    for (int i = 0; i < blockedCount; ++i) {
+      auto request = make_shared<Message>(Message::Type::REQUEST);
+      request
+        ->setDomain("127.0.0.1")
+        .setPort(s.getPort())
+        .setTarget("/block");
+      blockedClients.push_back(make_unique<Client>());
+      blockedResponses.push_back(blockedClients.back()->sendRequest(request));
+    }
+    while (blocked < blockedCount) {
+      this_thread::sleep_for(quantum);
+    }
+
+    Client fastClient{};
+    auto fastRequest = make_shared<Message>(Message::Type::REQUEST);
+    fastRequest
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/fast");
+    auto fastResponse = fastClient.sendRequest(fastRequest);
+    fastResponse->getReadySemaphore().acquire();
+    ASSERT_EQ(fastResponse->getStatusCode(), 200);
+
+    release.release(blockedCount);
+    for (auto & response : blockedResponses) {
+      response->getReadySemaphore().acquire();
+      ASSERT_EQ(response->getStatusCode(), 200);
+    }
+  }
+}
+
+TEST(Server, StreamingBody) {
+  for (auto backend : {ServerIOBackend::EPOLL, ServerIOBackend::IO_URING}) {
+    // Verify that a streamed request reaches the handler before its body has
+    // arrived, and that the body is delivered as it arrives, except while the
+    // handler has paused it.
+    binary_semaphore headerSeen{0};
+    binary_semaphore firstPiece{0};
+    shared_ptr<BodyStream> stream;
+    atomic<size_t> received{0};
+    Server s{};
+    s.setParameter(ServerParameter::IOBACKEND, backend);
+    s.setParameter(ServerParameter::STREAMBODIES, true);
+    s.setHandler([&](auto request, auto response) {
+      stream = request->getBodyStream();
+      headerSeen.release();
+      ASSERT_TRUE(stream);
+      stream->onData([&, response](const auto & data, bool finished) {
+        if (!received && data.length()) {
+          stream->pause();
+          firstPiece.release();
+        }
+        received += data.length();
+        if (finished) {
+          response->getMessage()
+            .setStatusCode(200)
+            .setMessageBody({shared_string_view{to_string(received)}});
+          response->complete();
+        }
+      });
+    });
+    s.start();
+    ASSERT_EQ(s.getErrorCode(), Server::ErrorCode::NO_ERROR);
+
+    int hSocket = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(hSocket, 0);
+    timeval timeout{5, 0};
+    setsockopt(hSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(s.getPort());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(connect(hSocket, (sockaddr *)&address, sizeof(address)), 0);
+    auto sendText = [&](string_view text) {
+      ASSERT_EQ(send(hSocket, text.data(), text.length(), 0), (ssize_t)text.length());
+    };
+
+    // The handler sees the request after only the first piece of the body.
+    sendText("POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 10\r\n\r\nabc");
+    ASSERT_TRUE(headerSeen.try_acquire_for(5s));
+    ASSERT_TRUE(firstPiece.try_acquire_for(5s));
+    ASSERT_EQ(received, 3);
+
+    // Nothing more is delivered while the stream is paused.
+    sendText("defg");
+    this_thread::sleep_for(5 * quantum);
+    ASSERT_EQ(received, 3);
+    ASSERT_FALSE(stream->isEnded());
+
+    // Once resumed, the rest of the body is delivered.
+    stream->resume();
+    sendText("hij");
+    string reply;
+    char buffer[1024];
+    while (reply.find("\r\n\r\n10") == string::npos) {
+      auto count = recv(hSocket, buffer, sizeof(buffer), 0);
+      if (count <= 0) {
+        break;
+      }
+      reply.append(buffer, count);
+    }
+    close(hSocket);
+    ASSERT_NE(reply.find("\r\n\r\n10"), string::npos);
+    ASSERT_EQ(received, 10);
+    ASSERT_TRUE(stream->isEnded());
+    ASSERT_FALSE(stream->isAborted());
+  }
+}
+
+TEST(Server, BufferSize) {
+  for (uint32_t limit : {uint32_t{1024}, uint32_t{10}}) {
+    // Verify that the request message body is only a file-based chunk if it
+    // is larger than the server's size limit (the request is 12 bytes).
+    Blob::Type bodyType{};
+    Server s{};
+    s.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, limit);
+    s.setHandler([&](auto request, auto response) {
+      bodyType = request->getMessageBody().getType();
+      response->getMessage()
+        .setStatusCode(200)
+        .setMessageBody({"Done"});
+      response->complete();
+    });
+    s.start();
+    Client c{};
+    auto request = make_shared<Message>(Message::Type::REQUEST);
+    request
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/foo")
+      .setMessageBody({"Hello World!"});
+    auto response = c.sendRequest(request);
+    response->getReadySemaphore().acquire();
+    ASSERT_EQ(response->getStatusCode(), 200);
+    ASSERT_EQ(bodyType, limit > 12 ? Blob::Type::TEXT : Blob::Type::FILE);
+  }
+}
+
+TEST(Server, FileResponse) {
+  // A pattern which does not repeat at any power of 2 exposes a send which
+  // resumes from the wrong offset.
+  string contents(4 * 1024 * 1024, '\0');
+  for (size_t i = 0; i < contents.length(); ++i) {
+    contents[i] = 'a' + (i % 23);
+  }
+  for (auto backend : {ServerIOBackend::EPOLL, ServerIOBackend::IO_URING}) {
+    // Verify that a file-backed response body, larger than the socket
+    // buffers, is sent completely.
+    Server s{};
+    s.setParameter(ServerParameter::IOBACKEND, backend);
+    s.setHandler([&](auto, auto response) {
+      auto f{Util::File::createTemp(tempName)};
+      ASSERT_FALSE(f.append(contents));
+      response->getMessage()
+        .setStatusCode(200)
+        .setMessageBody(Blob{move(f)});
+      response->complete();
+    });
+    s.start();
+    Client c{};
+    auto request = make_shared<Message>(Message::Type::REQUEST);
+    request
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/foo");
+    auto response = c.sendRequest(request);
+    response->getReadySemaphore().acquire();
+    ASSERT_EQ(response->getStatusCode(), 200);
+    ASSERT_EQ(response->getContentLength(), contents.length());
+    ostringstream body;
+    body << response->getMessageBody();
+    ASSERT_EQ(body.str(), contents);
+  }
+}
+
+TEST(Parser, BodyStart) {
+  {
+    // The response body begins immediately after the blank line.
+    string response{"HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nNow"};
+    ResponseParser parser{};
+    parser.setParameter(ClientParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    parser.processBlock(response.data(), response.length());
+    ASSERT_EQ(parser.messages.size(), 1);
+    ASSERT_EQ(parser.messages.front()->getStatusCode(), 200);
+    ASSERT_EQ(parser.messages.front()->getMessageBody(), "Now");
+  }
+  {
+    // The same is true of a request body, even if the line ends are bare LFs.
+    string request{"POST / HTTP/1.1\nContent-Length: 5\n\nHello"};
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    parser.processBlock(request.data(), request.length());
+    ASSERT_EQ(parser.messages.size(), 1);
+    ASSERT_EQ(parser.messages.front()->getMessageBody(), "Hello");
+  }
+}
+
+TEST(Parser, EndOfInput) {
+  for (string request : {
+    "GET /a HTTP/1.1\r\nHost: example.com\r\n\r\n",
+    "POST /a HTTP/1.1\r\nContent-Length: 5\r\n\r\nHello",
+  }) {
+    // A message which ends exactly at the end of the input is delivered
+    // without waiting for more input.
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    parser.processBlock(request.data(), request.length());
+    ASSERT_EQ(parser.messages.size(), 1);
+    ASSERT_FALSE(parser.messages.front()->hasError());
+    ASSERT_EQ(parser.messages.front()->getTarget(), "/a");
+  }
+}
+
+TEST(Parser, SplitInput) {
+  // Verify that the same messages are parsed, no matter where the input is
+  // split into blocks.
+  string input{
+    "POST /a HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "X-Test: one two\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "Hello"
+    "GET /b HTTP/1.1\n"
+    "Accept: text/html, \"a,b\"\n"
+    "\n"};
+  auto verify = [](RequestParser & parser) {
+    ASSERT_EQ(parser.messages.size(), 2);
+    auto first = parser.messages.front();
+    parser.messages.pop();
+    auto second = parser.messages.front();
+    parser.messages.pop();
+    ASSERT_FALSE(first->hasError());
+    ASSERT_EQ(first->getMethod(), "POST");
+    ASSERT_EQ(first->getTarget(), "/a");
+    ASSERT_EQ(first->getFields().at("X-TEST").at(0), "one two");
+    ASSERT_EQ(first->getMessageBody().getType(), Blob::Type::TEXT);
+    ASSERT_EQ(first->getMessageBody(), "Hello");
+    ASSERT_FALSE(second->hasError());
+    ASSERT_EQ(second->getMethod(), "GET");
+    ASSERT_EQ(second->getTarget(), "/b");
+    ASSERT_EQ(second->getFields().at("ACCEPT").size(), 2);
+    ASSERT_EQ(second->getFields().at("ACCEPT").at(1), "a,b");
+    ASSERT_EQ(second->getMessageBody(), "");
+  };
+  for (size_t split = 0; split <= input.length(); ++split) {
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    parser.processBlock(input.data(), split);
+    parser.processBlock(input.data() + split, input.length() - split);
+    verify(parser);
+  }
+  {
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    for (auto & ch : input) {
+      parser.processBlock(&ch, 1);
+    }
+    verify(parser);
+  }
+}
+
+TEST(Parser, LineLength) {
+  // Verify that a long line split across many blocks is parsed, and that an
+  // unfinished line longer than MAXLINELENGTH fails, whether it arrives in
+  // one block or in many.
+  string value(5000, 'v');
+  string input{"GET / HTTP/1.1\r\nX-Long: " + value + "\r\n\r\n"};
+  auto feed = [](RequestParser & parser, const string & text, size_t blockSize) {
+    for (size_t i = 0; i < text.length(); i += blockSize) {
+      parser.processBlock(text.data() + i, min(blockSize, text.length() - i));
+    }
+  };
+  {
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MAXLINELENGTH, uint32_t{8192});
+    feed(parser, input, 100);
+    ASSERT_EQ(parser.messages.size(), 1);
+    ASSERT_FALSE(parser.messages.front()->hasError());
+    ASSERT_EQ(parser.messages.front()->getFields().at("X-LONG").at(0), value);
+  }
+  for (size_t blockSize : {size_t{100}, input.length()}) {
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MAXLINELENGTH, uint32_t{1024});
+    feed(parser, input.substr(0, 3000), blockSize);
+    ASSERT_FALSE(parser.messages.empty());
+    ASSERT_EQ(parser.messages.front()->getStatusCode(), 431);
+  }
+  {
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MAXLINELENGTH, uint32_t{1024});
+    feed(parser, "GET /" + string(3000, 'a'), 100);
+    ASSERT_FALSE(parser.messages.empty());
+    ASSERT_EQ(parser.messages.front()->getStatusCode(), 414);
+  }
+  {
+    // A chunk size line which never ends.
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    parser.setParameter(ServerParameter::MAXLINELENGTH, uint32_t{1024});
+    feed(parser, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n" + string(3000, '0'), 100);
+    ASSERT_FALSE(parser.messages.empty());
+    ASSERT_EQ(parser.messages.front()->getStatusCode(), 400);
+  }
+}
+
+TEST(Parser, SplitFieldLine) {
+  // Verify that a field line split across blocks at the CR is parsed just as
+  // it is in one block, even though the value then begins at the start of
+  // the retained input.
+  vector<pair<string, string>> requests{
+    {"GET / HTTP/1.1\r\nHost: \r", "\n\r\n"},
+    {"GET / HTTP/1.1\r\nHost: a \r", "\n\r\n"},
+    {"GET / HTTP/1.1\r\nAccept: a \r", "\n\r\n"},
+    {"GET / HTTP/1.1\r\nAccept: \r", "\n\r\n"},
+  };
+  for (auto & [first, second] : requests) {
+    RequestParser whole{};
+    RequestParser split{};
+    auto input = first + second;
+    whole.processBlock(input.data(), input.length());
+    split.processBlock(first.data(), first.length());
+    split.processBlock(second.data(), second.length());
+    ASSERT_FALSE(whole.messages.empty()) << input;
+    ASSERT_FALSE(split.messages.empty()) << input;
+    auto expected = whole.messages.front();
+    auto message = split.messages.front();
+    ASSERT_EQ(message->hasError(), expected->hasError()) << input;
+    ASSERT_EQ(message->getStatusCode(), expected->getStatusCode()) << input;
+    ASSERT_EQ(message->getFields().size(), expected->getFields().size()) << input;
+    for (auto & [name, values] : expected->getFields()) {
+      auto actual = message->getFields().at(name);
+      ASSERT_EQ(actual.size(), values.size()) << input;
+      for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_EQ(actual[i], values[i]) << input;
+      }
+    }
+  }
+  {
+    RequestParser parser{};
+    string first{"GET / HTTP/1.1\r\nHost: \r"};
+    string second{"\n\r\n"};
+    parser.processBlock(first.data(), first.length());
+    parser.processBlock(second.data(), second.length());
+    ASSERT_FALSE(parser.messages.empty());
+    ASSERT_EQ(parser.messages.front()->getStatusCode(), 400);
+  }
+}
+
+TEST(Parser, FastPath) {
+  // Verify that the single-pass fast path produces the same messages as the
+  // state machine, including when it must fall back to the state machine.
+  auto describe = [](Parser & parser) {
+    string description{};
+    while (!parser.messages.empty()) {
+      auto message = parser.messages.front();
+      parser.messages.pop();
+      ostringstream line{};
+      line << message->hasError() << " " << message->getStatusCode()
+        << " [" << string_view{message->getMethod()}
+        << "] [" << string_view{message->getTarget()}
+        << "] [" << string_view{message->getVersion()} << "]";
+      for (auto & [name, values] : message->getFields()) {
+        line << " " << string_view{name} << ":";
+        for (auto & value : values) {
+          line << " [" << string_view{value} << "]";
+        }
+      }
+      line << " {" << message->getMessageBody() << "}\n";
+      description += line.str();
+    }
+    return description;
+  };
+  vector<string> requests{
+    "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n",
+    "GET /a?b=c HTTP/1.1\r\nhost: example.com\r\nAccept: text/html,  text/plain ,*/*\r\nUser-Agent: test/1.0 (x)\r\nX-Empty-Ish: a  \r\n\r\n",
+    "\r\n\r\nGET / HTTP/1.1\r\nHost: a\r\n\r\n",
+    "POST /p HTTP/1.1\r\nContent-Length: 4\r\n\r\nbodyGET /q HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nAccept: \"a,b\", c\r\n\r\n",
+    "GET / HTTP/1.1\nHost: a\n\n",
+    "GET / HTTP/1.1\r\nHost: a\nX: b\r\n\r\n",
+    "FOO / HTTP/1.1\r\nHost: a\r\n\r\n",
+    "GET  HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nHost : a\r\n\r\n",
+    "GET / HTTP/1.1\r\nHost:\r\n\r\n",
+    "GET / HTTP/1.1\r\nAccept: a,\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\nabc",
+    "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 3\r\n\r\nabc",
+    "GET / HTTP/1.1\r\nX: a\x01" "b\r\n\r\n",
+    "GET / HTTP/1.1\r\nHost: a\r\n",
+  };
+  for (auto & request : requests) {
+    RequestParser fast{};
+    RequestParser slow{};
+    fast.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    slow.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    slow.setFastPath(false);
+    fast.processBlock(request.data(), request.length());
+    slow.processBlock(request.data(), request.length());
+    ASSERT_EQ(describe(fast), describe(slow)) << request;
+  }
+  vector<string> responses{
+    "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nNow",
+    "HTTP/1.1 404\r\nServer: x\r\nContent-Length: 0\r\n\r\n",
+    "HTTP/1.1 2000 OK\r\n\r\n",
+    "HTTP/1.1 200 O\rK\r\n\r\n",
+  };
+  for (auto & response : responses) {
+    ResponseParser fast{};
+    ResponseParser slow{};
+    fast.setParameter(ClientParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    slow.setParameter(ClientParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    slow.setFastPath(false);
+    fast.processBlock(response.data(), response.length());
+    slow.processBlock(response.data(), response.length());
+    ASSERT_EQ(describe(fast), describe(slow)) << response;
+  }
+}
+
+TEST(Parser, ConflictingContentLength) {
+  // A repeated Content-Length is only accepted if every value is the same.
+  // https://datatracker.ietf.org/doc/html/rfc9112#section-6.3
+  for (bool fastPath : {true, false}) {
+    {
+      RequestParser parser{};
+      parser.setFastPath(fastPath);
+      string request{"POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\nabc"};
+      parser.processBlock(request.data(), request.length());
+      ASSERT_EQ(parser.messages.size(), 1) << fastPath;
+      auto message = parser.messages.front();
+      ASSERT_FALSE(message->hasError()) << fastPath;
+      ASSERT_EQ(message->getMessageBody(), "abc") << fastPath;
+    }
+    {
+      RequestParser parser{};
+      parser.setFastPath(fastPath);
+      string request{"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 3\r\n\r\nabc"};
+      parser.processBlock(request.data(), request.length());
+      ASSERT_FALSE(parser.messages.empty()) << fastPath;
+      auto message = parser.messages.front();
+      ASSERT_TRUE(message->hasError()) << fastPath;
+      ASSERT_EQ(message->getStatusCode(), 400) << fastPath;
+    }
+  }
+}
+
+TEST(Parser, OversizedContentLength) {
+  // A Content-Length too large to be accepted (including one too large to
+  // be represented) is rejected, whether it arrives in one block or split
+  // across many, and whether or not the fast path is used.
+  for (string length : {"2147483648", "99999999999", "999999999999999999999999"}) {
+    string request{"POST / HTTP/1.1\r\nContent-Length: " + length + "\r\n\r\n"};
+    for (bool fastPath : {true, false}) {
+      for (size_t blockSize : {request.length(), size_t{1}, size_t{7}}) {
+        RequestParser parser{};
+        parser.setFastPath(fastPath);
+        for (size_t i = 0; i < request.length(); i += blockSize) {
+          parser.processBlock(request.data() + i, min(blockSize, request.length() - i));
+        }
+        ASSERT_FALSE(parser.messages.empty()) << length << " " << blockSize;
+        auto message = parser.messages.front();
+        ASSERT_TRUE(message->hasError()) << length << " " << blockSize;
+        ASSERT_EQ(message->getStatusCode(), 413) << length << " " << blockSize;
+      }
+    }
+  }
+  {
+    // The largest accepted value is still accepted.
+    RequestParser parser{};
+    string request{"POST / HTTP/1.1\r\nContent-Length: 2147483647\r\n\r\nabc"};
+    parser.processBlock(request.data(), request.length());
+    ASSERT_TRUE(parser.messages.empty());
+  }
+}
+
+TEST(Parser, LazyFields) {
+  // Verify that lazily parsed list fields produce the same messages as
+  // eagerly parsed ones, whether or not the fast path is used.
+  auto describe = [](Parser & parser) {
+    string description{};
+    while (!parser.messages.empty()) {
+      auto message = parser.messages.front();
+      parser.messages.pop();
+      description += to_string(message->hasError());
+      description += " ";
+      description += to_string(message->getStatusCode());
+      for (auto & [name, values] : message->getFields()) {
+        description += " ";
+        description.append(string_view{name});
+        description += ":";
+        for (auto & value : values) {
+          description += " [";
+          description.append(string_view{value});
+          description += "]";
+        }
+      }
+      description += "\n";
+    }
+    return description;
+  };
+  vector<string> requests{
+    "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n",
+    "GET / HTTP/1.1\r\nAccept: text/html,  text/plain ,*/*\r\nUser-Agent: test/1.0 (x)\r\n\r\n",
+    "GET / HTTP/1.1\r\nAccept: \"a,b\", c\r\nAccept-Encoding: gzip\r\naccept: \"x\\\"y\", \"\"\r\n\r\n",
+    "GET / HTTP/1.1\nAccept: a, b\nConnection: close\n\n",
+    "POST /p HTTP/1.1\r\nContent-Length: 4\r\nAccept: a\r\n\r\nbodyGET /q HTTP/1.1\r\nAccept: b,c\r\n\r\n",
+    "GET / HTTP/1.1\r\nAccept: ,a\r\n\r\n",
+    "GET / HTTP/1.1\r\nAccept: a\x01\r\n\r\n",
+  };
+  for (auto & request : requests) {
+    RequestParser eager{};
+    eager.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    eager.processBlock(request.data(), request.length());
+    auto expected = describe(eager);
+    for (bool fastPath : {true, false}) {
+      RequestParser lazy{};
+      lazy.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+      lazy.setFastPath(fastPath);
+      lazy.setLazyFields(true);
+      lazy.processBlock(request.data(), request.length());
+      ASSERT_EQ(describe(lazy), expected) << request;
+    }
+  }
+
+  // A field which is never accessed is never split.
+  RequestParser lazy{};
+  lazy.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+  lazy.setLazyFields(true);
+  string request{"GET / HTTP/1.1\r\nHost: a\r\nAccept: \"x\\\"y\", b\r\n\r\n"};
+  lazy.processBlock(request.data(), request.length());
+  ASSERT_EQ(lazy.messages.size(), 1);
+  auto & fields = lazy.messages.front()->getFields();
+  ASSERT_EQ(fields.get(FieldName::HOST)[0], "a");
+  ASSERT_EQ(fields.get(FieldName::ACCEPT).size(), 2);
+  ASSERT_EQ(fields.get(FieldName::ACCEPT)[0], "x\"y");
+}
+
+TEST(Parser, Targets) {
+  // Each form of target is only accepted with the methods that allow it.
+  vector<pair<string, bool>> requests{
+    {"GET /a?b=c%20d HTTP/1.1", true},
+    {"GET http://example.com/a?b=c%20d HTTP/1.1", true},
+    {"CONNECT example.com:443 HTTP/1.1", true},
+    {"OPTIONS * HTTP/1.1", true},
+    {"GET example.com:443 HTTP/1.1", false},
+    {"GET * HTTP/1.1", false},
+    {"CONNECT /a HTTP/1.1", false},
+    {"GET /a\"b HTTP/1.1", false},
+  };
+  for (auto & [line, valid] : requests) {
+    for (bool fastPath : {true, false}) {
+      string request{line + "\r\nHost: a\r\n\r\n"};
+      RequestParser parser{};
+      parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+      parser.setFastPath(fastPath);
+      parser.processBlock(request.data(), request.length());
+      ASSERT_EQ(parser.messages.size(), 1) << line;
+      auto message = parser.messages.front();
+      ASSERT_EQ(message->hasError(), !valid) << line;
+      if (!valid) {
+        ASSERT_EQ(message->getStatusCode(), 400) << line;
+        continue;
+      }
+      auto & target = message->getParsedTarget();
+      if (target.getForm() == Target::Form::ORIGIN || target.getForm() == Target::Form::ABSOLUTE) {
+        ASSERT_EQ(target.getPath(), "/a") << line;
+        ASSERT_EQ(*target.getQueryParameter("b"), "c d") << line;
+      }
+    }
+  }
+}
+
+TEST(Parser, Chunked) {
+  string request{
+    "POST /a HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\nContent-Length: 3\r\n\r\n"
+    "5\r\nHello\r\n"
+    "19;name=value\r\n, this is a chunked body.\r\n"
+    "00A;a=\"b\"\r\n0123456789\r\n"
+    "0 ;last\r\nX-Checksum: abc\r\n\r\n"
+    "GET /b HTTP/1.1\r\n\r\n"};
+  string body{"Hello, this is a chunked body.0123456789"};
+
+  // The chunks are coalesced into the body, however the input is split.
+  for (size_t blockSize : {request.length(), size_t{1}, size_t{7}}) {
+    for (uint32_t limit : {1024, 8}) {
+      RequestParser parser{};
+      parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, limit);
+      for (size_t i = 0; i < request.length(); i += blockSize) {
+        auto block = request.substr(i, blockSize);
+        parser.processBlock(block.data(), block.length());
+      }
+      ASSERT_EQ(parser.messages.size(), 2) << blockSize;
+      auto message = parser.messages.front();
+      ASSERT_FALSE(message->hasError());
+      ASSERT_EQ(message->getContentLength(), body.length());
+      ASSERT_EQ(message->getMessageBody(), body);
+      ASSERT_EQ(message->getMessageBody().getType(), limit < body.length() ? Blob::Type::FILE : Blob::Type::TEXT);
+      ASSERT_TRUE(message->getChunks().empty());
+      ASSERT_EQ(string_view{message->getTrailerFields().get("X-Checksum")[0]}, "abc");
+      parser.messages.pop();
+      ASSERT_EQ(string_view{parser.messages.front()->getTarget()}, "/b");
+    }
+  }
+
+  // The chunk boundaries may be preserved.
+  RequestParser preserving{};
+  preserving.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+  preserving.setPreserveChunks(true);
+  preserving.processBlock(request.data(), request.length());
+  ASSERT_EQ(preserving.messages.size(), 2);
+  auto & chunks = preserving.messages.front()->getChunks();
+  ASSERT_EQ(preserving.messages.front()->getTransport(), Message::Transport::CHUNKED);
+  ASSERT_EQ(chunks.size(), 3);
+  ASSERT_EQ(chunks[0], "Hello");
+  ASSERT_EQ(chunks[1], ", this is a chunked body.");
+  ASSERT_EQ(chunks[2], "0123456789");
+
+  // The body may be streamed instead.
+  RequestParser streaming{};
+  streaming.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+  streaming.setStreaming(true);
+  streaming.processBlock(request.data(), 90);
+  ASSERT_EQ(streaming.messages.size(), 1);
+  string streamed{};
+  bool ended{false};
+  streaming.messages.front()->getBodyStream()->onData([&](const auto & data, bool finished) {
+    streamed += string_view{data};
+    ended = finished;
+  });
+  streaming.processBlock(request.data() + 90, request.length() - 90);
+  ASSERT_EQ(streamed, body);
+  ASSERT_TRUE(ended);
+  ASSERT_EQ(streaming.messages.size(), 2);
+
+  // Malformed chunked bodies are rejected.
+  vector<string> errors{
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3 x\r\nabc\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10000000000000000\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n",
+  };
+  for (auto & error : errors) {
+    RequestParser parser{};
+    parser.setParameter(ServerParameter::MEMCHUNKSIZELIMIT, uint32_t{1024});
+    parser.processBlock(error.data(), error.length());
+    ASSERT_EQ(parser.messages.size(), 1) << error;
+    ASSERT_TRUE(parser.messages.front()->hasError()) << error;
+    ASSERT_EQ(parser.messages.front()->getStatusCode(), 400) << error;
+  }
+}
+
 TEST(Client, BufferSize) {
   {
     // Verify the response message body is a file-based chunk (because the
@@ -115,6 +956,33 @@ TEST(Client, BufferSize) {
   }
 }
 
+TEST(Client, FileBody) {
+  for (auto backend : {ServerIOBackend::EPOLL, ServerIOBackend::IO_URING}) {
+    // Verify that a file-backed request body, larger than the socket buffers,
+    // is sent completely (the server only responds once the whole request has
+    // been received).
+    Server s{};
+    s.setParameter(ServerParameter::IOBACKEND, backend);
+    s.start();
+    auto f{Util::File::createTemp(tempName)};
+    ASSERT_FALSE(f.append(string(4 * 1024 * 1024, 'x')));
+    Client c{};
+    auto request = make_shared<Message>(Message::Type::REQUEST);
+    request
+      ->setDomain("127.0.0.1")
+      .setPort(s.getPort())
+      .setTarget("/foo")
+      .setMessageBody(Blob{move(f)});
+    ASSERT_EQ(request->getContentLength(), 4 * 1024 * 1024);
+    auto response = c.sendRequest(request);
+    response->getReadySemaphore().acquire();
+
+    // Verify the basic Response Message details.
+    ASSERT_EQ(response->getTransport(), Message::Transport::FIXED);
+    ASSERT_EQ(response->getContentLength(), 12);
+  }
+}
+
 int main(int argc, char** argv) {
   s.start();
   serverPort = s.getPort();